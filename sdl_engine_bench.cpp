@@ -0,0 +1,2064 @@
+// sdl_engine_bench.cpp
+// Headless simulation benchmark for sdl_game_engine.cpp
+// - Builds the ECS World directly: no window, renderer or audio device is opened
+// - Spawns N demo-style entities: one player, chasing enemies and collectible targets
+// - Runs physics, chase AI and aabbIntersect collisions for a fixed number of ticks
+// - Sweeps N from 100 to 1M (x10 steps) and prints one JSON object per line (or CSV)
+// - --mode broadphase times CollisionWorld broadphase + narrowphase alone on N moving boxes,
+//   with --broadphase grid|sap|both and --dist uniform (independent drift) or clustered
+//   (boxes packed in groups that move together), and --threads 1,2,4,8,16 to repeat each run
+//   on a JobSystem of each size (the timed step also builds contact islands), and --static F to
+//   hold a fraction F of the boxes still and let them sleep, and --bullets F to put a fraction F
+//   on a bullet layer that doesn't collide with itself
+// - --mode solver times physics, collision and RigidBodySolver on N boxes crowding toward the
+//   centre, once per --iterations count, reporting the deepest overlap left
+// - --mode steer times Chase steering for N chasers of 16 moving targets: steer_scalar walks the
+//   world calling chaseStep per entity, steer_sync is SteeringSystem sync + update every tick,
+//   steer_batched is update alone (chasers synced once); steer_separate_8 / steer_separate_all
+//   add separation in a packed crowd, looking at 8 neighbours per chaser or all within range
+// - --mode flow times N chasers following one FlowField (32 px cells, 10% walls) toward a circling
+//   target: flow_full rebuilds the field in one call whenever the target changes cell,
+//   flow_amortized settles at most 1/8 of the cells per tick; each tick also runs the steering
+// - --mode path times 64 point-to-point GridPathfinder queries per tick between 16 hotspots on a
+//   map of 32 px cells (15% walls) that grows with N: path_astar is plain A*, path_hpa the cluster
+//   graph without the route cache, path_hpa_cached with it; path_hpa_build times building the graph.
+//   `entities` is queries per tick, so ns_per_entity_tick is per query; `collisions` counts paths
+//   found and `islands` cells and graph nodes expanded
+// - --mode bt times a BehaviorSystem running one shared tree for N agents: bt_all evaluates every
+//   agent each tick, bt_budget_4096 at most 4096 (round-robin), so its tick time stays flat in N,
+//   and bt_lod every agent at its LodSystem band's rate (1 to 1/8, by distance from the center)
+// - --mode particles times a ParticleSystem holding about N live particles: particles_update steps
+//   and respawns them, particles_build builds the quads render() would draw for a window-sized
+//   view; `collisions` sums the live particles per tick, `islands` the quads built
+// - --mode prefab times spawning N six-component enemies: prefab_by_hand with createEntity and
+//   addComponent, prefab_instantiate with one World::instantiate
+// - --mode timers times N entities on repeating cooldowns, 0.1% refreshed per tick: timers_scan
+//   decrements a countdown per entity every tick, timers_wheel keeps them on a TimerWheel
+// Build (Linux pkg-config):
+// g++ -std=c++17 -O2 -pthread -o engine_bench sdl_engine_bench.cpp `pkg-config --cflags --libs sdl2 SDL2_image SDL2_ttf SDL2_mixer`
+// Usage:
+// ./engine_bench [--mode sim|broadphase|solver|steer|flow|path|bt|particles|prefab|timers] [--broadphase grid|sap|both] [--dist uniform|clustered]
+//                [--threads 1,2,4] [--static 0.8] [--bullets 0.9] [--iterations 4,8,16]
+//                [--min 100] [--max 1000000] [--ticks N] [--seed S] [--csv]
+// --ticks 0 (default) picks a tick count per N so every run does a similar amount of work.
+// ./engine_bench --verify checks overlapMask against aabbOverlap, SweepAndPrune and SpatialHashGrid
+// against brute force on random boxes (touching edges, degenerate and huge boxes and filtered
+// layers included), seekLanes against chaseStep, separation against a brute-force sum, FlowField
+// against a relaxation reference, GridPathfinder's A* against FlowField distances and its HPA*
+// paths for legality, behavior tree statuses and the BehaviorSystem schedule against hand-written
+// logic, Rng against the xoshiro256** reference outputs and RngLanes against per-lane scalar
+// generators, ParticleSystem stepping, spawning and quad culling against scalar references,
+// World::instantiate and prefab files, TimerWheel firing ticks against scheduled due ticks,
+// CollisionWorld's tree queries and raycasts against a linear scan, sweepAABB against a finely
+// sampled sweep, that contacts and islands don't depend on the thread count, that sleeping bodies
+// don't change the contacts, that layer changes between resting boxes make and drop contacts,
+// a scripted run's collision events, and RigidBodySolver's bounces, stacks, sleepers and thread
+// independence; exit code 1 on mismatch.
+
+#define SDL_ENGINE_NO_DEMO
+#include "sdl_game_engine.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+// --------------------------- Options ---------------------------
+struct BenchOptions {
+    string mode = "sim";
+    string broadphase = "both";
+    string dist = "uniform";
+    long long minEntities = 100;
+    long long maxEntities = 1000000;
+    int ticks = 0;
+    unsigned seed = 1;
+    bool csv = false;
+    bool verify = false;
+    vector<int> threads = { 1 };
+    vector<int> iterations = { 8 };
+    float staticFraction = 0;
+    float bulletFraction = 0;
+};
+
+// "1,2,4" -> {1, 2, 4}
+static bool parseCountList(const char* s, vector<int>& out) {
+    out.clear();
+    for (const char* p = s; *p; ) {
+        char* end;
+        long t = strtol(p, &end, 10);
+        if (end == p || t < 1) return false;
+        out.push_back((int)t);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return !out.empty();
+}
+
+static bool parseArgs(int argc, char* argv[], BenchOptions& o) {
+    for (int i = 1; i < argc; i++) {
+        auto next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        const char* a = argv[i];
+        const char* v = nullptr;
+        if (!strcmp(a, "--mode") && (v = next())) o.mode = v;
+        else if (!strcmp(a, "--broadphase") && (v = next())) o.broadphase = v;
+        else if (!strcmp(a, "--dist") && (v = next())) o.dist = v;
+        else if (!strcmp(a, "--threads") && (v = next())) { if (!parseCountList(v, o.threads)) { cerr << "Invalid thread list " << v << "\n"; return false; } }
+        else if (!strcmp(a, "--iterations") && (v = next())) { if (!parseCountList(v, o.iterations)) { cerr << "Invalid iteration list " << v << "\n"; return false; } }
+        else if (!strcmp(a, "--static") && (v = next())) o.staticFraction = (float)atof(v);
+        else if (!strcmp(a, "--bullets") && (v = next())) o.bulletFraction = (float)atof(v);
+        else if (!strcmp(a, "--min") && (v = next())) o.minEntities = atoll(v);
+        else if (!strcmp(a, "--max") && (v = next())) o.maxEntities = atoll(v);
+        else if (!strcmp(a, "--ticks") && (v = next())) o.ticks = atoi(v);
+        else if (!strcmp(a, "--seed") && (v = next())) o.seed = (unsigned)strtoul(v, nullptr, 10);
+        else if (!strcmp(a, "--csv")) o.csv = true;
+        else if (!strcmp(a, "--verify")) o.verify = true;
+        else { cerr << "Unknown or incomplete argument: " << a << "\n"; return false; }
+    }
+    if (o.minEntities < 1 || o.maxEntities < o.minEntities) { cerr << "Invalid entity range\n"; return false; }
+    if (o.mode != "sim" && o.mode != "broadphase" && o.mode != "solver" && o.mode != "steer" && o.mode != "flow" && o.mode != "path" && o.mode != "bt" && o.mode != "particles" && o.mode != "prefab" && o.mode != "timers") { cerr << "Unknown mode " << o.mode << "\n"; return false; }
+    if (o.broadphase != "grid" && o.broadphase != "sap" && o.broadphase != "both") { cerr << "Unknown broadphase " << o.broadphase << "\n"; return false; }
+    if (o.dist != "uniform" && o.dist != "clustered") { cerr << "Unknown distribution " << o.dist << "\n"; return false; }
+    if (o.staticFraction < 0 || o.staticFraction > 1) { cerr << "--static must be in [0, 1]\n"; return false; }
+    if (o.bulletFraction < 0 || o.bulletFraction > 1) { cerr << "--bullets must be in [0, 1]\n"; return false; }
+    return true;
+}
+
+// --------------------------- Scene ---------------------------
+struct BenchScene {
+    float width = 800, height = 600;
+    shared_ptr<Entity> player;
+    vector<shared_ptr<Entity>> enemies;
+    vector<shared_ptr<Entity>> targets;
+};
+
+static void placeRandomly(Transform& t, const BenchScene& sc) {
+    t.x = (float)(rand() % (int)(sc.width - t.w));
+    t.y = (float)(rand() % (int)(sc.height - t.h));
+}
+
+// Same shapes as the demo. The arena grows with N so entity density stays constant.
+static BenchScene spawnScene(World& world, long long n) {
+    BenchScene sc;
+    float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    sc.width = side; sc.height = side;
+
+    sc.player = world.createEntity();
+    auto pt = sc.player->addComponent<Transform>();
+    pt->w = 64; pt->h = 64; pt->x = sc.width/2 - 32; pt->y = sc.height/2 - 32;
+    auto pv = sc.player->addComponent<Velocity>();
+    pv->vx = 240.0f; pv->vy = 120.0f;
+
+    long long rest = n - 1;
+    for (long long i = 0; i < rest; i++) {
+        auto e = world.createEntity();
+        auto t = e->addComponent<Transform>();
+        if (i % 2 == 0) {
+            t->w = 48; t->h = 48;
+            e->addComponent<Velocity>();
+            sc.enemies.push_back(e);
+        } else {
+            t->w = 32; t->h = 32;
+            sc.targets.push_back(e);
+        }
+        placeRandomly(*t, sc);
+    }
+    return sc;
+}
+
+// One demo-style tick: AI, physics, then the player-vs-everything collision checks.
+static long long simulateTick(World& world, BenchScene& sc, float dt) {
+    long long hits = 0;
+    auto pt = sc.player->getComponent<Transform>();
+    auto pv = sc.player->getComponent<Velocity>();
+
+    // bounce the player around so collisions keep happening
+    if (pt->x <= 0 || pt->x + pt->w >= sc.width) pv->vx = -pv->vx;
+    if (pt->y <= 0 || pt->y + pt->h >= sc.height) pv->vy = -pv->vy;
+
+    for (auto &e : sc.enemies)
+        chaseStep(*e->getComponent<Transform>(), *pt, *e->getComponent<Velocity>(), 90.0f);
+
+    physicsSystem(world, sc.width, sc.height, dt);
+
+    for (auto &t : sc.targets) {
+        auto tt = t->getComponent<Transform>();
+        if (aabbIntersect(*pt, *tt)) { hits++; placeRandomly(*tt, sc); }
+    }
+    for (auto &e : sc.enemies) {
+        auto et = e->getComponent<Transform>();
+        if (aabbIntersect(*pt, *et)) { hits++; placeRandomly(*et, sc); }
+    }
+    return hits;
+}
+
+// --------------------------- Runner ---------------------------
+struct BenchResult {
+    string bench = "headless_sim";
+    long long entities = 0;
+    int ticks = 0;
+    double seconds = 0;
+    long long collisions = 0;
+    int threads = 1;
+    long long islands = 0;
+    float maxOverlap = 0; // solver runs: deepest overlap left after the last tick, px
+};
+
+static unique_ptr<Broadphase> makeBroadphase(const string& name) {
+    if (name == "sap") return make_unique<SweepAndPrune>();
+    return make_unique<SpatialHashGrid>();
+}
+
+static float frand(float lo, float hi) { return lo + (hi - lo) * (float)rand() / (float)RAND_MAX; }
+
+// Broadphase + narrowphase only, on proxies filled directly (no ECS sync in the timing).
+// Boxes are 16..48 px in the same arena as the sim scene.
+// uniform: spread over the whole arena, each drifting its own way at up to 200 px/s.
+// clustered: groups of ~500 boxes packed into discs at 4x the uniform density; a group shares
+//            one velocity (up to 200 px/s) plus up to 20 px/s of per-box jitter.
+// staticFraction of the boxes (spread evenly over the index range) don't move and are resting;
+// bulletFraction of them (spread the same way, from the other end) are on layer 1, which only
+// meets layer 0.
+static BenchResult runBroadphase(long long n, int ticks, unique_ptr<Broadphase> bp, const string& dist,
+                                 float staticFraction, float bulletFraction, JobSystem& jobs) {
+    float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    CollisionWorld cw;
+    cw.setBroadphase(std::move(bp));
+    cw.setJobs(&jobs);
+    cw.proxies.resize((size_t)n);
+    vector<float> vx((size_t)n), vy((size_t)n);
+    const bool clustered = dist == "clustered";
+    const int groups = (int)std::max(1LL, n / 500);
+    const float groupRadius = std::sqrt((float)(n / groups) * 64.0f * 64.0f / 4.0f / 3.14159f);
+    vector<float> gx(groups), gy(groups), gvx(groups), gvy(groups);
+    for (int g = 0; g < groups; g++) {
+        float r = std::min(groupRadius, side / 2 - 48);
+        gx[g] = frand(r, side - r - 48); gy[g] = frand(r, side - r - 48);
+        gvx[g] = frand(-200, 200); gvy[g] = frand(-200, 200);
+    }
+    for (size_t i = 0; i < (size_t)n; i++) {
+        float w = 16.0f + rand() % 33, h = 16.0f + rand() % 33;
+        float x, y;
+        if (clustered) {
+            int g = (int)(i % groups);
+            float a = frand(0, 6.2831853f), d = std::sqrt(frand(0, 1)) * groupRadius;
+            x = std::clamp(gx[g] + d * std::cos(a), 0.0f, side - w);
+            y = std::clamp(gy[g] + d * std::sin(a), 0.0f, side - h);
+            vx[i] = gvx[g] + frand(-20, 20); vy[i] = gvy[g] + frand(-20, 20);
+        } else {
+            x = (float)(rand() % (int)(side - w)); y = (float)(rand() % (int)(side - h));
+        }
+        cw.proxies.boxes[i] = { x, y, x + w, y + h };
+        cw.proxies.active[i] = 1;
+        cw.proxies.owner[i] = (EntityId)(i + 1);
+        if (!clustered) { vx[i] = (float)(rand() % 401 - 200); vy[i] = (float)(rand() % 401 - 200); }
+        double golden = (double)i * 0.6180339887498949;
+        if (golden - std::floor(golden) < staticFraction) { vx[i] = 0; vy[i] = 0; cw.proxies.resting[i] = 1; }
+        if (1.0 - (golden - std::floor(golden)) <= bulletFraction) { cw.proxies.layerBits[i] = 2u; cw.proxies.layerMasks[i] = 1u; }
+        else if (bulletFraction > 0) cw.proxies.layerMasks[i] = 3u;
+    }
+    const float dt = 1.0f / 120.0f;
+    auto move = [&]() {
+        for (size_t i = 0; i < (size_t)n; i++) {
+            AABB& b = cw.proxies.boxes[i];
+            if (b.minX + vx[i] * dt < 0 || b.maxX + vx[i] * dt > side) vx[i] = -vx[i];
+            if (b.minY + vy[i] * dt < 0 || b.maxY + vy[i] * dt > side) vy[i] = -vy[i];
+            b.minX += vx[i] * dt; b.maxX += vx[i] * dt; b.minY += vy[i] * dt; b.maxY += vy[i] * dt;
+        }
+    };
+
+    BenchResult r;
+    r.bench = string("broadphase_") + cw.broadphase->name() + "_" + dist;
+    if (staticFraction > 0) r.bench += "_static" + to_string((int)std::lround(staticFraction * 100));
+    if (bulletFraction > 0) r.bench += "_bullets" + to_string((int)std::lround(bulletFraction * 100));
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    cw.detect(); // warm-up
+    for (int t = 0; t < ticks; t++) {
+        move();
+        auto start = chrono::steady_clock::now();
+        cw.detect();
+        cw.buildIslands();
+        r.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        r.collisions += (long long)cw.contacts.size();
+        r.islands += (long long)cw.islands.size();
+    }
+    return r;
+}
+
+// Rigid body crowd: N boxes of 24..40 px and mass 1..3 in the sim arena, each steered toward the
+// centre at up to 60 px/s, so they pile into a few large islands. Steering only nudges the
+// velocity the solver left behind (a full overwrite would discard its impulses every tick).
+// Physics, collision and the solver are timed.
+static BenchResult runSolver(long long n, int ticks, int iterations, JobSystem& jobs) {
+    World world;
+    CollisionWorld cw;
+    cw.setJobs(&jobs);
+    RigidBodySolver solver;
+    solver.velocityIterations = iterations;
+    const float side = std::max(800.0f, std::sqrt((float)n) * 64.0f), dt = 1.0f / 60.0f;
+    vector<pair<Transform*, Velocity*>> bodies;
+    for (long long i = 0; i < n; i++) {
+        auto e = world.createEntity();
+        auto t = e->addComponent<Transform>();
+        t->w = t->h = (float)(24 + rand() % 17);
+        t->x = (float)(rand() % (int)(side - t->w)); t->y = (float)(rand() % (int)(side - t->h));
+        e->addComponent<RigidBody>()->mass = (float)(1 + rand() % 3);
+        bodies.push_back({ t.get(), e->addComponent<Velocity>().get() });
+    }
+    Transform centre; centre.x = side / 2; centre.y = side / 2;
+    auto tick = [&]() {
+        for (auto &b : bodies) {
+            Velocity desired;
+            chaseStep(*b.first, centre, desired, 60.0f);
+            b.second->vx += (desired.vx - b.second->vx) * 0.1f;
+            b.second->vy += (desired.vy - b.second->vy) * 0.1f;
+        }
+        physicsSystem(world, side, side, dt);
+        cw.sync(world);
+        cw.detect();
+        solver.solve(cw, dt);
+    };
+    tick(); // warm-up
+
+    BenchResult r;
+    r.bench = "solver_i" + to_string(iterations);
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        tick();
+        r.collisions += (long long)solver.constraintCount;
+        r.islands += (long long)cw.islands.size();
+    }
+    r.maxOverlap = solver.maxOverlap;
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+// Chase steering: N 24 px chasers spread over an arena that grows with N, each after one of 16
+// targets that circle the arena; every other chaser only sees 300 px. Targets move untimed, then
+// steering alone is timed: chaseStep per entity through the World (as the demo used to), or
+// SteeringSystem, re-synced every tick or only once. The separation runs pack the chasers into
+// discs around their targets' starting points, about 20 within any chaser's 32 px separation
+// radius, and time update() with separation looking at 8 neighbours or all of them.
+// `collisions` counts chasers that moved.
+enum SteerBench { SteerScalar, SteerSync, SteerBatched, SteerSeparate, SteerSeparateAll };
+
+static BenchResult runSteer(long long n, int ticks, SteerBench kind, JobSystem& jobs) {
+    World world;
+    const float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    vector<shared_ptr<Transform>> targets;
+    for (int k = 0; k < 16; k++) {
+        auto t = world.createEntity()->addComponent<Transform>();
+        t->w = t->h = 32;
+        targets.push_back(t);
+    }
+    auto moveTargets = [&](int tick) {
+        for (size_t k = 0; k < targets.size(); k++) {
+            float a = (float)k * 0.3927f + (float)tick * 0.01f;
+            targets[k]->x = side / 2 + cosf(a) * side / 3; targets[k]->y = side / 2 + sinf(a) * side / 3;
+        }
+    };
+    const bool crowded = kind == SteerSeparate || kind == SteerSeparateAll;
+    const float disc = std::sqrt((float)n / 16.0f * 150.0f / 3.14159265f); // 150 px^2 per chaser
+    moveTargets(0);
+    for (long long i = 0; i < n; i++) {
+        auto e = world.createEntity();
+        auto t = e->addComponent<Transform>();
+        t->w = t->h = 24;
+        if (crowded) {
+            const Transform& k = *targets[i % targets.size()];
+            float a = frand(0, 6.2831853f), d = disc * std::sqrt(frand(0, 1));
+            t->x = k.x + cosf(a) * d; t->y = k.y + sinf(a) * d;
+        } else {
+            t->x = (float)(rand() % (int)side); t->y = (float)(rand() % (int)side);
+        }
+        e->addComponent<Velocity>();
+        auto c = e->addComponent<Chase>();
+        c->target = targets[i % targets.size()]->owner;
+        c->speed = 90.0f;
+        c->range = i % 2 ? 300.0f : 0.0f;
+    }
+    SteeringSystem steering;
+    steering.setJobs(&jobs);
+    if (crowded) {
+        steering.separation = 1.0f;
+        steering.separationRadius = 32.0f;
+        steering.maxNeighbours = kind == SteerSeparate ? 8 : INT_MAX;
+    }
+    auto tick = [&]() -> long long {
+        if (kind != SteerScalar) {
+            if (kind == SteerSync) steering.sync(world);
+            steering.update();
+            return (long long)steering.chasing;
+        }
+        long long moving = 0;
+        for (auto &kv : world.entities) {
+            auto c = kv.second->getComponent<Chase>();
+            if (!c) continue;
+            auto t = kv.second->getComponent<Transform>();
+            auto v = kv.second->getComponent<Velocity>();
+            auto target = world.entities[c->target]->getComponent<Transform>();
+            float dx = (target->x + target->w / 2) - (t->x + t->w / 2), dy = (target->y + target->h / 2) - (t->y + t->h / 2);
+            if (c->range == 0 || dx * dx + dy * dy <= c->range * c->range) chaseStep(*t, *target, *v, c->speed);
+            else { v->vx = 0; v->vy = 0; }
+            moving += v->vx != 0 || v->vy != 0;
+        }
+        return moving;
+    };
+    moveTargets(0);
+    steering.sync(world);
+    tick(); // warm-up
+
+    BenchResult r;
+    const char* names[] = { "steer_scalar", "steer_sync", "steer_batched", "steer_separate_8", "steer_separate_all" };
+    r.bench = names[kind];
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    double seconds = 0;
+    for (int t = 1; t <= ticks; t++) {
+        moveTargets(t);
+        auto start = chrono::steady_clock::now();
+        r.collisions += tick();
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    r.seconds = seconds;
+    return r;
+}
+
+// Flow field: one FlowField of 32 px cells over an arena that grows with N, 10% of the cells walled
+// off, with N 24 px chasers in open cells after a target that circles the arena. Each timed tick
+// updates the field (in one call, or at most 1/8 of the cells) and runs SteeringSystem::update;
+// chasers are synced once. `islands` counts published fields, `collisions` moving chasers.
+static BenchResult runFlow(long long n, int ticks, bool amortized, JobSystem& jobs) {
+    World world;
+    const float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    const int cells = (int)(side / 32.0f);
+    FlowField field;
+    field.setJobs(&jobs);
+    field.resize(cells, cells, 32.0f);
+    for (int cy = 0; cy < cells; cy++)
+        for (int cx = 0; cx < cells; cx++)
+            if (rand() % 10 == 0) field.setCost(cx, cy, FlowField::Blocked);
+    auto target = world.createEntity()->addComponent<Transform>();
+    target->w = target->h = 32;
+    auto moveTarget = [&](int tick) {
+        float a = (float)tick * 0.01f;
+        target->x = side / 2 + cosf(a) * side / 3; target->y = side / 2 + sinf(a) * side / 3;
+    };
+    for (long long i = 0; i < n; i++) {
+        auto e = world.createEntity();
+        auto t = e->addComponent<Transform>();
+        t->w = t->h = 24;
+        int cx, cy;
+        do { cx = rand() % cells; cy = rand() % cells; } while (field.costAt(cx, cy) == FlowField::Blocked);
+        t->x = cx * 32.0f + 4; t->y = cy * 32.0f + 4;
+        e->addComponent<Velocity>();
+        auto c = e->addComponent<Chase>();
+        c->target = target->owner;
+        c->speed = 90.0f;
+    }
+    SteeringSystem steering;
+    steering.setJobs(&jobs);
+    steering.follow(target->owner, &field);
+    steering.sync(world);
+    const size_t budget = amortized ? std::max<size_t>((size_t)cells * cells / 8, 1) : SIZE_MAX;
+    moveTarget(0);
+    while (!field.update(target->x + 16, target->y + 16, SIZE_MAX)) {} // warm-up: a first field, not timed
+
+    BenchResult r;
+    r.bench = amortized ? "flow_amortized" : "flow_full";
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    double seconds = 0;
+    for (int t = 1; t <= ticks; t++) {
+        moveTarget(t);
+        auto start = chrono::steady_clock::now();
+        r.islands += field.update(target->x + 16, target->y + 16, budget);
+        steering.update();
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        r.collisions += (long long)steering.chasing;
+    }
+    r.seconds = seconds;
+    return r;
+}
+
+// Pathfinding: a map of 32 px cells that grows with N, 15% single-cell walls, and 16 hotspots
+// (open cells) that every query starts and ends at, as agents travelling between rooms would.
+// Each timed tick runs 64 queries; `collisions` counts paths found, `islands` cells and graph
+// nodes expanded.
+enum PathBench { PathAStar, PathHPA, PathHPACached, PathHPABuild };
+
+static BenchResult runPath(long long n, int ticks, PathBench kind) {
+    const float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    const int cells = (int)(side / 32.0f), queries = 64;
+    CostGrid grid;
+    grid.resize(cells, cells, 32.0f);
+    for (int cy = 0; cy < cells; cy++)
+        for (int cx = 0; cx < cells; cx++)
+            if (rand() % 100 < 15) grid.set(cx, cy, CostGrid::Blocked);
+    vector<pair<int, int>> hotspots;
+    while (hotspots.size() < 16) {
+        int cx = rand() % cells, cy = rand() % cells;
+        if (grid.open(cx, cy)) hotspots.push_back({ cx, cy });
+    }
+    GridPathfinder finder;
+    finder.setGrid(&grid);
+    if (kind == PathHPA) finder.cacheLimit = 0;
+    vector<GridPathfinder::Point> path;
+    vector<uint32_t> cellPath;
+
+    BenchResult r;
+    const char* names[] = { "path_astar_", "path_hpa_", "path_hpa_cached_", "path_hpa_build_" };
+    r.bench = names[kind] + to_string(cells);
+    r.entities = kind == PathHPABuild ? 1 : queries;
+    auto start = chrono::steady_clock::now();
+    finder.prepare(); // builds the graph
+    if (kind == PathHPABuild) {
+        r.ticks = 1;
+        r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        r.islands = (long long)finder.expanded;
+        return r;
+    }
+    r.ticks = ticks;
+    start = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        for (int q = 0; q < queries; q++) {
+            auto a = hotspots[rand() % hotspots.size()], b = hotspots[rand() % hotspots.size()];
+            bool found = kind == PathAStar ? finder.findCells(a.first, a.second, b.first, b.second, cellPath, false)
+                                           : finder.findPath(grid.centerX(a.first), grid.centerY(a.second), grid.centerX(b.first), grid.centerY(b.second), path);
+            r.collisions += found;
+            r.islands += (long long)finder.expanded;
+        }
+    }
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+// Behavior trees: N agents with positions in plain arrays (no ECS, so the tree runtime is what's
+// timed) share one tree: measure the distance to one of 16 circling targets, chase it within
+// 300 px, else rest while out of energy, else wander. Actions move their agent by the time since
+// it was last evaluated. bt_all evaluates every agent each tick, bt_budget at most `budget`, bt_lod
+// every agent in turn through a LodSystem (default bands) focused on the arena's center, re-banded
+// every tick from proxies copied untimed; `collisions` counts Running results, `islands` evaluations.
+static BenchResult runBehavior(long long n, int ticks, size_t budget, bool lod, JobSystem& jobs) {
+    const float side = std::max(800.0f, std::sqrt((float)n) * 64.0f);
+    vector<float> px(n), py(n), tx(16), ty(16);
+    for (long long i = 0; i < n; i++) { px[i] = frand(0, side); py[i] = frand(0, side); }
+    auto moveTargets = [&](int tick) {
+        for (int k = 0; k < 16; k++) {
+            float a = (float)k * 0.3927f + (float)tick * 0.01f;
+            tx[k] = side / 2 + cosf(a) * side / 3; ty[k] = side / 2 + sinf(a) * side / 3;
+        }
+    };
+    BehaviorSystem behaviors;
+    behaviors.setJobs(&jobs);
+    behaviors.budget = budget;
+    LodSystem bands;
+    CollisionProxies proxies;
+    proxies.resize(n);
+    auto copyProxies = [&]() {
+        for (long long i = 0; i < n; i++) { proxies.boxes[i] = { px[i], py[i], px[i], py[i] }; proxies.owner[i] = (EntityId)(i + 1); proxies.active[i] = 1; }
+    };
+    if (lod) behaviors.setLod(&bands);
+    BehaviorBlackboard& board = behaviors.blackboard();
+    const int keyDistance = board.key("distance"), keyEnergy = board.key("energy"), keyHeading = board.key("heading");
+    auto agentOf = [](BehaviorBlackboard& b, uint32_t a) { return (size_t)b.entity[a] - 1; };
+    BehaviorTree tree;
+    tree.sequence({
+        tree.action([&](BehaviorBlackboard& b, uint32_t a, float) {
+            size_t i = agentOf(b, a), k = i % 16;
+            b.at(keyDistance, a) = sqrtf((tx[k] - px[i]) * (tx[k] - px[i]) + (ty[k] - py[i]) * (ty[k] - py[i]));
+            return BehaviorSuccess;
+        }),
+        tree.selector({
+            tree.sequence({
+                tree.condition(keyDistance, BehaviorTree::LessEqual, 300.0f),
+                tree.action([&](BehaviorBlackboard& b, uint32_t a, float dt) {
+                    size_t i = agentOf(b, a), k = i % 16;
+                    float d = std::max(b.at(keyDistance, a), 1.0f), step = std::min(90.0f * dt, d);
+                    px[i] += (tx[k] - px[i]) / d * step; py[i] += (ty[k] - py[i]) / d * step;
+                    return BehaviorRunning;
+                }),
+            }),
+            tree.sequence({
+                tree.condition(keyEnergy, BehaviorTree::LessEqual, 0.0f),
+                tree.action([&](BehaviorBlackboard& b, uint32_t a, float dt) { b.at(keyEnergy, a) += 4.0f * dt; return BehaviorRunning; }),
+            }),
+            tree.action([&](BehaviorBlackboard& b, uint32_t a, float dt) {
+                size_t i = agentOf(b, a);
+                float& heading = b.at(keyHeading, a);
+                heading += 0.7f * dt;
+                px[i] = std::clamp(px[i] + cosf(heading) * 40.0f * dt, 0.0f, side);
+                py[i] = std::clamp(py[i] + sinf(heading) * 40.0f * dt, 0.0f, side);
+                b.at(keyEnergy, a) -= dt;
+                return BehaviorRunning;
+            }),
+        }),
+    });
+    for (long long i = 0; i < n; i++) {
+        uint32_t a = behaviors.add((EntityId)(i + 1), &tree);
+        board.at(keyEnergy, a) = frand(0, 4);
+        board.at(keyHeading, a) = frand(0, 6.28f);
+    }
+    const float dt = 1.0f / 60.0f;
+    moveTargets(0);
+    behaviors.update(dt); // warm-up, not timed
+
+    BenchResult r;
+    r.bench = lod ? "bt_lod" : budget ? "bt_budget_" + to_string(budget) : "bt_all";
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    double seconds = 0;
+    for (int t = 1; t <= ticks; t++) {
+        moveTargets(t);
+        if (lod) copyProxies();
+        auto start = chrono::steady_clock::now();
+        if (lod) bands.update(proxies, side / 2, side / 2);
+        behaviors.update(dt);
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        r.collisions += (long long)behaviors.running;
+        r.islands += (long long)behaviors.evaluated;
+    }
+    r.seconds = seconds;
+    return r;
+}
+
+// 16 emitters keep about n particles alive (lifetimes 1-2 s, spawn rates to match), under gravity
+// and drag; warmed up for 3 s untimed. particles_update times update(), particles_build times
+// building the quads for an 800x600 view over the 1600x1200 spray (about a quarter in view).
+static BenchResult runParticles(long long n, int ticks, bool build, JobSystem& jobs) {
+    ParticleSystem particles;
+    particles.setJobs(&jobs);
+    RngLanes rng((uint64_t)rand());
+    particles.setRng(&rng);
+    ParticleEffect fx;
+    fx.capacity = (size_t)n + n / 4 + 64; // spawns bunch up, so room above the mean
+    fx.lifeMin = 1.0f; fx.lifeMax = 2.0f;
+    fx.speedMin = 40.0f; fx.speedMax = 200.0f;
+    fx.gravityY = 120.0f; fx.drag = 0.5f;
+    const int e = particles.addEffect(fx);
+    for (int k = 0; k < 16; k++) particles.addEmitter(e, 100.0f + (k % 4) * 466.0f, 100.0f + (k / 4) * 333.0f, (float)n / 1.5f / 16.0f);
+    const float dt = 1.0f / 60.0f;
+    for (int t = 0; t < 180; t++) particles.update(dt); // warm-up, not timed
+    const AABB view = { 400, 300, 1200, 900 };
+
+    BenchResult r;
+    r.bench = build ? "particles_build" : "particles_update";
+    r.entities = n; r.ticks = ticks; r.threads = jobs.threadCount();
+    double seconds = 0;
+    for (int t = 0; t < ticks; t++) {
+        auto start = chrono::steady_clock::now();
+        if (build) r.islands += (long long)particles.build(e, view);
+        else particles.update(dt);
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (build) particles.update(dt);
+        r.collisions += (long long)particles.live;
+    }
+    r.seconds = seconds;
+    return r;
+}
+
+// Spawns N demo enemies (Transform, Sprite, Velocity, Collider, RigidBody, Chase) into an empty
+// World per tick: prefab_by_hand with createEntity + addComponent per component, as the demo used
+// to, prefab_instantiate with one World::instantiate. Only the spawning is timed.
+static BenchResult runPrefab(long long n, int ticks, bool bulk) {
+    Prefab enemy;
+    Transform& box = enemy.add<Transform>();
+    box.w = 48; box.h = 48;
+    enemy.add<Sprite>();
+    enemy.add<Velocity>();
+    enemy.add<Collider>().layer = 1;
+    enemy.add<RigidBody>().mass = 3.0f;
+    enemy.add<Chase>().speed = 90.0f;
+
+    BenchResult r;
+    r.bench = bulk ? "prefab_instantiate" : "prefab_by_hand";
+    r.entities = n; r.ticks = ticks;
+    double seconds = 0;
+    for (int t = 0; t < ticks; t++) {
+        auto world = make_unique<World>();
+        auto start = chrono::steady_clock::now();
+        if (bulk) world->instantiate(enemy, (size_t)n);
+        else {
+            for (long long i = 0; i < n; i++) {
+                auto e = world->createEntity();
+                auto et = e->addComponent<Transform>();
+                et->w = 48; et->h = 48;
+                e->addComponent<Sprite>();
+                e->addComponent<Velocity>();
+                e->addComponent<Collider>()->layer = 1;
+                e->addComponent<RigidBody>()->mass = 3.0f;
+                e->addComponent<Chase>()->speed = 90.0f;
+            }
+        }
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        r.collisions += (long long)world->entities.size();
+    }
+    r.seconds = seconds;
+    return r;
+}
+
+// N entities on repeating cooldowns of 1-600 ticks (up to 10 s at 60 Hz), 0.1% of them refreshed
+// (cancelled and restarted) each tick, as buffs and respawns would be. timers_scan keeps a
+// countdown per entity and decrements all of them every tick, timers_wheel schedules each
+// cooldown on a TimerWheel. Cooldown lengths depend only on entity and tick, so both fire the
+// same timers; `collisions` counts them.
+static uint32_t cooldownTicks(uint64_t entity, uint64_t tick) {
+    return 1 + (uint32_t)((entity * 2654435761ull ^ tick * 40503ull) % 600);
+}
+
+static BenchResult runTimers(long long n, int ticks, bool wheel) {
+    TimerWheel timers;
+    vector<TimerId> ids;
+    vector<uint32_t> left;
+    int cooldowns = 0;
+    cooldowns = timers.channel([&](const vector<TimerEvent>& events) {
+        for (auto &ev : events) ids[ev.data] = timers.schedule(cooldowns, cooldownTicks(ev.data, timers.now()), INVALID_ENTITY, ev.data);
+    });
+    if (wheel) {
+        ids.resize((size_t)n);
+        for (long long i = 0; i < n; i++) ids[i] = timers.schedule(cooldowns, cooldownTicks(i, 0), INVALID_ENTITY, (uint64_t)i);
+    } else {
+        left.resize((size_t)n);
+        for (long long i = 0; i < n; i++) left[i] = cooldownTicks(i, 0);
+    }
+    Rng rng((uint64_t)rand());
+    const long long refreshes = std::max(1LL, n / 1000);
+
+    BenchResult r;
+    r.bench = wheel ? "timers_wheel" : "timers_scan";
+    r.entities = n; r.ticks = ticks;
+    auto start = chrono::steady_clock::now();
+    for (int t = 1; t <= ticks; t++) {
+        for (long long k = 0; k < refreshes; k++) {
+            uint32_t i = rng.below((uint32_t)n);
+            if (wheel) {
+                timers.cancel(ids[i]);
+                ids[i] = timers.schedule(cooldowns, cooldownTicks(i, (uint64_t)t - 1), INVALID_ENTITY, i);
+            } else {
+                left[i] = cooldownTicks(i, (uint64_t)t - 1);
+            }
+        }
+        if (wheel) {
+            timers.advance();
+            r.collisions += (long long)timers.fired;
+        } else {
+            for (size_t i = 0; i < left.size(); i++) {
+                if (--left[i] != 0) continue;
+                left[i] = cooldownTicks(i, (uint64_t)t);
+                r.collisions++;
+            }
+        }
+    }
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+// --------------------------- Verification ---------------------------
+// Coordinates on a coarse lattice so shared edges (the inclusive case) come up often
+static AABB randomBox(float side) {
+    float x = (float)(rand() % (int)side), y = (float)(rand() % (int)side);
+    switch (rand() % 8) {
+    case 0: return { x, y, x, y };                                   // point
+    case 1: return { x, y, x + 4.0f * (rand() % 64), y };            // horizontal segment
+    case 2: return { -1e30f, y, 1e30f, y + 4.0f * (rand() % 8) };    // huge
+    default: return { x, y, x + 4.0f * (1 + rand() % 12), y + 4.0f * (1 + rand() % 12) };
+    }
+}
+
+static bool verifyKernels(unsigned seed) {
+    srand(seed);
+    long long checked = 0, bad = 0;
+    for (int round = 0; round < 200; round++) {
+        size_t n = 1 + rand() % 64;
+        AABBLanes lanes; lanes.resize(n);
+        for (size_t i = 0; i < n; i++) lanes.set(i, randomBox(128));
+        for (int q = 0; q < 50; q++) {
+            AABB box = randomBox(128);
+            for (size_t first = 0; first < n; first++) {
+                uint32_t m = overlapMask(box, lanes, first);
+                for (int k = 0; k < OverlapLanes; k++) {
+                    bool want = first + k < n && aabbOverlap(box, lanes.get(first + k));
+                    bool got = (m >> k) & 1u;
+                    checked++;
+                    if (want != got && bad++ < 10)
+                        cerr << "overlapMask mismatch: lane " << first + k << " of " << n << " expected " << want << "\n";
+                }
+            }
+        }
+    }
+
+    // Both broadphases against a brute-force pair list, over a few ticks of motion
+    auto sorted = [](vector<ProxyPair> v) {
+        sort(v.begin(), v.end(), [](const ProxyPair& a, const ProxyPair& b) { return a.a != b.a ? a.a < b.a : a.b < b.b; });
+        return v;
+    };
+    CollisionProxies px; px.resize(3000);
+    CollisionLayers layers; // layer 1 skips itself and layer 2
+    layers.set(1, 1, false); layers.set(1, 2, false);
+    for (size_t i = 0; i < px.size(); i++) {
+        px.boxes[i] = randomBox(1024); px.active[i] = 1; px.owner[i] = (EntityId)(i + 1);
+        int layer = rand() % 3;
+        px.layerBits[i] = 1u << layer; px.layerMasks[i] = layers.masks[layer];
+    }
+    px.boxes[7] = { -1e30f, -1e30f, 1e30f, 1e30f };
+    SpatialHashGrid grid; SweepAndPrune sap;
+    vector<ProxyPair> fromGrid, fromSap, brute;
+    for (int tick = 0; tick < 5; tick++) {
+        for (size_t i = 0; i < px.size(); i++) { float d = (float)(rand() % 9 - 4); px.boxes[i].minX += d; px.boxes[i].maxX += d; }
+        px.active[rand() % px.size()] ^= 1;
+        brute.clear();
+        for (uint32_t a = 0; a < px.size(); a++)
+            for (uint32_t b = a + 1; b < px.size(); b++)
+                if (px.active[a] && px.active[b] && aabbOverlap(px.boxes[a], px.boxes[b]) && px.layersMeet(a, b)) brute.push_back({ a, b });
+        grid.update(px); grid.findPairs(fromGrid);
+        sap.update(px); sap.findPairs(fromSap);
+        auto want = sorted(brute);
+        auto g = sorted(fromGrid), s = sorted(fromSap);
+        auto same = [&](const vector<ProxyPair>& v) {
+            return v.size() == want.size() && equal(v.begin(), v.end(), want.begin(), [](const ProxyPair& x, const ProxyPair& y) { return x.a == y.a && x.b == y.b; });
+        };
+        if (!same(g)) { bad++; cerr << "grid pairs differ at tick " << tick << ": " << g.size() << " vs " << want.size() << "\n"; }
+        if (!same(s)) { bad++; cerr << "sap pairs differ at tick " << tick << ": " << s.size() << " vs " << want.size() << "\n"; }
+    }
+
+    // Threaded detect(): same contacts, in the same order, and the same islands as single-threaded.
+    // Sized past the parallel grains, so the chunked paths are what's compared.
+    {
+        JobSystem one, four;
+        one.start(1); four.start(4);
+        CollisionWorld w1, w4;
+        w1.setJobs(&one); w4.setJobs(&four);
+        const size_t n = 60000;
+        w1.proxies.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            float x = (float)(rand() % 8000), y = (float)(rand() % 8000), s = 16.0f + rand() % 33;
+            w1.proxies.boxes[i] = { x, y, x + s, y + s };
+            w1.proxies.active[i] = 1; w1.proxies.owner[i] = (EntityId)(i + 1);
+        }
+        w4.proxies = w1.proxies;
+        for (int tick = 0; tick < 3; tick++) {
+            for (size_t i = 0; i < n; i++) {
+                float d = (float)(rand() % 9 - 4);
+                w1.proxies.boxes[i].minX += d; w1.proxies.boxes[i].maxX += d;
+                w4.proxies.boxes[i] = w1.proxies.boxes[i];
+            }
+            w1.detect(); w1.buildIslands();
+            w4.detect(); w4.buildIslands();
+            bool same = w1.contacts.size() == w4.contacts.size() && w1.islandContacts == w4.islandContacts && w1.islands.size() == w4.islands.size();
+            for (size_t k = 0; same && k < w1.contacts.size(); k++)
+                same = w1.contacts[k].proxyA == w4.contacts[k].proxyA && w1.contacts[k].proxyB == w4.contacts[k].proxyB;
+            if (!same) { bad++; cerr << "threaded contacts differ at tick " << tick << ": " << w4.contacts.size() << " vs " << w1.contacts.size() << "\n"; }
+            // every body belongs to exactly one island
+            vector<int> islandOfSlot(n, -1);
+            for (size_t i = 0; i < w1.islands.size(); i++) {
+                const Island& is = w1.islands[i];
+                for (uint32_t k = is.first; k < is.first + is.count; k++) {
+                    const Contact& c = w1.contacts[w1.islandContacts[k]];
+                    for (uint32_t s : { c.proxyA, c.proxyB }) {
+                        if (islandOfSlot[s] != -1 && islandOfSlot[s] != (int)i && bad++ < 10) cerr << "slot " << s << " in two islands\n";
+                        islandOfSlot[s] = (int)i;
+                    }
+                }
+            }
+        }
+    }
+
+    // Sleeping: 80% of the boxes never move. Marking them resting (so they leave the broadphase)
+    // must give the same contacts as treating every box as awake.
+    for (const char* bp : { "grid", "sap" }) {
+        CollisionWorld awake, sleeping;
+        awake.setBroadphase(makeBroadphase(bp)); sleeping.setBroadphase(makeBroadphase(bp));
+        const size_t n = 20000;
+        awake.proxies.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            float x = (float)(rand() % 4000), y = (float)(rand() % 4000), s = 16.0f + rand() % 33;
+            awake.proxies.boxes[i] = awake.proxies.previous[i] = { x, y, x + s, y + s };
+            awake.proxies.active[i] = 1; awake.proxies.owner[i] = (EntityId)(i + 1);
+            awake.proxies.continuous[i] = i % 25 < 2; // moving and resting ones
+        }
+        sleeping.proxies = awake.proxies;
+        for (size_t i = 0; i < n; i++) sleeping.proxies.resting[i] = i % 5 != 0;
+        for (int tick = 0; tick < 4; tick++) {
+            for (size_t i = 0; i < n; i += 5) {
+                float d = (float)(rand() % 9 - 4);
+                awake.proxies.boxes[i].minX += d; awake.proxies.boxes[i].maxX += d;
+                sleeping.proxies.boxes[i] = awake.proxies.boxes[i];
+            }
+            awake.detect(); sleeping.detect();
+            bool same = awake.contacts.size() == sleeping.contacts.size();
+            for (size_t k = 0; same && k < awake.contacts.size(); k++)
+                same = awake.contacts[k].proxyA == sleeping.contacts[k].proxyA && awake.contacts[k].proxyB == sleeping.contacts[k].proxyB;
+            if (!same) { bad++; cerr << bp << " sleeping contacts differ at tick " << tick << ": " << sleeping.contacts.size() << " vs " << awake.contacts.size() << "\n"; }
+        }
+    }
+
+    // Layer changes between two overlapping boxes that never move (so both sleep): turning the
+    // pair on, moving one to a layer that doesn't meet and back must make and drop the contact
+    for (const char* bp : { "grid", "sap" }) {
+        World w;
+        CollisionWorld cw;
+        cw.setBroadphase(makeBroadphase(bp));
+        shared_ptr<Collider> cols[2];
+        for (int i = 0; i < 2; i++) {
+            auto e = w.createEntity();
+            auto t = e->addComponent<Transform>();
+            t->x = 10.0f * i; t->y = 0; t->w = 32; t->h = 32;
+            cols[i] = e->addComponent<Collider>();
+            cols[i]->layer = 1 + i;
+        }
+        cw.layers.set(1, 2, false);
+        cw.layers.set(1, 3, false);
+        const struct { int layer; bool meet; size_t want; } steps[] = {
+            { 2, false, 0 }, { 2, false, 0 }, { 2, true, 1 }, { 2, true, 1 }, { 3, true, 0 }, { 3, true, 0 }, { 2, true, 1 }, { 2, false, 0 } };
+        int tick = 0;
+        for (auto &st : steps) {
+            cols[1]->layer = st.layer;
+            cw.layers.set(1, 2, st.meet);
+            cw.sync(w);
+            cw.detect();
+            checked++;
+            if (cw.contacts.size() != st.want && bad++ < 10)
+                cerr << bp << " layer change at tick " << tick << ": " << cw.contacts.size() << " contacts, want " << st.want << "\n";
+            tick++;
+        }
+    }
+
+    // Events over a scripted run: Enter, Stay (only with reportStay) and Exit as pairs touch and
+    // part; a settled pair carried over without a narrowphase test; a destroyed entity's pair
+    // exits, and the one that takes its slot enters fresh; a mid-sweep contact ends once the pair
+    // stops being continuous and falls asleep
+    {
+        World w;
+        CollisionWorld cw;
+        auto box = [&](float x, bool moving, bool continuous) {
+            auto e = w.createEntity();
+            auto t = e->addComponent<Transform>();
+            t->x = x; t->y = 0; t->w = 32; t->h = 32;
+            if (moving) e->addComponent<Velocity>();
+            if (continuous) e->addComponent<Collider>()->continuous = true;
+            return e;
+        };
+        auto mover = box(0, true, false); box(100, false, false); box(200, false, false);
+        EntityId doomed = box(210, false, false)->id;
+        auto sweeper = box(300, true, true), swept = box(400, true, true);
+        auto at = [&](shared_ptr<Entity> e, float x) { e->getComponent<Transform>()->x = x; };
+        struct Ev { CollisionPhase phase; EntityId a, b; };
+        uint32_t doomedSlot = 0;
+        for (int tick = 0; tick < 10; tick++) {
+            vector<Ev> want;
+            cw.reportStay = tick != 3;
+            switch (tick) {
+            case 0: want = { { CollisionEnter, 3, 4 } }; break;
+            case 1: at(mover, 80); want = { { CollisionEnter, 1, 2 }, { CollisionStay, 3, 4 } }; break;
+            case 2: want = { { CollisionStay, 1, 2 }, { CollisionStay, 3, 4 } }; break;
+            case 3: break; // no Stay events
+            case 4: at(mover, 0); want = { { CollisionExit, 1, 2 }, { CollisionStay, 3, 4 } }; break;
+            case 5:
+                for (uint32_t s = 0; s < cw.proxies.size(); s++) if (cw.proxies.owner[s] == doomed) doomedSlot = s;
+                w.destroyEntity(doomed);
+                want = { { CollisionExit, 3, 4 } };
+                break;
+            case 6: box(210, false, false); want = { { CollisionEnter, 3, 7 } }; break; // entity 7, in entity 4's slot
+            case 7: at(sweeper, 500); want = { { CollisionEnter, 5, 6 }, { CollisionStay, 3, 7 } }; break; // passed through
+            case 8:
+                for (auto &e : { sweeper, swept }) { e->getComponent<Collider>()->continuous = false; e->getComponent<Velocity>()->asleep = true; }
+                want = { { CollisionExit, 5, 6 }, { CollisionStay, 3, 7 } };
+                break;
+            case 9: want = { { CollisionStay, 3, 7 } }; break;
+            }
+            cw.sync(w);
+            cw.detect();
+            vector<Ev> got;
+            for (auto &ev : cw.events) got.push_back({ ev.phase, ev.a, ev.b });
+            // events come in slot order, and slots follow the World's hash order
+            auto order = [](const Ev& x, const Ev& y) { return tie(x.a, x.b, x.phase) < tie(y.a, y.b, y.phase); };
+            sort(got.begin(), got.end(), order); sort(want.begin(), want.end(), order);
+            bool same = got.size() == want.size();
+            for (size_t k = 0; same && k < got.size(); k++) same = got[k].phase == want[k].phase && got[k].a == want[k].a && got[k].b == want[k].b;
+            if (tick == 2) same &= cw.narrowphaseTests == 0;
+            if (tick == 6) same &= cw.proxies.owner[doomedSlot] == 7;
+            checked++;
+            if (!same && bad++ < 10) {
+                cerr << "CollisionWorld events at tick " << tick << ":";
+                for (auto &ev : got) cerr << ' ' << "ESX"[ev.phase] << ev.a << "-" << ev.b;
+                cerr << " (" << cw.narrowphaseTests << " narrowphase tests)\n";
+            }
+        }
+    }
+
+    // RigidBodySolver: an elastic head-on hit between equal masses swaps their velocities; a stack
+    // resting on a static body keeps its overlaps near the slop and the static body stays put; a
+    // body the solver pushes gets its new contacts next tick, asleep or not; and a crowd comes out
+    // bit for bit the same on 1 and 4 threads
+    {
+        const float dt = 1.0f / 60.0f;
+        auto body = [](World& w, float x, float y, float size, float mass, bool moving) {
+            auto e = w.createEntity();
+            auto t = e->addComponent<Transform>();
+            t->x = x; t->y = y; t->w = t->h = size;
+            e->addComponent<RigidBody>()->mass = mass;
+            if (moving) e->addComponent<Velocity>();
+            return e;
+        };
+
+        {
+            World w;
+            CollisionWorld cw;
+            RigidBodySolver solver;
+            auto a = body(w, 0, 0, 32, 1, true), b = body(w, 31, 0, 32, 1, true);
+            for (auto &e : { a, b }) { e->getComponent<RigidBody>()->restitution = 1; e->getComponent<RigidBody>()->friction = 0; }
+            a->getComponent<Velocity>()->vx = 100; b->getComponent<Velocity>()->vx = -100;
+            cw.sync(w); cw.detect(); solver.solve(cw, dt);
+            auto va = a->getComponent<Velocity>(), vb = b->getComponent<Velocity>();
+            checked++;
+            if ((fabsf(va->vx + 100) > 1e-3f || fabsf(vb->vx - 100) > 1e-3f || va->vy != 0 || vb->vy != 0) && bad++ < 10)
+                cerr << "RigidBodySolver elastic hit: velocities " << va->vx << ", " << vb->vx << ", want -100, 100\n";
+        }
+
+        {
+            World w;
+            CollisionWorld cw;
+            RigidBodySolver solver;
+            auto ground = body(w, 0, 400, 200, 0, true); // mass 0 with a Velocity: kinematic
+            ground->getComponent<Transform>()->h = 40;
+            vector<shared_ptr<Entity>> stack;
+            for (int i = 0; i < 6; i++) stack.push_back(body(w, 80 + i * 0.5f, 400 - 31.0f * (i + 1), 32, 1, true));
+            float worst = 0;
+            for (int tick = 0; tick < 240; tick++) {
+                for (auto &e : stack) {
+                    auto t = e->getComponent<Transform>(); auto v = e->getComponent<Velocity>();
+                    v->vy += 600 * dt;
+                    t->x += v->vx * dt; t->y += v->vy * dt;
+                }
+                cw.sync(w); cw.detect(); solver.solve(cw, dt);
+                if (tick >= 120) worst = std::max(worst, solver.maxOverlap);
+            }
+            auto gt = ground->getComponent<Transform>(); auto gv = ground->getComponent<Velocity>();
+            float top = stack.back()->getComponent<Transform>()->y;
+            checked++;
+            if ((worst > 2.0f || top < 400 - 6 * 32 - 2 || top > 400 - 6 * 32 + 12) && bad++ < 10)
+                cerr << "RigidBodySolver stack: overlap up to " << worst << " px, top at " << top << "\n";
+            checked++;
+            if ((gt->x != 0 || gt->y != 400 || gv->vx != 0 || gv->vy != 0) && bad++ < 10)
+                cerr << "RigidBodySolver moved a mass-0 body to " << gt->x << ", " << gt->y << "\n";
+        }
+
+        {
+            // A and B start 20 px into each other, with their Velocities asleep in one world and
+            // awake in the other. Position correction starts once they sleep, and pushes B into C
+            // (which doesn't move): both worlds find B-C on the next tick
+            World worlds[2];
+            CollisionWorld cws[2];
+            RigidBodySolver solvers[2];
+            for (int k = 0; k < 2; k++) {
+                body(worlds[k], 0, 0, 64, 1, true)->getComponent<Velocity>()->asleep = k == 0;
+                body(worlds[k], 44, 0, 64, 1, true)->getComponent<Velocity>()->asleep = k == 0;
+                auto c = worlds[k].createEntity();
+                auto t = c->addComponent<Transform>();
+                t->x = 44 + 64 + 3; t->y = 8; t->w = t->h = 16;
+                c->addComponent<Velocity>(); // awake, but no RigidBody: the solver leaves it alone
+            }
+            for (int tick = 0; tick < 10; tick++) {
+                vector<pair<EntityId, EntityId>> pairs[2];
+                for (int k = 0; k < 2; k++) {
+                    solvers[k].positionIterations = tick < 2 ? 0 : 3;
+                    cws[k].sync(worlds[k]); cws[k].detect(); solvers[k].solve(cws[k], dt);
+                    for (auto &c : cws[k].contacts) pairs[k].push_back({ c.a, c.b });
+                    sort(pairs[k].begin(), pairs[k].end());
+                }
+                checked++;
+                if ((pairs[0] != pairs[1] || pairs[1].size() != (tick < 3 ? 1u : 2u)) && bad++ < 10)
+                    cerr << "RigidBodySolver: pushed sleepers have " << pairs[0].size() << " contacts at tick " << tick << ", awake " << pairs[1].size() << "\n";
+            }
+        }
+
+        {
+            JobSystem one, four;
+            one.start(1); four.start(4);
+            World worlds[2];
+            CollisionWorld cws[2];
+            RigidBodySolver solvers[2];
+            cws[0].setJobs(&one); cws[1].setJobs(&four);
+            const float side = 2400;
+            for (int i = 0; i < 3000; i++) {
+                float size = frand(24, 40), x = frand(0, side - size), y = frand(0, side - size), mass = i % 10 == 0 ? 0.0f : frand(1, 3);
+                float vx = frand(-60, 60), vy = frand(-60, 60);
+                for (auto &w : worlds) {
+                    auto e = body(w, x, y, size, mass, true);
+                    e->getComponent<Velocity>()->vx = vx; e->getComponent<Velocity>()->vy = vy;
+                }
+            }
+            for (int tick = 0; tick < 20; tick++)
+                for (int k = 0; k < 2; k++) {
+                    physicsSystem(worlds[k], side, side, dt);
+                    cws[k].sync(worlds[k]); cws[k].detect(); solvers[k].solve(cws[k], dt);
+                }
+            size_t differ = 0;
+            for (auto &kv : worlds[0].entities) {
+                auto other = worlds[1].entities.at(kv.first);
+                auto t0 = kv.second->getComponent<Transform>(), t1 = other->getComponent<Transform>();
+                auto v0 = kv.second->getComponent<Velocity>(), v1 = other->getComponent<Velocity>();
+                differ += t0->x != t1->x || t0->y != t1->y || v0->vx != v1->vx || v0->vy != v1->vy;
+            }
+            checked++;
+            if ((differ || solvers[0].constraintCount != solvers[1].constraintCount || cws[1].islands.size() < 32) && bad++ < 10)
+                cerr << "RigidBodySolver: " << differ << " bodies differ between 1 and 4 threads (" << cws[1].islands.size() << " islands)\n";
+        }
+    }
+
+    // CollisionWorld's tree queries against a linear scan over the entities, after rounds of random
+    // moves (inside and past the fat margin), spawns and removals: the same entities for every
+    // rect, point and radius query, and raycast's hit at the nearest entry of any box
+    {
+        World w;
+        CollisionWorld cw;
+        auto spawn = [&]() {
+            auto t = w.createEntity()->addComponent<Transform>();
+            t->x = frand(0, 2000); t->y = frand(0, 2000); t->w = frand(1, 64); t->h = frand(1, 64);
+        };
+        for (int i = 0; i < 1500; i++) spawn();
+        vector<EntityId> got, want;
+        auto same = [&]() { sort(got.begin(), got.end()); sort(want.begin(), want.end()); return got == want; };
+        for (int round = 0; round < 20; round++) {
+            for (auto &kv : w.entities) {
+                auto t = kv.second->getComponent<Transform>();
+                if (rand() % 3 == 0) { t->x += frand(-3, 3); t->y += frand(-3, 3); }
+                else if (rand() % 10 == 0) { t->x = frand(0, 2000); t->y = frand(0, 2000); }
+            }
+            for (int i = 0; i < 60; i++) w.destroyEntity(w.nextId - 1 - rand() % (w.nextId - 1));
+            for (int i = 0; i < 50; i++) spawn();
+            cw.sync(w);
+            checked++;
+            if (cw.tree.size() != w.entities.size() && bad++ < 10)
+                cerr << "AABBTree holds " << cw.tree.size() << " leaves for " << w.entities.size() << " entities\n";
+            for (int q = 0; q < 30; q++) {
+                float x = frand(-100, 2100), y = frand(-100, 2100), r = frand(0, 150);
+                AABB rect = { x, y, x + frand(0, 300), y + frand(0, 300) };
+                for (int kind = 0; kind < 3; kind++) {
+                    want.clear();
+                    for (auto &kv : w.entities) {
+                        AABB b = boxOf(*kv.second->getComponent<Transform>());
+                        float dx = std::max(std::max(b.minX - x, x - b.maxX), 0.0f), dy = std::max(std::max(b.minY - y, y - b.maxY), 0.0f);
+                        bool in = kind == 0 ? aabbOverlap(b, rect) : kind == 1 ? aabbOverlap(b, { x, y, x, y }) : dx * dx + dy * dy <= r * r;
+                        if (in) want.push_back(kv.first);
+                    }
+                    if (kind == 0) cw.queryRect(rect, got);
+                    else if (kind == 1) cw.queryPoint(x, y, got);
+                    else cw.queryRadius(x, y, r, got);
+                    checked++;
+                    if (!same() && bad++ < 10)
+                        cerr << "AABBTree " << (kind == 0 ? "queryRect" : kind == 1 ? "queryPoint" : "queryRadius") << " found " << got.size() << ", scan " << want.size() << "\n";
+                }
+                float x1 = frand(-100, 2100), y1 = frand(-100, 2100);
+                EntityId ignore = rand() % 2 ? w.entities.begin()->first : INVALID_ENTITY;
+                float nearest = 2.0f, t;
+                for (auto &kv : w.entities)
+                    if (kv.first != ignore && rayHitsBox(boxOf(*kv.second->getComponent<Transform>()), x, y, x1 - x, y1 - y, 1.0f, t)) nearest = std::min(nearest, t);
+                RayHit hit;
+                bool found = cw.raycast(x, y, x1, y1, hit, ignore);
+                float own = -1;
+                bool ok = found == (nearest <= 1.0f);
+                if (ok && found) {
+                    auto it = w.entities.find(hit.entity);
+                    ok = hit.entity != ignore && it != w.entities.end() && hit.t == nearest &&
+                         rayHitsBox(boxOf(*it->second->getComponent<Transform>()), x, y, x1 - x, y1 - y, 1.0f, own) && own == nearest;
+                }
+                checked++;
+                if (!ok && bad++ < 10) cerr << "AABBTree raycast hit " << hit.entity << " at " << hit.t << ", nearest entry " << nearest << "\n";
+            }
+        }
+    }
+
+    // Swept test: any sampled overlap must be found, and the box must touch at the reported toi
+    for (int i = 0; i < 20000; i++) {
+        AABB a = randomBox(256), b = randomBox(256);
+        if (a.minX < -1e29f || b.minX < -1e29f) continue;
+        float vx = (float)(rand() % 801 - 400), vy = (float)(rand() % 801 - 400);
+        auto at = [&](float t) { return AABB{ a.minX + vx * t, a.minY + vy * t, a.maxX + vx * t, a.maxY + vy * t }; };
+        bool sampled = false;
+        for (int s = 0; s <= 256 && !sampled; s++) sampled = aabbOverlap(at(s / 256.0f), b);
+        float toi = -1;
+        bool hit = sweepAABB(a, vx, vy, b, toi);
+        const float eps = 1e-3f;
+        AABB touch = at(toi);
+        bool touches = hit && touch.maxX >= b.minX - eps && touch.minX <= b.maxX + eps && touch.maxY >= b.minY - eps && touch.minY <= b.maxY + eps;
+        if ((sampled && !hit) || (hit && !touches) || (hit && (toi < 0 || toi > 1))) {
+            if (bad++ < 10) cerr << "sweepAABB mismatch: sampled " << sampled << " hit " << hit << " toi " << toi << "\n";
+        }
+    }
+
+    // seekLanes against chaseStep, with and without a range; lanes past n must stay zero
+    for (int round = 0; round < 200; round++) {
+        size_t n = 1 + rand() % 40;
+        SeekLanes sl; sl.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            sl.sx[i] = (float)(rand() % 2000) - 1000; sl.sy[i] = (float)(rand() % 2000) - 1000;
+            bool same = rand() % 8 == 0; // centers on top of each other
+            sl.tx[i] = same ? sl.sx[i] : (float)(rand() % 2000) - 1000; sl.ty[i] = same ? sl.sy[i] : (float)(rand() % 2000) - 1000;
+            sl.speed[i] = (float)(1 + rand() % 300);
+            float range = rand() % 2 ? (float)(rand() % 1500) : 0.0f;
+            sl.range2[i] = range * range;
+        }
+        for (size_t i = 0; i < n; i += SteerLanes) seekLanes(sl, i);
+        for (size_t i = 0; i < sl.vx.size(); i++) {
+            Velocity want;
+            if (i < n) {
+                Transform self, target;
+                self.x = sl.sx[i]; self.y = sl.sy[i]; target.x = sl.tx[i]; target.y = sl.ty[i];
+                float dx = sl.tx[i] - sl.sx[i], dy = sl.ty[i] - sl.sy[i];
+                if (sl.range2[i] == 0 || dx * dx + dy * dy <= sl.range2[i]) chaseStep(self, target, want, sl.speed[i]);
+            }
+            float tol = 1e-5f * (i < n ? sl.speed[i] : 1.0f);
+            checked++;
+            if ((fabsf(sl.vx[i] - want.vx) > tol || fabsf(sl.vy[i] - want.vy) > tol) && bad++ < 10)
+                cerr << "seekLanes mismatch: lane " << i << " got " << sl.vx[i] << "," << sl.vy[i] << " expected " << want.vx << "," << want.vy << "\n";
+        }
+    }
+
+    // Separation: with no neighbour cap, SteeringSystem's velocities match a brute-force sum over
+    // every pair (exact duplicates included); with a cap they are the same on 1 and 4 threads and
+    // never faster than the Chase speed
+    {
+        World world;
+        auto target = world.createEntity()->addComponent<Transform>();
+        target->x = 5000; target->y = 5000;
+        vector<shared_ptr<Transform>> ts;
+        vector<shared_ptr<Velocity>> vs;
+        for (int i = 0; i < 1500; i++) {
+            auto e = world.createEntity();
+            auto t = e->addComponent<Transform>();
+            t->w = t->h = 24;
+            if (i % 50 == 1) { t->x = ts.back()->x; t->y = ts.back()->y; } // stacked on the previous one
+            else { t->x = (float)(rand() % 600); t->y = (float)(rand() % 600); }
+            vs.push_back(e->addComponent<Velocity>());
+            auto c = e->addComponent<Chase>();
+            c->target = target->owner;
+            c->speed = 90.0f;
+            ts.push_back(t);
+        }
+        const float radius = 32.0f, r2 = radius * radius;
+        JobSystem serial, four;
+        four.start(4);
+        vector<pair<float, float>> capped1;
+        for (int cap : { INT_MAX, 4, 4 }) {
+            SteeringSystem steering;
+            steering.setJobs(cap == 4 && !capped1.empty() ? &four : &serial);
+            steering.separation = 1.0f; steering.separationRadius = radius; steering.maxNeighbours = cap;
+            steering.sync(world);
+            steering.update();
+            vector<pair<float, float>> got;
+            for (auto &v : vs) got.push_back({ v->vx, v->vy });
+            if (cap == INT_MAX) {
+                for (size_t i = 0; i < ts.size(); i++) {
+                    Velocity want;
+                    chaseStep(*ts[i], *target, want, 90.0f);
+                    float px = 0, py = 0, sx = ts[i]->x + 12, sy = ts[i]->y + 12;
+                    for (size_t o = 0; o < ts.size(); o++) {
+                        if (o == i) continue;
+                        float dx = sx - (ts[o]->x + 12), dy = sy - (ts[o]->y + 12), d2 = dx * dx + dy * dy;
+                        if (d2 >= r2) continue;
+                        if (d2 < 1e-6f) { px += ts[o]->owner > ts[i]->owner ? -1.0f : 1.0f; continue; }
+                        float d = sqrtf(d2);
+                        px += dx / d * (1 - d / radius); py += dy / d * (1 - d / radius);
+                    }
+                    float vx = want.vx + px * 90.0f, vy = want.vy + py * 90.0f, v = sqrtf(vx * vx + vy * vy);
+                    if (v > 90.0f) { vx *= 90.0f / v; vy *= 90.0f / v; }
+                    checked++;
+                    if ((fabsf(got[i].first - vx) > 0.01f || fabsf(got[i].second - vy) > 0.01f) && bad++ < 10)
+                        cerr << "separation mismatch at chaser " << i << ": " << got[i].first << "," << got[i].second << " expected " << vx << "," << vy << "\n";
+                }
+            } else if (capped1.empty()) capped1 = got;
+            else {
+                for (size_t i = 0; i < got.size(); i++) {
+                    checked++;
+                    float v2 = got[i].first * got[i].first + got[i].second * got[i].second;
+                    if ((got[i] != capped1[i] || v2 > 90.0f * 90.0f * 1.0001f) && bad++ < 10)
+                        cerr << "capped separation differs across thread counts at chaser " << i << "\n";
+                }
+            }
+        }
+    }
+
+    // FlowField: distances against Bellman-Ford style relaxation, every direction stepping to a
+    // cheaper cell, and the same field whether built in one call or in small slices on 4 threads
+    {
+        const int cols = 64, rows = 48;
+        FlowField whole, sliced;
+        JobSystem four; four.start(4);
+        sliced.setJobs(&four);
+        whole.resize(cols, rows, 10.0f); sliced.resize(cols, rows, 10.0f);
+        vector<uint8_t> cost((size_t)cols * rows);
+        for (int cy = 0; cy < rows; cy++) {
+            for (int cx = 0; cx < cols; cx++) {
+                int roll = rand() % 100;
+                uint8_t c = roll < 20 ? FlowField::Blocked : (uint8_t)(1 + (roll % 3 == 0 ? rand() % 5 : 0));
+                cost[(size_t)cy * cols + cx] = c; whole.setCost(cx, cy, c); sliced.setCost(cx, cy, c);
+            }
+        }
+        const int tx = 20, ty = 30;
+        whole.update(tx * 10 + 5, ty * 10 + 5, SIZE_MAX);
+        int calls = 1;
+        while (!sliced.update(tx * 10 + 5, ty * 10 + 5, 7)) calls++;
+        auto open = [&](int x, int y) { return x >= 0 && y >= 0 && x < cols && y < rows && cost[(size_t)y * cols + x] != FlowField::Blocked; };
+        vector<uint32_t> ref(cost.size(), FlowField::Unreached);
+        ref[(size_t)ty * cols + tx] = 0;
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (int cy = 0; cy < rows; cy++) for (int cx = 0; cx < cols; cx++) {
+                uint32_t d = ref[(size_t)cy * cols + cx];
+                if (d == FlowField::Unreached) continue;
+                // a step from the neighbour into this cell pays for this cell
+                for (int ny = cy - 1; ny <= cy + 1; ny++) for (int nx = cx - 1; nx <= cx + 1; nx++) {
+                    if ((nx == cx && ny == cy) || !open(nx, ny)) continue;
+                    bool diagonal = nx != cx && ny != cy;
+                    if (diagonal && (!open(nx, cy) || !open(cx, ny))) continue;
+                    if (!open(cx, cy) && !(cx == tx && cy == ty)) continue; // a walled target cell may still be entered
+                    uint32_t nd = d + (diagonal ? 14u : 10u) * cost[(size_t)cy * cols + cx];
+                    if (nd < ref[(size_t)ny * cols + nx]) { ref[(size_t)ny * cols + nx] = nd; changed = true; }
+                }
+            }
+        }
+        for (int cy = 0; cy < rows; cy++) {
+            for (int cx = 0; cx < cols; cx++) {
+                float px = cx * 10 + 5.0f, py = cy * 10 + 5.0f, ax = 0, ay = 0, bx = 0, by = 0;
+                bool ha = whole.direction(px, py, ax, ay), hb = sliced.direction(px, py, bx, by);
+                uint32_t d = whole.distance(cx, cy);
+                bool ok = d == ref[(size_t)cy * cols + cx] && d == sliced.distance(cx, cy) && ha == hb && ax == bx && ay == by;
+                // a direction exactly where the cell is reached and isn't the target, toward a cheaper cell
+                ok = ok && ha == (d != FlowField::Unreached && d != 0);
+                if (ha) {
+                    int nx = cx + (ax > 0.1f) - (ax < -0.1f), ny = cy + (ay > 0.1f) - (ay < -0.1f);
+                    ok = ok && (open(nx, ny) || (nx == tx && ny == ty)) && whole.distance(nx, ny) < d;
+                }
+                checked++;
+                if (!ok && bad++ < 10) cerr << "FlowField mismatch at cell " << cx << "," << cy << " distance " << d << " expected " << ref[(size_t)cy * cols + cx] << "\n";
+            }
+        }
+        if (calls < 2 && bad++ < 10) cerr << "FlowField budget not honoured\n";
+    }
+
+    // FlowField on a non-uniform grid: a step pays for the cell it enters, so next to a costly
+    // target cell the distance is that cell's cost, and following the directions from any cell
+    // pays exactly its distance
+    {
+        const int cols = 24, rows = 16;
+        FlowField f;
+        f.resize(cols, rows, 10.0f);
+        vector<uint8_t> cost((size_t)cols * rows, 1);
+        for (int cy = 0; cy < rows; cy++)
+            for (int cx = 0; cx < cols; cx++) {
+                int roll = rand() % 100;
+                uint8_t c = roll < 10 ? FlowField::Blocked : (uint8_t)(1 + rand() % 9);
+                if (cx == 0 && cy == 1) c = 7;
+                if (cx <= 1 && cy <= 2 && c == FlowField::Blocked) c = 1; // keep the hand-checked corner open
+                cost[(size_t)cy * cols + cx] = c; f.setCost(cx, cy, c);
+            }
+        const int tx = 0, ty = 1;
+        f.update(tx * 10 + 5, ty * 10 + 5, SIZE_MAX);
+        const uint32_t toTarget = 10 * 7;
+        checked++;
+        if ((f.distance(1, 1) != toTarget || f.distance(0, 0) != toTarget || f.distance(0, 2) != toTarget) && bad++ < 10)
+            cerr << "FlowField charges the wrong cell: " << f.distance(1, 1) << " next to a cost-7 target, want " << toTarget << "\n";
+        for (int cy = 0; cy < rows; cy++) {
+            for (int cx = 0; cx < cols; cx++) {
+                const uint32_t d = f.distance(cx, cy);
+                if (d == FlowField::Unreached || d == 0) continue;
+                uint64_t paid = 0;
+                int x = cx, y = cy, steps = 0;
+                float dx, dy;
+                while ((x != tx || y != ty) && steps++ < cols * rows && f.direction(x * 10 + 5.0f, y * 10 + 5.0f, dx, dy)) {
+                    int sx = (dx > 0.1f) - (dx < -0.1f), sy = (dy > 0.1f) - (dy < -0.1f);
+                    x += sx; y += sy;
+                    paid += (sx != 0 && sy != 0 ? 14u : 10u) * cost[(size_t)y * cols + x];
+                }
+                checked++;
+                if ((x != tx || y != ty || paid != d) && bad++ < 10)
+                    cerr << "FlowField directions from " << cx << "," << cy << " pay " << paid << ", distance " << d << "\n";
+            }
+        }
+    }
+
+    // GridPathfinder: A* costs equal the flow field's distances (both optimal); HPA* finds a path
+    // exactly when A* does, and its paths, cached or not, are legal steps from start to goal
+    // no worse than 3x optimal on any query and within 15% of optimal over all of them
+    {
+        const int cols = 96, rows = 64;
+        CostGrid grid;
+        grid.resize(cols, rows, 10.0f);
+        for (int cy = 0; cy < rows; cy++)
+            for (int cx = 0; cx < cols; cx++) {
+                int roll = rand() % 100;
+                if (roll < 25) grid.set(cx, cy, CostGrid::Blocked);
+                else if (roll < 35) grid.set(cx, cy, (uint8_t)(2 + rand() % 4));
+            }
+        FlowField field;
+        field.resize(cols, rows, 10.0f);
+        for (int cy = 0; cy < rows; cy++) for (int cx = 0; cx < cols; cx++) field.setCost(cx, cy, grid.at(cx, cy));
+        GridPathfinder finder;
+        finder.setGrid(&grid);
+        auto pathCost = [&](const vector<uint32_t>& cells, int sx, int sy, int gx, int gy) -> int64_t {
+            if (cells.empty() || cells.front() != (uint32_t)(sy * cols + sx) || cells.back() != (uint32_t)(gy * cols + gx)) return -1;
+            int64_t total = 0;
+            for (size_t i = 1; i < cells.size(); i++) {
+                int ax = cells[i - 1] % cols, ay = cells[i - 1] / cols, bx = cells[i] % cols, by = cells[i] / cols;
+                if (abs(bx - ax) > 1 || abs(by - ay) > 1 || (ax == bx && ay == by) || !grid.canStep(ax, ay, bx - ax, by - ay)) return -1;
+                total += grid.stepCost(bx, by, ax != bx && ay != by);
+            }
+            return total;
+        };
+        vector<uint32_t> optimal, hier;
+        int64_t bestTotal = 0, gotTotal = 0;
+        for (int pass = 0; pass < 2; pass++) { // the second pass repeats the queries, served from the route cache
+            srand(seed + 7);
+            for (int q = 0; q < 300; q++) {
+                int sx, sy, gx, gy;
+                do { sx = rand() % cols; sy = rand() % rows; } while (!grid.open(sx, sy));
+                do { gx = rand() % cols; gy = rand() % rows; } while (!grid.open(gx, gy));
+                bool foundA = finder.findCells(sx, sy, gx, gy, optimal, false);
+                bool foundH = finder.findCells(sx, sy, gx, gy, hier);
+                bool ok = foundA == foundH;
+                if (pass == 0) {
+                    field.update(gx * 10 + 5.0f, gy * 10 + 5.0f, SIZE_MAX); // false when already aimed there
+                    uint32_t d = field.distance(sx, sy);
+                    ok = ok && foundA == (d != FlowField::Unreached) && (!foundA || pathCost(optimal, sx, sy, gx, gy) == (int64_t)d);
+                }
+                if (foundH) {
+                    int64_t best = pathCost(optimal, sx, sy, gx, gy), got = pathCost(hier, sx, sy, gx, gy);
+                    ok = ok && got >= best && got <= best * 3;
+                    bestTotal += best;
+                    gotTotal += got;
+                }
+                checked++;
+                if (!ok && bad++ < 10) cerr << "GridPathfinder mismatch: " << sx << "," << sy << " -> " << gx << "," << gy << " pass " << pass << "\n";
+            }
+        }
+        if (finder.cacheHits == 0 && bad++ < 10) cerr << "GridPathfinder route cache never hit\n";
+        if (gotTotal * 20 > bestTotal * 23 && bad++ < 10) cerr << "GridPathfinder HPA* paths cost " << gotTotal << " against " << bestTotal << " optimal\n";
+    }
+
+    // Behavior trees: statuses match the same logic written out by hand; a budgeted, parallel
+    // BehaviorSystem evaluates every agent equally often and hands each the time since its last
+    // evaluation; removing agents keeps rows and entities paired; with LOD, an update's walk
+    // for due agents stays within budget x the largest band interval
+    {
+        JobSystem jobs;
+        jobs.start(4);
+        BehaviorSystem behaviors;
+        behaviors.setJobs(&jobs);
+        BehaviorBlackboard& board = behaviors.blackboard();
+        const int k0 = board.key("a"), k1 = board.key("b"), k2 = board.key("c"), visits = board.key("visits"), elapsed = board.key("elapsed");
+        auto leafOf = [](float c) { return c < 0.3f ? BehaviorRunning : c < 0.6f ? BehaviorSuccess : BehaviorFailure; };
+        BehaviorTree tree;
+        tree.selector({
+            tree.sequence({
+                tree.condition(k0, BehaviorTree::Less, 0.5f),
+                tree.invert(tree.condition(k1, BehaviorTree::GreaterEqual, 0.25f)),
+                tree.action([&](BehaviorBlackboard& b, uint32_t a, float dt) {
+                    b.at(visits, a) += 1; b.at(elapsed, a) += dt; // counted here only when reached
+                    return leafOf(b.at(k2, a));
+                }),
+            }),
+            tree.condition(k1, BehaviorTree::Greater, 0.9f),
+        });
+        const int agents = 1000;
+        for (int i = 0; i < agents; i++) {
+            uint32_t a = behaviors.add((EntityId)(i + 1), &tree);
+            board.at(k0, a) = frand(0, 0.5f);  // the first two conditions always pass,
+            board.at(k1, a) = frand(0, 0.25f); // so every evaluation reaches the action
+            board.at(k2, a) = frand(0, 1);
+        }
+        behaviors.budget = 300;
+        for (int u = 0; u < 10; u++) behaviors.update(0.1f); // 3000 evaluations: 3 each
+        for (int a = 0; a < agents; a++) {
+            // agent a's last evaluation was its third, in update (a + 2000) / 300 (0-based)
+            float expectElapsed = (float)((a + 2000) / 300 + 1) * 0.1f;
+            bool ok = board.at(visits, a) == 3 && fabsf(board.at(elapsed, a) - expectElapsed) < 1e-4f;
+            checked++;
+            if (!ok && bad++ < 10) cerr << "BehaviorSystem schedule mismatch at agent " << a << "\n";
+        }
+        behaviors.budget = 0;
+        for (int round = 0; round < 3; round++) {
+            for (int a = 0; a < (int)behaviors.agentCount(); a++) {
+                board.at(k0, a) = frand(0, 1); board.at(k1, a) = frand(0, 1); board.at(k2, a) = frand(0, 1);
+            }
+            behaviors.update(0.1f);
+            for (uint32_t a = 0; a < behaviors.agentCount(); a++) {
+                float v0 = board.at(k0, a), v1 = board.at(k1, a), v2 = board.at(k2, a);
+                BehaviorStatus first = v0 < 0.5f && !(v1 >= 0.25f) ? leafOf(v2) : BehaviorFailure;
+                BehaviorStatus expect = first != BehaviorFailure ? first : v1 > 0.9f ? BehaviorSuccess : BehaviorFailure;
+                checked++;
+                if ((behaviors.lastStatus(a) != expect || behaviors.rowOf(board.entity[a]) != (int)a) && bad++ < 10)
+                    cerr << "BehaviorTree status mismatch at agent " << a << " round " << round << "\n";
+            }
+            for (int i = 0; i < 100; i++) behaviors.remove((EntityId)(1 + rand() % agents));
+        }
+
+        // LOD: bands match the distances, and with every agent coming up each update, an agent of
+        // interval k is evaluated on the updates u where (entity + u) % k == 0
+        LodSystem lod;
+        CollisionProxies px;
+        px.resize(behaviors.agentCount() + 5);
+        for (size_t s = 0; s < px.size(); s++) {
+            float x = frand(-3000, 3000), y = frand(-3000, 3000);
+            px.boxes[s] = { x - 4, y - 4, x + 4, y + 4 };
+            px.active[s] = s < behaviors.agentCount(); // the rest are free slots
+            px.owner[s] = s < behaviors.agentCount() ? board.entity[s] : INVALID_ENTITY;
+        }
+        lod.update(px, 100, -50);
+        for (uint32_t a = 0; a < behaviors.agentCount(); a++) {
+            board.at(visits, a) = 0; board.at(elapsed, a) = 0;
+            board.at(k0, a) = 0; board.at(k1, a) = 0; // reach the action every time
+            float dx = (px.boxes[a].minX + 4) - 100, dy = (px.boxes[a].minY + 4) + 50, d = sqrtf(dx * dx + dy * dy);
+            int want = d <= 512 ? 0 : d <= 1024 ? 1 : d <= 2048 ? 2 : 3;
+            checked++;
+            if (lod.levelOf(board.entity[a]) != want && fabsf(d - 512) > 0.01f && fabsf(d - 1024) > 0.01f && fabsf(d - 2048) > 0.01f && bad++ < 10)
+                cerr << "LodSystem band mismatch for entity " << board.entity[a] << "\n";
+        }
+        // every agent was evaluated by the last update, so elapsed time restarts there
+        behaviors.setLod(&lod);
+        for (int u = 0; u < 8; u++) behaviors.update(0.1f);
+        for (uint32_t a = 0; a < behaviors.agentCount(); a++) {
+            EntityId e = board.entity[a];
+            int k = lod.intervalOf(e), last = -1;
+            for (int u = 0; u < 8; u++) if ((e + u) % k == 0) last = u;
+            checked++;
+            if ((board.at(visits, a) != 8 / k || fabsf(board.at(elapsed, a) - (last + 1) * 0.1f) > 1e-4f) && bad++ < 10)
+                cerr << "BehaviorSystem LOD mismatch: entity " << e << " interval " << k << " evaluated " << board.at(visits, a) << " times\n";
+        }
+
+        // a budget the agents' band can't fill: all at interval 8 and none due on their first
+        // turns, an update looks at no more than budget x 8 of them; against a hand-run schedule
+        LodSystem far;
+        far.bands = { { INFINITY, 8, 8 } };
+        BehaviorSystem capped;
+        capped.setLod(&far);
+        BehaviorBlackboard& counts = capped.blackboard();
+        const int runs = counts.key("runs");
+        BehaviorTree count;
+        count.action([&](BehaviorBlackboard& b, uint32_t a, float) { b.at(runs, a) += 1; return BehaviorSuccess; });
+        const size_t farAgents = 2000;
+        for (size_t i = 0; i < farAgents; i++) capped.add((EntityId)(8 * i + 1), &count);
+        capped.budget = 5;
+        vector<uint32_t> turn(farAgents);
+        vector<float> expectRuns(farAgents, 0.0f);
+        for (size_t i = 0; i < farAgents; i++) turn[i] = (uint32_t)(8 * i + 1);
+        size_t cursor = 0;
+        for (int u = 0; u < 60; u++) {
+            capped.update(0.1f);
+            size_t looked = 0, due = 0;
+            for (; looked < 40 && due < 5; looked++) {
+                size_t a = (cursor + looked) % farAgents;
+                if (turn[a]++ % 8 == 0) { expectRuns[a] += 1; due++; }
+            }
+            cursor = (cursor + looked) % farAgents;
+            checked++;
+            if (capped.evaluated != due && bad++ < 10)
+                cerr << "BehaviorSystem LOD walk: update " << u << " evaluated " << capped.evaluated << ", expected " << due << "\n";
+        }
+        for (uint32_t a = 0; a < farAgents; a++) {
+            checked++;
+            if (counts.at(runs, a) != expectRuns[a] && bad++ < 10)
+                cerr << "BehaviorSystem LOD walk: agent " << a << " ran " << counts.at(runs, a) << " times, expected " << expectRuns[a] << "\n";
+        }
+    }
+
+    // Rng: the published xoshiro256** outputs from state {1, 2, 3, 4}; below(n) stays under n;
+    // RngLanes::fill matches four scalar generators seeded the same way, on whichever SIMD path
+    // this build took; RngService streams don't depend on creation order and rewind on restore,
+    // and bulk streams come out of seed() and restore() as a freshly seeded service makes them
+    {
+        Rng ref; ref.s[0] = 1; ref.s[1] = 2; ref.s[2] = 3; ref.s[3] = 4;
+        const uint64_t known[4] = { 0x2d00ull, 0x0ull, 0x5a007080ull, 0x10e0000000009d80ull };
+        for (uint64_t want : known) {
+            uint64_t got = ref.next();
+            checked++;
+            if (got != want && bad++ < 10) cerr << "Rng mismatch: got " << hex << got << " want " << want << dec << "\n";
+        }
+        Rng r(seed);
+        for (int i = 0; i < 2000; i++) {
+            uint32_t n = 1 + r.nextU32() % (i < 1000 ? 7u : 0x7fffffffu), v = r.below(n);
+            checked++;
+            if (v >= n && bad++ < 10) cerr << "Rng::below(" << n << ") gave " << v << "\n";
+        }
+        for (size_t n : { (size_t)1, (size_t)3, (size_t)4, (size_t)37, (size_t)1000 }) {
+            RngLanes lanes(seed + n);
+            Rng scalar[RngLanes::Count];
+            for (int l = 0; l < RngLanes::Count; l++)
+                for (int w = 0; w < 4; w++) scalar[l].s[w] = lanes.s[w][l];
+            for (int call = 0; call < 2; call++) {
+                vector<float> out(n);
+                lanes.fill(out.data(), n, -2.5f, 7.f);
+                for (size_t i = 0; i < ((n + 3) & ~(size_t)3); i++) {
+                    float want = -2.5f + (float)(int32_t)(scalar[i % 4].next() >> 40) * (9.5f * 0x1p-24f);
+                    if (i >= n) continue;
+                    checked++;
+                    if (out[i] != want && bad++ < 10)
+                        cerr << "RngLanes::fill mismatch at " << i << " of " << n << ": " << out[i] << " vs " << want << "\n";
+                }
+            }
+        }
+        RngService a, b;
+        a.seed(seed); b.seed(seed);
+        a.stream("spawn"); a.stream("loot");
+        b.stream("loot"); b.stream("weather"); b.stream("spawn");
+        RngService::Snapshot snap = a.snapshot();
+        uint64_t first[8];
+        for (int i = 0; i < 8; i++) {
+            first[i] = a.stream("spawn").next();
+            checked++;
+            if (first[i] != b.stream("spawn").next() && bad++ < 10) cerr << "RngService stream depends on creation order\n";
+        }
+        a.restore(snap);
+        for (int i = 0; i < 8; i++) {
+            checked++;
+            if (a.stream("spawn").next() != first[i] && bad++ < 10) cerr << "RngService restore mismatch at " << i << "\n";
+        }
+        auto sameFill = [&](RngLanes& x, RngLanes& y, const char* what) {
+            float fx[37], fy[37];
+            x.fill(fx, 37, 0, 1); y.fill(fy, 37, 0, 1);
+            checked++;
+            if (memcmp(fx, fy, sizeof fx) != 0 && bad++ < 10) cerr << "RngService bulk stream " << what << "\n";
+        };
+        RngService c, fresh;
+        c.bulk("particles").fill(nullptr, 0, 0, 1); // made under the default seed, then reseeded
+        c.seed(seed); fresh.seed(seed);
+        sameFill(c.bulk("particles"), fresh.bulk("particles"), "differs after seed()");
+        RngService::Snapshot bulkSnap = c.snapshot();
+        float skip[16];
+        c.bulk("late").fill(skip, 16, 0, 1); // made after the snapshot, so restore() restarts it
+        c.restore(bulkSnap);
+        sameFill(c.bulk("late"), fresh.bulk("late"), "differs after restore()");
+    }
+
+    // ParticleSystem: particleLanes against a scalar integration (37 particles, so the last batch
+    // is partial), removeDead keeps exactly the living, bursts stay in their cone and ranges and
+    // stop at capacity, emitters spawn rate * time, and build() matches a brute-force cull over
+    // several job chunks, with birth colors at birth
+    {
+        JobSystem jobs;
+        jobs.start(3);
+        ParticleSystem ps;
+        ps.setJobs(&jobs);
+        RngLanes lanes(seed);
+        ps.setRng(&lanes);
+        ParticleEffect fx;
+        fx.capacity = 37;
+        fx.gravityX = frand(-50, 50); fx.gravityY = frand(0, 300); fx.drag = 0.8f;
+        const int e = ps.addEffect(fx);
+        ParticlePool& p = ps.pool(e);
+        p.grow(37);
+        vector<float> rx(37), ry(37), rvx(37), rvy(37), rl(37);
+        for (size_t i = 0; i < 37; i++) {
+            rx[i] = p.x[i] = frand(0, 800); ry[i] = p.y[i] = frand(0, 600);
+            rvx[i] = p.vx[i] = frand(-200, 200); rvy[i] = p.vy[i] = frand(-200, 200);
+            rl[i] = p.life[i] = 10.0f; p.invLifetime[i] = 0.1f;
+        }
+        const float dt = 1.0f / 60.0f;
+        for (int step = 0; step < 5; step++) {
+            ps.update(dt);
+            for (size_t i = 0; i < 37; i++) {
+                rvx[i] = (rvx[i] + fx.gravityX * dt) * (1.0f - fx.drag * dt); rvy[i] = (rvy[i] + fx.gravityY * dt) * (1.0f - fx.drag * dt);
+                rx[i] += rvx[i] * dt; ry[i] += rvy[i] * dt; rl[i] -= dt;
+            }
+        }
+        for (size_t i = 0; i < 37; i++) {
+            checked++;
+            if ((fabsf(p.x[i] - rx[i]) > 1e-3f || fabsf(p.y[i] - ry[i]) > 1e-3f || fabsf(p.vx[i] - rvx[i]) > 1e-3f ||
+                 fabsf(p.vy[i] - rvy[i]) > 1e-3f || fabsf(p.life[i] - rl[i]) > 1e-5f) && bad++ < 10)
+                cerr << "particleLanes mismatch at " << i << ": " << p.x[i] << "," << p.y[i] << " vs " << rx[i] << "," << ry[i] << "\n";
+        }
+
+        vector<float> survivors;
+        for (size_t i = 0; i < 37; i++) {
+            p.life[i] = rand() % 3 == 0 ? -frand(0, 1) : frand(0.5f, 1);
+            p.x[i] = (float)i;
+            if (p.life[i] - dt > 0) survivors.push_back((float)i);
+        }
+        ps.update(dt);
+        vector<float> kept;
+        for (size_t i = 0; i < p.size(); i++) kept.push_back(roundf(p.x[i] - p.vx[i] * dt)); // undo this step's move
+        sort(kept.begin(), kept.end());
+        checked++;
+        if (kept != survivors && bad++ < 10) cerr << "ParticlePool::removeDead kept " << kept.size() << " particles, want " << survivors.size() << "\n";
+
+        ParticleEffect cone;
+        cone.capacity = 1000;
+        cone.direction = 1.5f; cone.spread = 0.5f;
+        cone.speedMin = 10; cone.speedMax = 20; cone.lifeMin = 0.25f; cone.lifeMax = 0.75f;
+        const int c = ps.addEffect(cone);
+        size_t got = ps.burst(c, 40, 50, 700) + ps.burst(c, 40, 50, 700);
+        checked++;
+        if ((got != 1000 || ps.pool(c).size() != 1000 || ps.dropped != 400) && bad++ < 10)
+            cerr << "ParticleSystem::burst capacity: granted " << got << ", dropped " << ps.dropped << "\n";
+        const ParticlePool& cp = ps.pool(c);
+        for (size_t i = 0; i < cp.size(); i++) {
+            float speed = sqrtf(cp.vx[i] * cp.vx[i] + cp.vy[i] * cp.vy[i]), angle = atan2f(cp.vy[i], cp.vx[i]);
+            checked++;
+            if ((cp.x[i] != 40 || cp.y[i] != 50 || speed < 10 - 1e-3f || speed > 20 + 1e-3f || fabsf(angle - 1.5f) > 0.25f + 1e-4f ||
+                 cp.life[i] < 0.25f || cp.life[i] > 0.75f || fabsf(cp.life[i] * cp.invLifetime[i] - 1) > 1e-6f) && bad++ < 10)
+                cerr << "ParticleSystem::burst out of range: speed " << speed << " angle " << angle << " life " << cp.life[i] << "\n";
+        }
+
+        // 30/s over 0.125 s steps is 3.75 a step, exactly representable: 75 after 20 steps
+        ParticleSystem em;
+        ParticleEffect slow;
+        slow.capacity = 200; slow.lifeMin = slow.lifeMax = 100.0f;
+        em.addEmitter(em.addEffect(slow), 0, 0, 30.0f);
+        for (int step = 0; step < 20; step++) em.update(0.125f);
+        checked++;
+        if (em.live != 75 && bad++ < 10) cerr << "ParticleEmitter spawned " << em.live << " particles, want 75\n";
+
+        ParticleEffect cull;
+        cull.capacity = 20000;
+        cull.sizeStart = 6; cull.sizeEnd = 2;
+        cull.colorStart = { 10, 20, 30, 255 }; cull.colorEnd = { 200, 100, 0, 0 };
+        const int q = ps.addEffect(cull);
+        ParticlePool& qp = ps.pool(q);
+        qp.grow(20000);
+        for (size_t i = 0; i < qp.size(); i++) {
+            qp.x[i] = frand(-100, 900); qp.y[i] = frand(-100, 700);
+            qp.life[i] = i % 5 ? frand(0.1f, 1) : 1.0f; qp.invLifetime[i] = 1.0f;
+        }
+        const AABB view = { 0, 0, 800, 600 };
+        size_t want = 0;
+        for (size_t i = 0; i < qp.size(); i++) {
+            float h = 1 + 2 * qp.life[i];
+            want += qp.x[i] + h >= 0 && qp.x[i] - h <= 800 && qp.y[i] + h >= 0 && qp.y[i] - h <= 600;
+        }
+        size_t quads = ps.build(q, view);
+        checked++;
+        if (quads != want && bad++ < 10) cerr << "ParticleSystem::build made " << quads << " quads, want " << want << "\n";
+        size_t k = 0;
+        for (size_t i = 0; i < qp.size() && k < quads; i++) {
+            float h = 1 + 2 * qp.life[i];
+            if (qp.x[i] + h < 0 || qp.x[i] - h > 800 || qp.y[i] + h < 0 || qp.y[i] - h > 600) continue;
+            const SDL_Vertex* v = ps.vertices() + k * 4;
+            checked++;
+            if ((fabsf(v[0].position.x - (qp.x[i] - h)) > 1e-4f || fabsf(v[3].position.y - (qp.y[i] + h)) > 1e-4f ||
+                 (i % 5 == 0 && (v[0].color.r != 10 || v[0].color.g != 20 || v[0].color.b != 30 || v[0].color.a != 255))) && bad++ < 10)
+                cerr << "ParticleSystem::build quad " << k << " doesn't match particle " << i << "\n";
+            k++;
+        }
+    }
+
+    // Prefabs: every instance gets its own copy of each component with the prefab's values and
+    // its owner set, ids are consecutive, instances outlive destroyed batch-mates (which drop their
+    // components at once), and the text format sets every field and rejects unknown types, bad
+    // values, textures that don't load and unterminated prefabs
+    {
+        Prefab pf;
+        Transform& box = pf.add<Transform>();
+        box.x = frand(0, 100); box.w = 48; box.h = 24;
+        pf.add<Sprite>().scale = 2.0f;
+        pf.add<Velocity>().vx = 5.0f;
+        pf.add<Collider>().layer = 3;
+        pf.add<RigidBody>().restitution = 0.25f;
+        pf.add<Chase>().speed = 42.0f;
+        World w;
+        w.createEntity();
+        EntityId first = w.instantiate(pf, 1000);
+        checked++;
+        if ((first != 2 || w.nextId != 1002 || w.entities.size() != 1001 || w.instantiate(pf, 0) != INVALID_ENTITY) && bad++ < 10)
+            cerr << "World::instantiate ids: first " << first << ", next " << w.nextId << "\n";
+        w.entities.at(first + 7)->getComponent<Transform>()->x = -1.0f; // shared by no one else
+        for (EntityId id = first; id < first + 1000; id += 37) w.destroyEntity(id);
+        for (EntityId id = first; id < first + 1000; id++) {
+            if ((id - first) % 37 == 0) continue;
+            auto e = w.entities.at(id);
+            auto t = e->getComponent<Transform>();
+            auto s = e->getComponent<Sprite>(); auto v = e->getComponent<Velocity>(); auto c = e->getComponent<Collider>();
+            auto b = e->getComponent<RigidBody>(); auto ch = e->getComponent<Chase>();
+            checked++;
+            if ((e->id != id || e->components.size() != 6 || !t || !s || !v || !c || !b || !ch ||
+                 t->x != (id == first + 7 ? -1.0f : box.x) || t->w != 48 || t->h != 24 || s->scale != 2.0f || v->vx != 5.0f ||
+                 c->layer != 3 || b->restitution != 0.25f || ch->speed != 42.0f ||
+                 t->owner != id || s->owner != id || v->owner != id || c->owner != id || b->owner != id || ch->owner != id) && bad++ < 10)
+                cerr << "World::instantiate instance " << id << " doesn't match its prefab\n";
+        }
+        // a destroyed instance drops its components at once, one added after instantiate too,
+        // even while its Entity is still held; its batch-mates keep theirs
+        struct Counted : Component {
+            int& alive;
+            explicit Counted(int& a) : alive(a) { alive++; }
+            ~Counted() override { alive--; }
+        };
+        int alive = 0;
+        auto held = w.entities.at(first + 1);
+        held->addComponent<Counted>(alive);
+        w.destroyEntity(first + 1);
+        auto mate = w.entities.at(first + 2);
+        checked++;
+        if ((alive != 0 || !held->components.empty() || w.entities.count(first + 1) || mate->components.size() != 6 ||
+             mate->getComponent<Transform>()->w != 48) && bad++ < 10)
+            cerr << "World::destroyEntity kept a batch instance's components (" << alive << " extra alive)\n";
+
+        PrefabLibrary lib;
+        istringstream good("sdl-engine-prefabs 1\n# comment\nprefab crate\nTransform x 1 y 2 w 3 h 4 angle 5  # trailing\n"
+                           "Sprite texture crate.png scale 0.5 srcX 1 srcY 2 srcW 3 srcH 4\nVelocity vx -6 vy 7\n"
+                           "Collider continuous 1 layer 31\nRigidBody mass 0 restitution 0.75 friction 0.125\nChase speed 12 range 34\nend\n"
+                           "prefab empty\nend\n");
+        SDL_Texture* fakeTex = (SDL_Texture*)&lib;
+        string asked;
+        bool parsed = lib.parse(good, "good", [&](const string& p) { asked = p; return fakeTex; });
+        Prefab* crate = lib.find("crate");
+        checked++;
+        if (!parsed || !crate || !lib.find("empty") || crate->parts.size() != 6 || asked != "crate.png") {
+            if (bad++ < 10) cerr << "PrefabLibrary::parse failed on a valid file\n";
+        } else {
+            Transform* t = crate->get<Transform>(); Sprite* s = crate->get<Sprite>(); Velocity* v = crate->get<Velocity>();
+            Collider* c = crate->get<Collider>(); RigidBody* b = crate->get<RigidBody>(); Chase* ch = crate->get<Chase>();
+            checked++;
+            if ((t->x != 1 || t->y != 2 || t->w != 3 || t->h != 4 || t->angle != 5 || s->texture != fakeTex || s->scale != 0.5f ||
+                 s->srcX != 1 || s->srcY != 2 || s->srcW != 3 || s->srcH != 4 || v->vx != -6 || v->vy != 7 || !c->continuous ||
+                 c->layer != 31 || b->mass != 0 || b->restitution != 0.75f || b->friction != 0.125f || ch->speed != 12 || ch->range != 34) && bad++ < 10)
+                cerr << "PrefabLibrary::parse set the wrong field values\n";
+        }
+        streambuf* errors = cerr.rdbuf(nullptr); // the rejections below report on cerr
+        for (const char* text : { "sdl-engine-prefabs 2\n", "prefab a\nend\n", "sdl-engine-prefabs 1\nprefab a\nMissile speed 1\nend\n",
+                                  "sdl-engine-prefabs 1\nprefab a\nTransform w wide\nend\n", "sdl-engine-prefabs 1\nprefab a\nCollider layer 32\nend\n",
+                                  "sdl-engine-prefabs 1\nprefab a\nVelocity vx\nend\n", "sdl-engine-prefabs 1\nprefab a\nTransform w 1\n",
+                                  "sdl-engine-prefabs 1\nTransform w 1\n", "sdl-engine-prefabs 1\nprefab a\nChase target 3\nend\n",
+                                  "sdl-engine-prefabs 1\nprefab a\nSprite texture a.png\nend\n" }) {
+            PrefabLibrary rejecting;
+            istringstream in(text);
+            bool accepted = rejecting.parse(in, "bad");
+            cerr.rdbuf(errors); cerr.clear();
+            checked++;
+            if ((accepted || rejecting.find("a")) && bad++ < 10) cerr << "PrefabLibrary::parse accepted: " << text << "\n";
+            cerr.rdbuf(nullptr);
+        }
+        cerr.rdbuf(errors); cerr.clear();
+    }
+
+    // TimerWheel: random schedules (some past 2^16 and 2^24 ticks, so they cascade from the upper
+    // levels), cancels and advances against a list of due ticks; every timer fires exactly on its
+    // tick, on its channel and with its data, cancelled ones never, and handlers can chain new
+    // timers. Then the seconds conversions.
+    {
+        struct Due { uint64_t tick; int channel; uint64_t data; };
+        TimerWheel w;
+        unordered_map<TimerId, Due> live;
+        vector<tuple<uint64_t, TimerId, int, uint64_t>> got; // (tick, id, channel, data)
+        vector<TimerId> gone;
+        int channels[2];
+        for (int c = 0; c < 2; c++) {
+            channels[c] = w.channel([&, c](const vector<TimerEvent>& events) {
+                for (auto &ev : events) {
+                    got.emplace_back(w.now(), ev.id, c, ev.data);
+                    if (c == 1 && ev.data % 4 == 0) { // chain a follow-up from inside the handler
+                        uint64_t d = 1 + ev.data % 700;
+                        live[w.schedule(channels[1], d, INVALID_ENTITY, ev.data + 1)] = { w.now() + d, 1, ev.data + 1 };
+                    }
+                }
+            });
+        }
+        Rng rng(seed * 7 + 1);
+        for (int round = 0; round < 3000; round++) {
+            for (uint32_t k = rng.below(12); k > 0; k--) {
+                uint64_t d;
+                switch (rng.below(8)) {
+                case 0: d = rng.below(2); break;                              // 0 means 1
+                case 1: d = 256 + rng.below(70000); break;                    // level 1, some 2
+                case 2: d = rng.below(4) == 0 ? (1u << 24) + rng.below(1u << 25) : rng.below(1u << 24); break;
+                default: d = 1 + rng.below(300); break;
+                }
+                int c = (int)rng.below(2);
+                uint64_t data = rng.next() >> 8;
+                TimerId id = w.schedule(channels[c], d, INVALID_ENTITY, data);
+                checked++;
+                if ((live.count(id) || id == 0) && bad++ < 10) cerr << "TimerWheel::schedule reused a live id\n";
+                live[id] = { w.now() + std::max<uint64_t>(d, 1), c, data };
+            }
+            for (uint32_t k = rng.below(4); k > 0 && !live.empty(); k--) {
+                auto it = live.begin();
+                std::advance(it, rng.below((uint32_t)live.size()));
+                checked++;
+                if ((!w.pending(it->first) || w.remaining(it->first) != it->second.tick - w.now() || !w.cancel(it->first) || w.pending(it->first)) && bad++ < 10)
+                    cerr << "TimerWheel::cancel failed on a pending timer\n";
+                gone.push_back(it->first);
+                live.erase(it);
+            }
+            for (size_t k = 0; k < 2 && !gone.empty(); k++) {
+                TimerId id = gone[rng.below((uint32_t)gone.size())];
+                checked++;
+                if ((w.cancel(id) || w.pending(id) || w.remaining(id) != 0) && bad++ < 10) cerr << "TimerWheel::cancel accepted a fired or cancelled id\n";
+            }
+            uint32_t roll = rng.below(64);
+            uint64_t step = roll == 0 ? (1u << 22) + rng.below(1u << 24) : roll < 4 ? rng.below(1u << 17) : rng.below(400);
+            const uint64_t to = w.now() + step;
+            got.clear();
+            size_t firedTotal = 0;
+            // in pieces, so `fired` is checked per call too
+            while (w.now() < to) {
+                size_t before = got.size();
+                w.advance(std::min<uint64_t>(to - w.now(), 1 + rng.below(5000)));
+                firedTotal += w.fired;
+                checked++;
+                if (w.fired != got.size() - before && bad++ < 10) cerr << "TimerWheel::fired " << w.fired << ", handlers saw " << got.size() - before << "\n";
+            }
+            for (auto &g : got) {
+                auto it = live.find(get<1>(g));
+                checked++;
+                if ((it == live.end() || it->second.tick != get<0>(g) || it->second.channel != get<2>(g) || it->second.data != get<3>(g)) && bad++ < 10)
+                    cerr << "TimerWheel fired timer " << get<1>(g) << " at tick " << get<0>(g) << ", not as scheduled\n";
+                if (it != live.end()) { gone.push_back(it->first); live.erase(it); }
+            }
+            size_t overdue = 0;
+            for (auto &kv : live) overdue += kv.second.tick <= w.now();
+            checked++;
+            if ((overdue || w.size() != live.size() || firedTotal != got.size()) && bad++ < 10)
+                cerr << "TimerWheel at tick " << w.now() << ": " << overdue << " timers missed, " << w.size() << " pending vs " << live.size() << "\n";
+            if (gone.size() > 4096) gone.erase(gone.begin(), gone.begin() + 2048);
+        }
+
+        TimerWheel s;
+        s.tickSeconds = 0.125f;
+        int hits = 0;
+        const int ch = s.channel([&](const vector<TimerEvent>& events) { hits += (int)events.size(); });
+        TimerId id = s.scheduleSeconds(ch, 0.3f); // 2.4 ticks, rounded up
+        uint64_t r0 = s.remaining(id);
+        s.advanceSeconds(0.3125f);                // 2.5 ticks: 2 now, the half carried
+        uint64_t t0 = s.now();
+        s.advanceSeconds(0.3125f);
+        checked++;
+        if ((r0 != 3 || t0 != 2 || s.now() != 5 || hits != 1) && bad++ < 10)
+            cerr << "TimerWheel seconds: " << r0 << " ticks scheduled, now " << t0 << " then " << s.now() << ", " << hits << " fired\n";
+
+        // mass cancels: the sweep of stale entries keeps the survivors
+        TimerWheel m;
+        size_t survivors = 0, wrong = 0;
+        const int mc = m.channel([&](const vector<TimerEvent>& events) {
+            for (auto &ev : events) { survivors++; wrong += ev.data % 10 != 0 || m.now() != 100000 + ev.data % 5000; }
+        });
+        vector<TimerId> many;
+        for (uint64_t i = 0; i < 20000; i++) many.push_back(m.schedule(mc, 100000 + i % 5000, INVALID_ENTITY, i));
+        for (uint64_t i = 0; i < 20000; i++) if (i % 10) m.cancel(many[i]);
+        m.advance(110000);
+        checked++;
+        if ((survivors != 2000 || wrong || m.size() != 0) && bad++ < 10)
+            cerr << "TimerWheel after mass cancels: " << survivors << " fired, " << wrong << " wrong, " << m.size() << " pending\n";
+    }
+
+#if defined(__AVX2__)
+    const char* path = "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char* path = "sse2";
+#else
+    const char* path = "scalar";
+#endif
+    cout << "{\"verify\":\"" << path << "\",\"lanes_checked\":" << checked << ",\"mismatches\":" << bad << "}\n";
+    return bad == 0;
+}
+
+static BenchResult runSim(long long n, int ticks) {
+    World world;
+    BenchScene sc = spawnScene(world, n);
+    const float dt = 1.0f / 120.0f;
+
+    simulateTick(world, sc, dt); // warm-up, not timed
+
+    BenchResult r;
+    r.entities = n;
+    r.ticks = ticks;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < ticks; i++) r.collisions += simulateTick(world, sc, dt);
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+static void printResult(const BenchResult& r, bool csv) {
+    double ticksPerSec = r.seconds > 0 ? r.ticks / r.seconds : 0;
+    double nsPerEntity = r.seconds * 1e9 / ((double)r.ticks * (double)r.entities);
+    if (csv) {
+        cout << r.bench << "," << r.entities << "," << r.ticks << "," << r.seconds << "," << ticksPerSec << "," << nsPerEntity << "," << r.collisions << "," << r.threads << "," << r.islands << "," << r.maxOverlap << "\n";
+    } else {
+        cout << "{\"bench\":\"" << r.bench << "\",\"entities\":" << r.entities << ",\"ticks\":" << r.ticks
+             << ",\"seconds\":" << r.seconds << ",\"ticks_per_sec\":" << ticksPerSec
+             << ",\"ns_per_entity_tick\":" << nsPerEntity << ",\"collisions\":" << r.collisions
+             << ",\"threads\":" << r.threads << ",\"islands\":" << r.islands << ",\"max_overlap\":" << r.maxOverlap << "}\n";
+    }
+    cout.flush();
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    if (!parseArgs(argc, argv, opt)) return 2;
+    if (opt.verify) return verifyKernels(opt.seed) ? 0 : 1;
+    if (opt.csv) cout << "bench,entities,ticks,seconds,ticks_per_sec,ns_per_entity_tick,collisions,threads,islands,max_overlap\n";
+
+    for (long long n = opt.minEntities; n <= opt.maxEntities; n *= 10) {
+        int ticks = opt.ticks > 0 ? opt.ticks : (int)std::clamp(20000000LL / n, 5LL, 2000LL);
+        srand(opt.seed);
+        if (opt.mode == "sim") printResult(runSim(n, ticks), opt.csv);
+        else if (opt.mode == "solver") {
+            for (int threads : opt.threads) {
+                for (int iterations : opt.iterations) {
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed);
+                    printResult(runSolver(n, ticks, iterations, jobs), opt.csv);
+                }
+            }
+        } else if (opt.mode == "bt") {
+            for (int threads : opt.threads) {
+                for (int kind = 0; kind < 3; kind++) { // all, budgeted, LOD
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed);
+                    printResult(runBehavior(n, ticks, kind == 1 ? 4096 : 0, kind == 2, jobs), opt.csv);
+                }
+            }
+        } else if (opt.mode == "prefab") {
+            for (bool bulk : { false, true }) printResult(runPrefab(n, std::max(ticks / 20, 3), bulk), opt.csv);
+        } else if (opt.mode == "timers") {
+            for (bool wheel : { false, true }) {
+                srand(opt.seed);
+                printResult(runTimers(n, ticks, wheel), opt.csv);
+            }
+        } else if (opt.mode == "particles") {
+            for (int threads : opt.threads) {
+                for (bool build : { false, true }) {
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed);
+                    printResult(runParticles(n, ticks, build, jobs), opt.csv);
+                }
+            }
+        } else if (opt.mode == "path") {
+            int pathTicks = std::max(ticks / 20, 3); // a tick is 64 whole-map queries
+            for (PathBench kind : { PathHPABuild, PathAStar, PathHPA, PathHPACached }) {
+                srand(opt.seed);
+                printResult(runPath(n, pathTicks, kind), opt.csv);
+            }
+        } else if (opt.mode == "flow") {
+            for (int threads : opt.threads) {
+                for (bool amortized : { false, true }) {
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed);
+                    printResult(runFlow(n, ticks, amortized, jobs), opt.csv);
+                }
+            }
+        } else if (opt.mode == "steer") {
+            srand(opt.seed);
+            JobSystem serial;
+            printResult(runSteer(n, ticks, SteerScalar, serial), opt.csv);
+            for (int threads : opt.threads) {
+                for (SteerBench kind : { SteerSync, SteerBatched, SteerSeparate, SteerSeparateAll }) {
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed);
+                    printResult(runSteer(n, ticks, kind, jobs), opt.csv);
+                }
+            }
+        } else {
+            for (const char* bp : { "grid", "sap" }) {
+                if (opt.broadphase != "both" && opt.broadphase != bp) continue;
+                for (int threads : opt.threads) {
+                    JobSystem jobs;
+                    jobs.start(threads);
+                    srand(opt.seed); // same boxes for every broadphase and thread count
+                    printResult(runBroadphase(n, ticks, makeBroadphase(bp), opt.dist, opt.staticFraction, opt.bulletFraction, jobs), opt.csv);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,509 @@
+// sdl_engine_microbench.cpp
+// Microbenchmarks for sdl_game_engine.cpp hot paths
+// - Entity::getComponent<T>, World::all(), World::createEntity/destroyEntity, spawning by hand vs World::instantiate
+// - aabbIntersect, aabbOverlap vs the batched overlapMask kernel (AABBLanes), CollisionWorld point/radius queries through the AABB tree
+// - rand() vs Rng::next/below and RngLanes::fill bulk floats
+// - TextureManager::load cache hits, FontManager::load key construction
+// - renderEntities into a headless software renderer (no window is opened)
+// - ParticleSystem::update, and render() through the same software renderer
+// - TimerWheel schedule + cancel, and a tick of n repeating cooldowns on the wheel vs a countdown scan
+// Every case is parameterized over the entity count so the output shows scaling curves.
+// The harness below mirrors the Google Benchmark API (State loop, BENCHMARK()->Range()),
+// so cases can move to the real library by replacing the harness section with <benchmark/benchmark.h>.
+// Build (Linux pkg-config):
+// g++ -std=c++17 -O2 -pthread -o engine_microbench sdl_engine_microbench.cpp `pkg-config --cflags --libs sdl2 SDL2_image SDL2_ttf SDL2_mixer`
+// Usage:
+// ./engine_microbench [--filter substring] [--min-time seconds] [--json]
+
+#define SDL_ENGINE_NO_DEMO
+#include "sdl_game_engine.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+// --------------------------- Tiny benchmark harness ---------------------------
+namespace benchmark {
+
+template<typename T>
+inline void DoNotOptimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink; sink = &value;
+#endif
+}
+
+class State {
+public:
+    State(long long arg, long long iterations): arg(arg), iterations(iterations) {}
+
+    struct Value { ~Value() {} }; // non-trivial so `for (auto _ : state)` doesn't warn
+    struct Iterator {
+        State* st; long long left;
+        bool operator!=(const Iterator&) {
+            if (left > 0) return true;
+            st->stop = chrono::steady_clock::now();
+            return false;
+        }
+        void operator++() { --left; }
+        Value operator*() const { return {}; }
+    };
+    Iterator begin() { start = chrono::steady_clock::now(); return { this, iterations }; }
+    Iterator end() { return { this, 0 }; }
+
+    long long range(int) const { return arg; }
+    void SetItemsProcessed(long long n) { items = n; }
+    void SkipWithError(const char* msg) { error = msg; }
+
+    double seconds() const { return chrono::duration<double>(stop - start).count(); }
+
+    long long arg;
+    long long iterations;
+    long long items = 0;
+    string error;
+    chrono::steady_clock::time_point start, stop;
+};
+
+struct Case {
+    string name;
+    void (*fn)(State&);
+    vector<long long> args;
+    long long multiplier = 8;
+
+    Case* RangeMultiplier(long long m) { multiplier = m; return this; }
+    Case* Range(long long lo, long long hi) {
+        args.clear();
+        for (long long a = lo; a < hi; a *= multiplier) args.push_back(a);
+        args.push_back(hi);
+        return this;
+    }
+    Case* Arg(long long a) { args.push_back(a); return this; }
+};
+
+inline vector<unique_ptr<Case>>& registry() { static vector<unique_ptr<Case>> r; return r; }
+
+inline Case* registerCase(const char* name, void (*fn)(State&)) {
+    registry().push_back(make_unique<Case>());
+    Case* c = registry().back().get();
+    c->name = name; c->fn = fn;
+    return c;
+}
+
+} // namespace benchmark
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+#define BENCHMARK(fn) [[maybe_unused]] static benchmark::Case* BENCH_CONCAT(bench_case_, __LINE__) = benchmark::registerCase(#fn, fn)
+
+// --------------------------- Fixtures ---------------------------
+static void populateWorld(World& world, long long n, SDL_Texture* tex = nullptr) {
+    for (long long i = 0; i < n; i++) {
+        auto e = world.createEntity();
+        auto t = e->addComponent<Transform>();
+        t->x = (float)(rand() % 800); t->y = (float)(rand() % 600); t->w = 32; t->h = 32;
+        auto s = e->addComponent<Sprite>(); s->texture = tex;
+        e->addComponent<Velocity>();
+    }
+}
+
+// Software renderer on an offscreen surface: real SDL drawing code, no window or GPU.
+struct HeadlessRenderer {
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    HeadlessRenderer(int w, int h) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface) renderer = SDL_CreateSoftwareRenderer(surface);
+    }
+    ~HeadlessRenderer() {
+        if (renderer) SDL_DestroyRenderer(renderer);
+        if (surface) SDL_FreeSurface(surface);
+    }
+};
+
+// --------------------------- Benchmarks ---------------------------
+static void BM_GetComponent(benchmark::State& state) {
+    World world; populateWorld(world, state.range(0));
+    auto ents = world.all();
+    for (auto _ : state) {
+        // Velocity is the last component added, so this is the longest scan
+        for (auto &e : ents) benchmark::DoNotOptimize(e->getComponent<Velocity>());
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_GetComponent)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_WorldAll(benchmark::State& state) {
+    World world; populateWorld(world, state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(world.all());
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_WorldAll)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_CreateDestroyEntity(benchmark::State& state) {
+    World world;
+    vector<EntityId> ids((size_t)state.range(0));
+    for (auto _ : state) {
+        for (auto &id : ids) id = world.createEntity()->id;
+        for (auto id : ids) world.destroyEntity(id);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_CreateDestroyEntity)->RangeMultiplier(10)->Range(10, 100000);
+
+// n Transform + Sprite + Velocity entities spawned and destroyed: one addComponent at a time,
+// then through World::instantiate
+static void BM_SpawnByHand(benchmark::State& state) {
+    World world;
+    vector<EntityId> ids((size_t)state.range(0));
+    for (auto _ : state) {
+        for (auto &id : ids) {
+            auto e = world.createEntity();
+            auto t = e->addComponent<Transform>(); t->w = 32; t->h = 32;
+            e->addComponent<Sprite>();
+            e->addComponent<Velocity>();
+            id = e->id;
+        }
+        for (auto id : ids) world.destroyEntity(id);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_SpawnByHand)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_SpawnPrefab(benchmark::State& state) {
+    World world;
+    Prefab pf;
+    Transform& t = pf.add<Transform>(); t.w = 32; t.h = 32;
+    pf.add<Sprite>();
+    pf.add<Velocity>();
+    const size_t n = (size_t)state.range(0);
+    for (auto _ : state) {
+        EntityId first = world.instantiate(pf, n);
+        for (EntityId id = first; id < first + n; id++) world.destroyEntity(id);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_SpawnPrefab)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_AabbIntersect(benchmark::State& state) {
+    vector<Transform> boxes((size_t)state.range(0));
+    for (auto &b : boxes) { b.x = (float)(rand() % 800); b.y = (float)(rand() % 600); b.w = 32; b.h = 32; }
+    Transform probe; probe.x = 400; probe.y = 300; probe.w = 64; probe.h = 64;
+    for (auto _ : state) {
+        int hits = 0;
+        for (auto &b : boxes) hits += aabbIntersect(probe, b);
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_AabbIntersect)->RangeMultiplier(10)->Range(10, 100000);
+
+// World boxes spread at constant density; one query per entity per iteration
+static void BM_TreeQueryPoint(benchmark::State& state) {
+    World world; CollisionWorld cw;
+    float side = std::sqrt((float)state.range(0)) * 64.0f;
+    for (long long i = 0; i < state.range(0); i++) {
+        auto t = world.createEntity()->addComponent<Transform>();
+        t->x = (float)(rand() % (int)side); t->y = (float)(rand() % (int)side); t->w = 32; t->h = 32;
+    }
+    cw.sync(world);
+    vector<float> px((size_t)state.range(0)), py((size_t)state.range(0));
+    for (size_t i = 0; i < px.size(); i++) { px[i] = (float)(rand() % (int)side); py[i] = (float)(rand() % (int)side); }
+    vector<EntityId> out;
+    for (auto _ : state) {
+        for (size_t i = 0; i < px.size(); i++) { cw.queryPoint(px[i], py[i], out); benchmark::DoNotOptimize(out.data()); }
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_TreeQueryPoint)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_TreeQueryRadius(benchmark::State& state) {
+    World world; CollisionWorld cw;
+    float side = std::sqrt((float)state.range(0)) * 64.0f;
+    for (long long i = 0; i < state.range(0); i++) {
+        auto t = world.createEntity()->addComponent<Transform>();
+        t->x = (float)(rand() % (int)side); t->y = (float)(rand() % (int)side); t->w = 32; t->h = 32;
+    }
+    cw.sync(world);
+    vector<EntityId> out;
+    for (auto _ : state) {
+        for (auto &kv : world.entities) {
+            auto t = kv.second->getComponent<Transform>();
+            cw.queryRadius(t->x + 16, t->y + 16, 96.0f, out);
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_TreeQueryRadius)->RangeMultiplier(10)->Range(10, 100000);
+
+static void fillLanes(AABBLanes& lanes, vector<AABB>& boxes, long long n) {
+    lanes.resize((size_t)n); boxes.resize((size_t)n);
+    for (size_t i = 0; i < boxes.size(); i++) {
+        float x = (float)(rand() % 800), y = (float)(rand() % 600);
+        boxes[i] = { x, y, x + 32, y + 32 };
+        lanes.set(i, boxes[i]);
+    }
+}
+
+// One box against n, one pair at a time (the baseline for BM_AabbOverlapBatch)
+static void BM_AabbOverlapScalar(benchmark::State& state) {
+    AABBLanes lanes; vector<AABB> boxes; fillLanes(lanes, boxes, state.range(0));
+    AABB probe = { 400, 300, 464, 364 };
+    for (auto _ : state) {
+        int hits = 0;
+        for (auto &b : boxes) hits += aabbOverlap(probe, b);
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_AabbOverlapScalar)->RangeMultiplier(10)->Range(10, 100000);
+
+// Same test through overlapMask, 8 boxes per call (AVX2 with -mavx2, SSE2 otherwise)
+static void BM_AabbOverlapBatch(benchmark::State& state) {
+    AABBLanes lanes; vector<AABB> boxes; fillLanes(lanes, boxes, state.range(0));
+    AABB probe = { 400, 300, 464, 364 };
+    for (auto _ : state) {
+        int hits = 0;
+        forEachOverlap(probe, lanes, 0, lanes.size(), [&](size_t) { hits++; });
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_AabbOverlapBatch)->RangeMultiplier(10)->Range(10, 100000);
+
+// n floats in [0, 800) per iteration: rand() (the old spawn code), Rng one at a time, RngLanes in bulk
+static void BM_RandLibc(benchmark::State& state) {
+    vector<float> out((size_t)state.range(0));
+    for (auto _ : state) {
+        for (auto &f : out) f = (float)(rand() % 800);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_RandLibc)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_RngRange(benchmark::State& state) {
+    vector<float> out((size_t)state.range(0));
+    Rng rng(7);
+    for (auto _ : state) {
+        for (auto &f : out) f = rng.range(0, 800);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_RngRange)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_RngBelow(benchmark::State& state) {
+    vector<uint32_t> out((size_t)state.range(0));
+    Rng rng(7);
+    for (auto _ : state) {
+        for (auto &v : out) v = rng.below(800);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_RngBelow)->RangeMultiplier(10)->Range(10, 100000);
+
+// AVX2 with -mavx2, SSE2 otherwise
+static void BM_RngLanesFill(benchmark::State& state) {
+    vector<float> out((size_t)state.range(0));
+    RngLanes lanes(7);
+    for (auto _ : state) {
+        lanes.fill(out.data(), out.size(), 0, 800);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_RngLanesFill)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_TextureCacheHit(benchmark::State& state) {
+    HeadlessRenderer hr(64, 64);
+    if (!hr.renderer) { state.SkipWithError("software renderer unavailable"); for (auto _ : state) {} return; }
+    TextureManager tm(hr.renderer);
+    vector<string> paths;
+    for (long long i = 0; i < state.range(0); i++) {
+        paths.push_back("assets/sprites/texture_" + to_string(i) + ".png");
+        tm.cache[paths.back()] = SDL_CreateTexture(hr.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 1, 1);
+    }
+    for (auto _ : state) {
+        for (auto &p : paths) benchmark::DoNotOptimize(tm.load(p));
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_TextureCacheHit)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_FontCacheKey(benchmark::State& state) {
+    FontManager fm;
+    vector<string> paths;
+    for (long long i = 0; i < state.range(0); i++) {
+        paths.push_back("assets/fonts/font_" + to_string(i) + ".ttf");
+        fm.cache[paths.back() + "#" + to_string(24)] = nullptr; // cache hit path only, never opened
+    }
+    for (auto _ : state) {
+        for (auto &p : paths) benchmark::DoNotOptimize(fm.load(p, 24));
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+    fm.cache.clear();
+}
+BENCHMARK(BM_FontCacheKey)->RangeMultiplier(10)->Range(10, 10000);
+
+static void BM_RenderEntities(benchmark::State& state) {
+    HeadlessRenderer hr(800, 600);
+    if (!hr.renderer) { state.SkipWithError("software renderer unavailable"); for (auto _ : state) {} return; }
+    SDL_Texture* tex = SDL_CreateTexture(hr.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 32, 32);
+    World world; populateWorld(world, state.range(0), tex);
+    RenderDevice gfx(hr.renderer, 800, 600);
+    for (auto _ : state) {
+        gfx.beginFrame();
+        gfx.clear();
+        renderEntities(world, gfx);
+        gfx.endFrame();
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+    if (tex) SDL_DestroyTexture(tex);
+}
+BENCHMARK(BM_RenderEntities)->RangeMultiplier(10)->Range(10, 100000);
+
+// n live particles spread over the view (long lives, so none die mid-run; no drag, which over
+// that many steps would decay velocities into denormals)
+static void spawnParticles(ParticleSystem& ps, long long n) {
+    ParticleEffect fx;
+    fx.capacity = (size_t)n;
+    fx.lifeMin = 1e6f; fx.lifeMax = 1e6f;
+    fx.gravityY = 100.0f;
+    const int e = ps.addEffect(fx);
+    for (long long i = 0; i < n; i++) ps.burst(e, (float)(rand() % 800), (float)(rand() % 600), 1);
+}
+
+static void BM_ParticleUpdate(benchmark::State& state) {
+    ParticleSystem ps; spawnParticles(ps, state.range(0));
+    for (auto _ : state) {
+        ps.update(1.0f / 60.0f);
+        benchmark::DoNotOptimize(ps.live);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_ParticleUpdate)->RangeMultiplier(10)->Range(10, 1000000);
+
+// Quads built and rasterized by the software renderer, one geometry call per frame
+static void BM_ParticleRender(benchmark::State& state) {
+    HeadlessRenderer hr(800, 600);
+    if (!hr.renderer) { state.SkipWithError("software renderer unavailable"); for (auto _ : state) {} return; }
+    ParticleSystem ps; spawnParticles(ps, state.range(0));
+    RenderDevice gfx(hr.renderer, 800, 600);
+    for (auto _ : state) {
+        gfx.beginFrame();
+        gfx.clear();
+        ps.render(gfx);
+        gfx.endFrame();
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_ParticleRender)->RangeMultiplier(10)->Range(10, 1000000);
+
+// n timers scheduled 1-600 ticks out, then all cancelled
+static void BM_TimerScheduleCancel(benchmark::State& state) {
+    TimerWheel timers;
+    const int ch = timers.channel([](const vector<TimerEvent>&) {});
+    vector<TimerId> ids((size_t)state.range(0));
+    for (auto _ : state) {
+        for (size_t i = 0; i < ids.size(); i++) ids[i] = timers.schedule(ch, 1 + (i * 7919) % 600);
+        for (TimerId id : ids) timers.cancel(id);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_TimerScheduleCancel)->RangeMultiplier(10)->Range(10, 1000000);
+
+// One tick of n entities on repeating 1-600 tick cooldowns: fired timers are rescheduled by their
+// handler on the wheel, the scan decrements every countdown
+static void BM_TimerAdvance(benchmark::State& state) {
+    TimerWheel timers;
+    int ch = 0;
+    ch = timers.channel([&](const vector<TimerEvent>& events) {
+        for (auto &ev : events) timers.schedule(ch, 1 + (ev.data * 7919 + timers.now()) % 600, INVALID_ENTITY, ev.data);
+    });
+    for (long long i = 0; i < state.range(0); i++) timers.schedule(ch, 1 + (i * 7919) % 600, INVALID_ENTITY, (uint64_t)i);
+    for (auto _ : state) {
+        timers.advance();
+        benchmark::DoNotOptimize(timers.fired);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_TimerAdvance)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_CooldownScan(benchmark::State& state) {
+    vector<uint32_t> left((size_t)state.range(0));
+    for (size_t i = 0; i < left.size(); i++) left[i] = 1 + (i * 7919) % 600;
+    uint64_t tick = 0;
+    for (auto _ : state) {
+        tick++;
+        size_t fired = 0;
+        for (size_t i = 0; i < left.size(); i++) {
+            if (--left[i] != 0) continue;
+            left[i] = 1 + (i * 7919 + tick) % 600;
+            fired++;
+        }
+        benchmark::DoNotOptimize(fired);
+    }
+    state.SetItemsProcessed(state.iterations * state.range(0));
+}
+BENCHMARK(BM_CooldownScan)->RangeMultiplier(10)->Range(10, 1000000);
+
+// --------------------------- Runner ---------------------------
+struct RunOptions {
+    string filter;
+    double minTime = 0.2;
+    bool json = false;
+};
+
+// Grows the iteration count until one run takes at least minTime, like Google Benchmark does.
+static benchmark::State runCase(const benchmark::Case& c, long long arg, double minTime) {
+    long long iters = 1;
+    for (;;) {
+        srand(1);
+        benchmark::State st(arg, iters);
+        c.fn(st);
+        double secs = st.seconds();
+        if (!st.error.empty() || secs >= minTime || iters >= (1LL << 30)) return st;
+        double grow = secs > 0 ? minTime * 1.4 / secs : 10.0;
+        iters = std::max(iters + 1, (long long)(iters * std::min(grow, 10.0)));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    RunOptions opt;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) opt.filter = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) opt.minTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--json")) opt.json = true;
+        else { cerr << "Unknown argument: " << argv[i] << "\n"; return 2; }
+    }
+
+    if (!opt.json) printf("%-32s %14s %12s %16s\n", "Benchmark", "Time(ns/iter)", "Iterations", "Items/s");
+    else printf("{\"benchmarks\":[\n");
+    bool first = true;
+    for (auto &c : benchmark::registry()) {
+        for (long long arg : c->args) {
+            string name = c->name + "/" + to_string(arg);
+            if (!opt.filter.empty() && name.find(opt.filter) == string::npos) continue;
+            benchmark::State st = runCase(*c, arg, opt.minTime);
+            double nsPerIter = st.iterations > 0 ? st.seconds() * 1e9 / st.iterations : 0;
+            double itemsPerSec = st.seconds() > 0 ? st.items / st.seconds() : 0;
+            if (opt.json) {
+                printf("%s  {\"name\":\"%s\",\"entities\":%lld,\"iterations\":%lld,\"ns_per_iter\":%.1f,\"items_per_second\":%.1f,\"error\":\"%s\"}",
+                       first ? "" : ",\n", name.c_str(), arg, st.iterations, nsPerIter, itemsPerSec, st.error.c_str());
+            } else if (!st.error.empty()) {
+                printf("%-32s ERROR: %s\n", name.c_str(), st.error.c_str());
+            } else {
+                printf("%-32s %14.1f %12lld %16.4g\n", name.c_str(), nsPerIter, st.iterations, itemsPerSec);
+            }
+            first = false;
+            fflush(stdout);
+        }
+    }
+    if (opt.json) printf("\n]}\n");
+    return 0;
+}
@@ -6,12 +6,50 @@
 // - Resource managers: TextureManager, FontManager, AudioManager
 // - Basic Entity-Component system: Entity, Component, Transform, Sprite
 // - Simple Scene/World handling
+// - Prefabs: component sets with defaults, built in code or loaded from a text file;
+//   World::instantiate(prefab, count) allocates a whole batch's entities and components in one block per type
 // - Input handling (keyboard)
 // - Simple collision detection and movement system
+// - System scheduler: per-system tick rates (e.g. AI 10 Hz, physics 120 Hz) with phase offsets
+// - Frame profiler: per-phase frame-time histograms (p50/p95/p99/max), input record/replay,
+//   perf baseline comparison (demo flags: --record, --replay, --baseline, --write-baseline, --trace)
+// - RenderDevice: instrumented drawing (draw calls, vertices, texture binds, blend changes, pixels)
+// - CollisionWorld: Transform proxies, uniform-grid spatial hash or sweep-and-prune broadphase,
+//   AABB narrowphase, persistent contacts with batched Enter/Stay/Exit events, dynamic AABB tree for point/rect/radius/ray queries (used for render culling)
+// - Continuous collision: Collider::continuous entities are swept (time of impact), no tunnelling
+// - Batched AABB overlap kernel: one box against 8 SoA boxes per call (AVX2 / SSE2 / scalar)
+// - JobSystem: fork-join worker pool (EngineConfig::workerThreads); parallel grid broadphase and
+//   narrowphase with deterministic contact order, contact islands for independent resolution
+// - Collision layers: Collider::layer plus a layer x layer matrix (CollisionWorld::layers),
+//   filtered in the broadphase
+// - RigidBodySolver: sequential impulses with warm starting, restitution and friction on
+//   RigidBody entities, solved per contact island on the job system (configurable iterations)
+// - Sleeping bodies: resting Velocity bodies (SleepPolicy) and static ones skip integration and the
+//   per-tick broadphase; woken by a velocity write or a contact from a moving body
+// - SteeringSystem: Chase components steered toward their target entity in SoA batches
+//   (SIMD reciprocal square root, parallel on the job system), with optional separation from
+//   nearby chasers found through a SpatialHashGrid, capped at maxNeighbours each
+// - FlowField: one Dijkstra integration field per target over a cost grid, rebuilt across frames
+//   when the target changes cell; chasers of that target sample their direction in O(1)
+// - GridPathfinder: point-to-point A* on the same cost grids, with an HPA* cluster graph for large
+//   maps, a route cache per (start cluster, goal cluster) and a per-frame expansion budget
+// - Behavior trees: shared flat-array tree definitions, per-agent SoA blackboards, and a
+//   BehaviorSystem that evaluates a fixed number of agents per update, round-robin
+// - LodSystem: distance bands around a focus point; far agents are evaluated less often
+//   (staggered, with the elapsed time passed on) and far bodies fall asleep sooner
+// - RngService: xoshiro256** streams per name from one master seed (kept in input recordings),
+//   lock-free per-chunk streams with Rng::derive, 4-lane SIMD bulk floats, snapshots
+// - ParticleSystem: particles outside the ECS in SoA pools per effect, SIMD integration (gravity,
+//   drag) on the job system, rate emitters and bursts, one batched SDL_RenderGeometry per effect
+// - TimerWheel: hierarchical timing wheel for delays, cooldowns and respawns; O(1) schedule and
+//   cancel, due timers batched per channel each tick, advanced by ticks or by wall-clock seconds
 // - Example demo at the bottom showing how to use the engine
 // Requires: SDL2, SDL2_image, SDL2_ttf, SDL2_mixer
 // Build (Linux pkg-config):
-// g++ -std=c++17 -O2 -o engine sdl_game_engine.cpp `pkg-config --cflags --libs sdl2 SDL2_image SDL2_ttf SDL2_mixer`
+// g++ -std=c++17 -O2 -pthread -o engine sdl_game_engine.cpp `pkg-config --cflags --libs sdl2 SDL2_image SDL2_ttf SDL2_mixer`
+// (add -mavx2 or -march=native for the 8-wide overlap, steering and particle kernels; SSE2 is used otherwise)
+// Define SDL_ENGINE_NO_DEMO before including this file to use the engine without the demo main()
+// (see sdl_engine_bench.cpp and sdl_engine_microbench.cpp).
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -19,13 +57,34 @@
 #include <SDL2/SDL_mixer.h>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <map>
 #include <unordered_map>
 #include <vector>
+#include <deque>
 #include <memory>
 #include <functional>
 #include <cmath>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <climits>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -35,12 +94,28 @@ static void logSDLError(const string &msg) {
 }
 
 // --------------------------- Configuration ---------------------------
+// When a Velocity body goes to sleep: after `delay` seconds below `speed` (px/s). delay <= 0: never.
+struct SleepPolicy {
+    float speed = 1.0f;
+    float delay = 0.5f;
+};
+
 struct EngineConfig {
     int width = 800;
     int height = 600;
     string title = "SDL Mini Engine";
     int targetFPS = 60;
     bool vSync = false;
+    // frame profiling
+    bool reportFrameStats = true;                  // print percentiles on stop()
+    SDL_Scancode frameStatsKey = SDL_SCANCODE_F2;  // print them on demand
+    string recordInputPath;                        // record key transitions for later replay
+    string replayInputPath;                        // replay a recording with fixed dt, then quit
+    string frameTracePath;                         // per-frame CSV of phase times
+    int workerThreads = 0;                         // job system threads, main thread included; 0 = one per core
+    SleepPolicy sleep;                             // resting bodies skip physics and the broadphase
+    uint64_t seed = 0;                             // RngService master seed; 0 = from the clock, or the recording's on replay
+    int solverIterations = 8;                      // RigidBodySolver velocity iterations
 };
 
 // --------------------------- Window & Renderer ---------------------------
@@ -165,6 +240,364 @@ struct AudioManager {
     }
 };
 
+// --------------------------- Instrumented rendering ---------------------------
+// All engine drawing goes through RenderDevice so every frame's draw calls and state
+// changes are counted. Calls are forwarded as-is; the counters are what batching work is measured against.
+struct RenderStats {
+    Uint64 drawCalls = 0;     // RenderCopy/CopyEx/FillRect/Geometry/Clear
+    Uint64 vertices = 0;      // 4 per quad, actual count for geometry
+    Uint64 textureBinds = 0;  // textured draws whose texture differs from the previous one
+    Uint64 blendChanges = 0;  // draw blend mode actually changed
+    Uint64 colorSets = 0;     // SDL_SetRenderDrawColor calls
+    Uint64 pixelsFilled = 0;  // destination area, before clipping
+};
+
+struct RenderDevice {
+    SDL_Renderer* ren = nullptr;
+    int targetW = 0, targetH = 0;
+    RenderStats frame; // being accumulated
+    RenderStats last;  // previous complete frame
+
+    RenderDevice(SDL_Renderer* r = nullptr, int w = 0, int h = 0): ren(r), targetW(w), targetH(h) {}
+
+    void beginFrame() { frame = RenderStats(); boundTex = nullptr; }
+    void endFrame() { last = frame; }
+    SDL_BlendMode blendMode() const { return blend; }
+
+    void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+        frame.colorSets++;
+        SDL_SetRenderDrawColor(ren, r, g, b, a);
+    }
+    void setBlendMode(SDL_BlendMode m) {
+        if (m != blend) { frame.blendChanges++; blend = m; }
+        SDL_SetRenderDrawBlendMode(ren, m);
+    }
+    void clear() {
+        frame.drawCalls++; frame.vertices += 4;
+        frame.pixelsFilled += (Uint64)targetW * targetH;
+        SDL_RenderClear(ren);
+    }
+    void fillRect(const SDL_Rect& r) {
+        countQuad(&r);
+        SDL_RenderFillRect(ren, &r);
+    }
+    void copy(SDL_Texture* tex, const SDL_Rect* src, const SDL_Rect* dst) {
+        bindTexture(tex); countQuad(dst);
+        SDL_RenderCopy(ren, tex, src, dst);
+    }
+    void copyEx(SDL_Texture* tex, const SDL_Rect* src, const SDL_Rect* dst, double angle, SDL_RendererFlip flip = SDL_FLIP_NONE) {
+        bindTexture(tex); countQuad(dst);
+        SDL_RenderCopyEx(ren, tex, src, dst, angle, nullptr, flip);
+    }
+    void geometry(SDL_Texture* tex, const SDL_Vertex* verts, int numVerts, const int* indices, int numIndices) {
+        if (tex) bindTexture(tex);
+        frame.drawCalls++;
+        frame.vertices += numVerts;
+        // triangle areas, so particle batches report real coverage
+        double area = 0;
+        int tris = indices ? numIndices / 3 : numVerts / 3;
+        for (int t = 0; t < tris; t++) {
+            const SDL_FPoint& a = verts[indices ? indices[t*3] : t*3].position;
+            const SDL_FPoint& b = verts[indices ? indices[t*3+1] : t*3+1].position;
+            const SDL_FPoint& c = verts[indices ? indices[t*3+2] : t*3+2].position;
+            area += std::fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5;
+        }
+        frame.pixelsFilled += (Uint64)area;
+        SDL_RenderGeometry(ren, tex, verts, numVerts, indices, numIndices);
+    }
+
+private:
+    SDL_Texture* boundTex = nullptr;
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+
+    void bindTexture(SDL_Texture* tex) {
+        if (tex != boundTex) { frame.textureBinds++; boundTex = tex; }
+    }
+    void countQuad(const SDL_Rect* dst) {
+        frame.drawCalls++; frame.vertices += 4;
+        frame.pixelsFilled += dst ? (Uint64)std::max(0, dst->w) * (Uint64)std::max(0, dst->h) : (Uint64)targetW * targetH;
+    }
+};
+
+// --------------------------- Job system ---------------------------
+// Fork-join worker pool. parallelFor splits [0, count) into chunks that the workers and the
+// calling thread take in turn, and returns when all are done. Chunks are claimed dynamically, so
+// anything written per chunk must be merged in chunk order to keep results deterministic.
+struct JobSystem {
+    using RangeFn = function<void(size_t begin, size_t end, int worker)>;
+
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem() { stop(); }
+
+    // `threads` counts the caller; 0 = one per hardware thread
+    void start(int threads) {
+        stop();
+        if (threads <= 0) threads = (int)std::max(1u, thread::hardware_concurrency());
+        quit = false;
+        for (int i = 1; i < threads; i++) workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    void stop() {
+        if (workers.empty()) return;
+        { lock_guard<mutex> lock(m); quit = true; }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+        workers.clear();
+    }
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    // fn(begin, end, worker) over chunks of `grain`; worker is in [0, threadCount())
+    void parallelFor(size_t count, size_t grain, const RangeFn& fn) {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+        if (workers.empty() || count <= grain) { fn(0, count, 0); return; }
+        {
+            lock_guard<mutex> lock(m);
+            job = &fn; jobCount = count; jobGrain = grain;
+            next = 0;
+            pending = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        runChunks(0);
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [&] { return pending == 0; });
+        job = nullptr;
+    }
+
+    // Number of chunks parallelFor will use, for sizing per-chunk output buffers
+    static size_t chunkCount(size_t count, size_t grain) { grain = std::max<size_t>(grain, 1); return (count + grain - 1) / grain; }
+
+private:
+    vector<thread> workers;
+    mutex m;
+    condition_variable wake, done;
+    const RangeFn* job = nullptr;
+    size_t jobCount = 0, jobGrain = 1;
+    atomic<size_t> next{ 0 };
+    int pending = 0;
+    uint64_t generation = 0;
+    bool quit = false;
+
+    void runChunks(int worker) {
+        for (;;) {
+            size_t begin = next.fetch_add(jobGrain);
+            if (begin >= jobCount) return;
+            (*job)(begin, std::min(begin + jobGrain, jobCount), worker);
+        }
+    }
+
+    void workerLoop(int worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            runChunks(worker);
+            {
+                lock_guard<mutex> lock(m);
+                if (--pending == 0) done.notify_one();
+            }
+        }
+    }
+};
+
+// --------------------------- Random numbers ---------------------------
+// xoshiro256** (Blackman & Vigna): 256 bits of state, period 2^256 - 1, a handful of shifts, adds
+// and xors per number, and no shared state, unlike rand(). Seeds go through SplitMix64, so
+// nearby seeds give unrelated streams. An Rng is a plain value: a copy is a snapshot, and
+// restoring the copy replays the same numbers.
+inline uint64_t splitMix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+inline uint64_t rotl64(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+struct Rng {
+    uint64_t s[4];
+
+    explicit Rng(uint64_t seed = 1) { reseed(seed); }
+    void reseed(uint64_t seed) { for (auto &w : s) w = splitMix64(seed); }
+
+    uint64_t next() {
+        const uint64_t out = rotl64(s[1] * 5, 7) * 9, t = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl64(s[3], 45);
+        return out;
+    }
+    uint32_t nextU32() { return (uint32_t)(next() >> 32); }
+    float uniform() { return (float)(next() >> 40) * 0x1p-24f; } // [0, 1), 24 bits
+    float range(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+    // Uniform in [0, n) without the modulo bias of rand() % n (Lemire's multiply-shift, redrawing
+    // the few values that would favour low results); n > 0
+    uint32_t below(uint32_t n) {
+        uint64_t m = (uint64_t)nextU32() * n;
+        if ((uint32_t)m < n) {
+            const uint32_t floor = (0u - n) % n;
+            while ((uint32_t)m < floor) m = (uint64_t)nextU32() * n;
+        }
+        return (uint32_t)(m >> 32);
+    }
+    // An independent stream numbered `id` (a job chunk, an entity) branched off this one, which is
+    // left untouched: the same state and id always give the same stream
+    Rng derive(uint64_t id) const {
+        uint64_t x = s[0] ^ rotl64(s[1], 17) ^ rotl64(s[2], 31) ^ rotl64(s[3], 47);
+        uint64_t k = id;
+        return Rng(splitMix64(x) ^ splitMix64(k));
+    }
+};
+
+// Four xoshiro256** generators stepped together for bulk floats (particle spawning): AVX2 steps
+// all four with one register per state word, SSE2 two at a time, otherwise a scalar loop. Every
+// path gives the same numbers.
+struct RngLanes {
+    static const int Count = 4;
+    alignas(32) uint64_t s[4][Count]; // [state word][lane]
+
+    explicit RngLanes(uint64_t seed = 1) { reseed(seed); }
+    void reseed(uint64_t seed) {
+        const Rng base(seed);
+        for (int l = 0; l < Count; l++) {
+            Rng r = base.derive((uint64_t)l);
+            for (int w = 0; w < 4; w++) s[w][l] = r.s[w];
+        }
+    }
+
+    // n floats uniform in [lo, hi), lane 0 first within each group of four. A call starts a new
+    // group, so a count that isn't a multiple of 4 drops the spare numbers of the last group.
+    void fill(float* out, size_t n, float lo, float hi) {
+        const float scale = (hi - lo) * 0x1p-24f;
+        size_t i = 0;
+#if defined(__AVX2__)
+        __m256i s0 = _mm256_load_si256((const __m256i*)s[0]), s1 = _mm256_load_si256((const __m256i*)s[1]);
+        __m256i s2 = _mm256_load_si256((const __m256i*)s[2]), s3 = _mm256_load_si256((const __m256i*)s[3]);
+        const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        const __m128 vs = _mm_set1_ps(scale), vlo = _mm_set1_ps(lo);
+        for (; i < n; i += Count) {
+            // rotl(s1 * 5, 7) * 9, the multiplies as shift-adds (there is no 64-bit lane multiply)
+            __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+            x = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+            x = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+            __m256i t = _mm256_slli_epi64(s1, 17);
+            s2 = _mm256_xor_si256(s2, s0); s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2); s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+            // top 24 bits of each lane, gathered from the low halves of the 64-bit lanes
+            __m128i bits = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_srli_epi64(x, 40), low));
+            __m128 f = _mm_add_ps(vlo, _mm_mul_ps(_mm_cvtepi32_ps(bits), vs));
+            if (n - i >= (size_t)Count) _mm_storeu_ps(out + i, f);
+            else { float tmp[Count]; _mm_storeu_ps(tmp, f); for (size_t k = 0; i + k < n; k++) out[i + k] = tmp[k]; }
+        }
+        _mm256_store_si256((__m256i*)s[0], s0); _mm256_store_si256((__m256i*)s[1], s1);
+        _mm256_store_si256((__m256i*)s[2], s2); _mm256_store_si256((__m256i*)s[3], s3);
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 vs = _mm_set1_ps(scale), vlo = _mm_set1_ps(lo);
+        __m128i st[4][2];
+        for (int w = 0; w < 4; w++) { st[w][0] = _mm_load_si128((const __m128i*)&s[w][0]); st[w][1] = _mm_load_si128((const __m128i*)&s[w][2]); }
+        for (; i < n; i += Count) {
+            __m128i bits[2];
+            for (int h = 0; h < 2; h++) {
+                __m128i &s0 = st[0][h], &s1 = st[1][h], &s2 = st[2][h], &s3 = st[3][h];
+                __m128i x = _mm_add_epi64(_mm_slli_epi64(s1, 2), s1);
+                x = _mm_or_si128(_mm_slli_epi64(x, 7), _mm_srli_epi64(x, 57));
+                x = _mm_add_epi64(_mm_slli_epi64(x, 3), x);
+                __m128i t = _mm_slli_epi64(s1, 17);
+                s2 = _mm_xor_si128(s2, s0); s3 = _mm_xor_si128(s3, s1);
+                s1 = _mm_xor_si128(s1, s2); s0 = _mm_xor_si128(s0, s3);
+                s2 = _mm_xor_si128(s2, t);
+                s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+                bits[h] = _mm_shuffle_epi32(_mm_srli_epi64(x, 40), _MM_SHUFFLE(2, 0, 2, 0)); // low halves first
+            }
+            __m128 f = _mm_add_ps(vlo, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi64(bits[0], bits[1])), vs));
+            if (n - i >= (size_t)Count) _mm_storeu_ps(out + i, f);
+            else { float tmp[Count]; _mm_storeu_ps(tmp, f); for (size_t k = 0; i + k < n; k++) out[i + k] = tmp[k]; }
+        }
+        for (int w = 0; w < 4; w++) { _mm_store_si128((__m128i*)&s[w][0], st[w][0]); _mm_store_si128((__m128i*)&s[w][2], st[w][1]); }
+#else
+        for (; i < n; i += Count) {
+            for (int l = 0; l < Count; l++) {
+                const uint64_t x = rotl64(s[1][l] * 5, 7) * 9, t = s[1][l] << 17;
+                s[2][l] ^= s[0][l]; s[3][l] ^= s[1][l]; s[1][l] ^= s[2][l]; s[0][l] ^= s[3][l];
+                s[2][l] ^= t;
+                s[3][l] = rotl64(s[3][l], 45);
+                if (i + l < n) out[i + l] = lo + (float)(int32_t)(x >> 40) * scale;
+            }
+        }
+#endif
+    }
+};
+
+// The engine's random numbers: named streams derived from one master seed. A system asks for its
+// stream once and keeps the reference (stable for the service's lifetime), and a stream's numbers
+// depend only on the seed and its name, so adding a stream elsewhere doesn't shift them.
+// stream() and bulk() aren't thread-safe; parallel jobs branch a stream per chunk off their
+// system's with Rng::derive(chunk), which needs no locking and gives the same numbers on any
+// number of threads. snapshot()/restore() capture and rewind every stream for replays.
+struct RngService {
+    struct Snapshot {
+        uint64_t master = 1;
+        vector<pair<string, Rng>> streams;
+        vector<pair<string, RngLanes>> bulk;
+    };
+
+    // Restarts every stream from `master`
+    void seed(uint64_t master) {
+        masterSeed = master;
+        for (auto &kv : streams) kv.second.reseed(streamSeed(kv.first));
+        for (auto &kv : bulkStreams) kv.second.reseed(bulkSeed(kv.first));
+    }
+    uint64_t seed() const { return masterSeed; }
+
+    Rng& stream(const string& name) {
+        auto it = streams.find(name);
+        if (it == streams.end()) it = streams.emplace(name, Rng(streamSeed(name))).first;
+        return it->second;
+    }
+    RngLanes& bulk(const string& name) {
+        auto it = bulkStreams.find(name);
+        if (it == bulkStreams.end()) it = bulkStreams.emplace(name, RngLanes(bulkSeed(name))).first;
+        return it->second;
+    }
+
+    Snapshot snapshot() const {
+        Snapshot snap;
+        snap.master = masterSeed;
+        snap.streams.assign(streams.begin(), streams.end());
+        snap.bulk.assign(bulkStreams.begin(), bulkStreams.end());
+        return snap;
+    }
+    // Streams in the snapshot go back to their state then; streams made since restart from the seed
+    void restore(const Snapshot& snap) {
+        seed(snap.master);
+        for (auto &kv : snap.streams) stream(kv.first) = kv.second;
+        for (auto &kv : snap.bulk) bulk(kv.first) = kv.second;
+    }
+
+private:
+    uint64_t masterSeed = 1;
+    unordered_map<string, Rng> streams;        // node-based: references survive new streams
+    unordered_map<string, RngLanes> bulkStreams;
+
+    uint64_t streamSeed(const string& name) const {
+        uint64_t h = 0xCBF29CE484222325ull; // FNV-1a
+        for (unsigned char c : name) { h ^= c; h *= 0x100000001B3ull; }
+        uint64_t x = masterSeed;
+        return splitMix64(x) ^ h;
+    }
+    // Bulk streams get their own keys, so bulk("x") and stream("x") don't repeat each other
+    uint64_t bulkSeed(const string& name) const { return streamSeed("bulk:" + name); }
+};
+
 // --------------------------- ECS (very small) ---------------------------
 using EntityId = unsigned int;
 static const EntityId INVALID_ENTITY = 0;
@@ -184,8 +617,37 @@ struct Sprite : Component {
     float scale = 1.0f;
 };
 
+// A body that rests long enough falls asleep (see SleepPolicy): physicsSystem skips it and
+// collision keeps it out of the per-tick broadphase. Writing a non-zero velocity wakes it, and so
+// does a contact from a moving body.
 struct Velocity : Component {
     float vx=0, vy=0;
+    bool asleep = false;
+    float restTime = 0; // seconds spent below the sleep speed
+    void wake() { asleep = false; restTime = 0; }
+};
+
+// Collision settings. Entities with a Transform collide without one (on layer 0).
+struct Collider : Component {
+    bool continuous = false; // fast mover: swept from where it was last tick, so it can't tunnel
+    uint8_t layer = 0;       // 0..31; which layers it meets is set in CollisionWorld::layers
+};
+
+// Solid body for RigidBodySolver. Contacts are only resolved between two RigidBodies; an entity
+// without one (a pickup) still gets contact events. Moves only with a Velocity.
+struct RigidBody : Component {
+    float mass = 1.0f;        // 0 = immovable
+    float restitution = 0.0f; // bounciness, 0..1; a pair uses the larger
+    float friction = 0.3f;    // a pair uses the geometric mean
+};
+
+// Steers the entity toward the center of `target` (see SteeringSystem). Needs a Transform and a
+// Velocity; the Velocity is overwritten each steering update, zero while the target is missing
+// or out of range.
+struct Chase : Component {
+    EntityId target = INVALID_ENTITY;
+    float speed = 100.0f; // px/s
+    float range = 0;      // only chase while the centers are this close, px; 0 = any distance
 };
 
 struct Entity {
@@ -208,6 +670,186 @@ struct Entity {
     }
 };
 
+// --------------------------- Prefabs ---------------------------
+// A Prefab is a set of components with default values that World::instantiate copies in bulk:
+// each component type gets one block for the whole batch, copy-constructed from the prefab's
+// prototype, and the instances' shared_ptrs alias into it (as do the Entity objects), so a batch
+// costs a few allocations per component type instead of one per component. In exchange a block
+// is only freed once every instance in its batch is gone; World::destroyEntity releases the
+// instance's own components right away, so only its slots in the blocks wait.
+using PrefabTextures = function<SDL_Texture*(const string&)>; // texture path -> texture, for prefab files
+
+// `value` as a number; false unless all of it parsed
+inline bool parsePrefabNumber(const string& value, float& out) {
+    char* end = nullptr;
+    out = strtof(value.c_str(), &end);
+    return end != value.c_str() && *end == 0;
+}
+
+// The fields a prefab file can set, per component type (none for a type without an overload)
+template<typename T>
+bool setPrefabField(T&, const string&, const string&, const PrefabTextures&) { return false; }
+inline bool setPrefabField(Transform& c, const string& field, const string& value, const PrefabTextures&) {
+    float* f = field == "x" ? &c.x : field == "y" ? &c.y : field == "w" ? &c.w : field == "h" ? &c.h : field == "angle" ? &c.angle : nullptr;
+    return f && parsePrefabNumber(value, *f);
+}
+inline bool setPrefabField(Sprite& c, const string& field, const string& value, const PrefabTextures& texture) {
+    if (field == "texture") { c.texture = texture ? texture(value) : nullptr; return c.texture != nullptr; }
+    if (field == "scale") return parsePrefabNumber(value, c.scale);
+    int* i = field == "srcX" ? &c.srcX : field == "srcY" ? &c.srcY : field == "srcW" ? &c.srcW : field == "srcH" ? &c.srcH : nullptr;
+    float n;
+    if (!i || !parsePrefabNumber(value, n)) return false;
+    *i = (int)n;
+    return true;
+}
+inline bool setPrefabField(Velocity& c, const string& field, const string& value, const PrefabTextures&) {
+    float* f = field == "vx" ? &c.vx : field == "vy" ? &c.vy : nullptr;
+    return f && parsePrefabNumber(value, *f);
+}
+inline bool setPrefabField(Collider& c, const string& field, const string& value, const PrefabTextures&) {
+    float n;
+    if (!parsePrefabNumber(value, n)) return false;
+    if (field == "continuous") { c.continuous = n != 0; return true; }
+    if (field == "layer" && n >= 0 && n < 32) { c.layer = (uint8_t)n; return true; }
+    return false;
+}
+inline bool setPrefabField(RigidBody& c, const string& field, const string& value, const PrefabTextures&) {
+    float* f = field == "mass" ? &c.mass : field == "restitution" ? &c.restitution : field == "friction" ? &c.friction : nullptr;
+    return f && parsePrefabNumber(value, *f);
+}
+inline bool setPrefabField(Chase& c, const string& field, const string& value, const PrefabTextures&) {
+    float* f = field == "speed" ? &c.speed : field == "range" ? &c.range : nullptr;
+    return f && parsePrefabNumber(value, *f);
+}
+
+// One component of a prefab: its prototype, and how to copy it into a batch
+struct PrefabPart {
+    virtual ~PrefabPart() = default;
+    virtual Component& prototype() = 0;
+    // Appends a copy of the prototype to each of the `count` entities, all from one block
+    virtual void instantiate(Entity* entities, size_t count) const = 0;
+    // Sets a field from its text form; false for an unknown field or a bad value
+    virtual bool set(const string& field, const string& value, const PrefabTextures& texture) = 0;
+};
+
+template<typename T>
+struct PrefabPartOf : PrefabPart {
+    T proto;
+    Component& prototype() override { return proto; }
+    void instantiate(Entity* entities, size_t count) const override {
+        auto block = make_shared<vector<T>>(count, proto);
+        for (size_t i = 0; i < count; i++) {
+            T& c = (*block)[i];
+            c.owner = entities[i].id;
+            entities[i].components.push_back(shared_ptr<Component>(block, &c));
+        }
+    }
+    bool set(const string& field, const string& value, const PrefabTextures& texture) override {
+        return setPrefabField(proto, field, value, texture);
+    }
+};
+
+struct Prefab {
+    string name;
+    vector<unique_ptr<PrefabPart>> parts;
+
+    // Component T of the prefab, added with its default values if it has none yet, for setting defaults
+    template<typename T> T& add() { return static_cast<T&>(part<T>().prototype()); }
+    template<typename T> T* get() {
+        for (auto &p : parts) if (T* c = dynamic_cast<T*>(&p->prototype())) return c;
+        return nullptr;
+    }
+    template<typename T> PrefabPart& part() {
+        for (auto &p : parts) if (dynamic_cast<T*>(&p->prototype())) return *p;
+        parts.push_back(make_unique<PrefabPartOf<T>>());
+        return *parts.back();
+    }
+};
+
+// Component types by the name prefab files use; adds the type to `p` if it lacks it. nullptr for
+// an unknown name.
+inline PrefabPart* prefabPart(Prefab& p, const string& type) {
+    if (type == "Transform") return &p.part<Transform>();
+    if (type == "Sprite") return &p.part<Sprite>();
+    if (type == "Velocity") return &p.part<Velocity>();
+    if (type == "Collider") return &p.part<Collider>();
+    if (type == "RigidBody") return &p.part<RigidBody>();
+    if (type == "Chase") return &p.part<Chase>();
+    return nullptr;
+}
+
+// Named prefabs, built in code with add() or read from a text file:
+//   sdl-engine-prefabs 1
+//   prefab enemy
+//   Transform w 48 h 48
+//   Sprite texture enemy.png
+//   Velocity
+//   Collider layer 1
+//   RigidBody mass 3 restitution 0.5
+//   Chase speed 90
+//   end
+// One component per line: its type, then field/value pairs (fields left out keep the defaults);
+// '#' starts a comment. Texture paths go through `texture` (Engine::loadPrefabs passes its
+// TextureManager); a texture that doesn't load, or any texture without `texture`, is a bad value.
+// A prefab read again replaces the earlier definition.
+struct PrefabLibrary {
+    map<string, Prefab> prefabs;
+
+    Prefab& add(const string& name) {
+        Prefab& p = prefabs[name];
+        p.name = name;
+        return p;
+    }
+    Prefab* find(const string& name) {
+        auto it = prefabs.find(name);
+        return it != prefabs.end() ? &it->second : nullptr;
+    }
+
+    bool load(const string& path, const PrefabTextures& texture = nullptr) {
+        ifstream in(path);
+        if (!in) { cerr << "Cannot read prefabs " << path << "\n"; return false; }
+        return parse(in, path, texture);
+    }
+    // Stops at the first error, keeping the prefabs completed before it
+    bool parse(istream& in, const string& source, const PrefabTextures& texture = nullptr) {
+        string line, magic;
+        int version = 0, lineNo = 1;
+        if (getline(in, line)) istringstream(line) >> magic >> version;
+        if (magic != "sdl-engine-prefabs" || version != 1) { cerr << "Not a prefab file: " << source << "\n"; return false; }
+        auto fail = [&](const string& what) { cerr << source << ":" << lineNo << ": " << what << "\n"; return false; };
+        Prefab building;
+        bool open = false;
+        while (getline(in, line)) {
+            lineNo++;
+            istringstream words(line.substr(0, line.find('#')));
+            string word;
+            if (!(words >> word)) continue;
+            if (word == "prefab") {
+                if (open) return fail("prefab " + building.name + " has no end");
+                building = Prefab();
+                if (!(words >> building.name)) return fail("prefab without a name");
+                open = true;
+            } else if (word == "end") {
+                if (!open) return fail("end outside a prefab");
+                string name = building.name;
+                prefabs[name] = std::move(building);
+                open = false;
+            } else {
+                if (!open) return fail(word + " outside a prefab");
+                PrefabPart* part = prefabPart(building, word);
+                if (!part) return fail("unknown component type " + word);
+                string field, value;
+                while (words >> field) {
+                    if (!(words >> value)) return fail(word + " " + field + " has no value");
+                    if (!part->set(field, value, texture)) return fail("bad " + word + " field: " + field + " " + value);
+                }
+            }
+        }
+        if (open) return fail("prefab " + building.name + " has no end");
+        return true;
+    }
+};
+
 // --------------------------- Simple World/Scene ---------------------------
 struct World {
     EntityId nextId = 1;
@@ -219,8 +861,30 @@ struct World {
         entities[e->id] = e;
         return e;
     }
+    // `count` entities built from `prefab`, with consecutive ids; returns the first (INVALID_ENTITY
+    // for none). The entities and each component type are allocated once for the batch (see Prefab).
+    EntityId instantiate(const Prefab& prefab, size_t count) {
+        if (count == 0) return INVALID_ENTITY;
+        const EntityId first = nextId;
+        nextId += (EntityId)count;
+        auto block = make_shared<vector<Entity>>(count);
+        Entity* batch = block->data();
+        for (size_t i = 0; i < count; i++) {
+            batch[i].id = first + (EntityId)i;
+            batch[i].components.reserve(prefab.parts.size());
+        }
+        for (auto &part : prefab.parts) part->instantiate(batch, count);
+        entities.reserve(entities.size() + count);
+        for (size_t i = 0; i < count; i++) entities.emplace(batch[i].id, shared_ptr<Entity>(block, &batch[i]));
+        return first;
+    }
+    // Drops the entity's components too, even while someone still holds the Entity: a batch
+    // instance's Entity stays in its batch's block until the whole batch is gone
     void destroyEntity(EntityId id) {
-        entities.erase(id);
+        auto it = entities.find(id);
+        if (it == entities.end()) return;
+        it->second->components.clear();
+        entities.erase(it);
     }
     vector<shared_ptr<Entity>> all() {
         vector<shared_ptr<Entity>> out;
@@ -230,217 +894,3706 @@ struct World {
     }
 };
 
-// --------------------------- Input ---------------------------
-struct InputState {
-    unordered_map<SDL_Scancode, bool> keys;
-    bool quit = false;
-    void reset() { keys.clear(); quit = false; }
-};
-
-// --------------------------- Engine ---------------------------
-class Engine {
-public:
-    Engine(const EngineConfig& cfg): cfg(cfg) {}
-    ~Engine(){ stop(); }
-
-    bool init() {
-        if (!window.create(cfg)) return false;
-        texman = make_unique<TextureManager>(window.renderer);
-        fontman = make_unique<FontManager>();
-        audioman = make_unique<AudioManager>();
-        world = make_unique<World>();
-        running = true;
-        return true;
-    }
+// --------------------------- Collision ---------------------------
+// Simple AABB collision check
+bool aabbIntersect(const Transform& a, const Transform& b) {
+    return !(a.x + a.w < b.x || a.x > b.x + b.w || a.y + a.h < b.y || a.y > b.y + b.h);
+}
 
-    void run(function<void(Engine&)> onUpdate = nullptr, function<void(Engine&)> onRender = nullptr) {
-        const int frameDelay = 1000 / cfg.targetFPS;
-        Uint32 frameStart;
-        int frameTime;
+struct AABB { float minX = 0, minY = 0, maxX = 0, maxY = 0; };
 
-        while (running) {
-            frameStart = SDL_GetTicks();
-            // input
-            SDL_Event e;
-            while (SDL_PollEvent(&e)) {
-                if (e.type == SDL_QUIT) { running = false; }
-                else if (e.type == SDL_KEYDOWN) {
-                    input.keys[e.key.keysym.scancode] = true;
-                } else if (e.type == SDL_KEYUP) {
-                    input.keys[e.key.keysym.scancode] = false;
-                }
-            }
+inline AABB boxOf(const Transform& t) { return { t.x, t.y, t.x + t.w, t.y + t.h }; }
 
-            // update
-            if (onUpdate) onUpdate(*this);
+// Same inclusive test as aabbIntersect (touching edges count). `&` rather than `&&`:
+// no branches, which matters when the result is a coin flip in broadphase loops.
+inline bool aabbOverlap(const AABB& a, const AABB& b) {
+    return (a.maxX >= b.minX) & (a.minX <= b.maxX) & (a.maxY >= b.minY) & (a.minY <= b.maxY);
+}
 
-            // render
-            SDL_SetRenderDrawColor(window.renderer, 20, 20, 20, 255);
-            SDL_RenderClear(window.renderer);
-            if (onRender) onRender(*this);
-            SDL_RenderPresent(window.renderer);
+inline AABB combine(const AABB& a, const AABB& b) {
+    return { std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+}
+inline float perimeter(const AABB& b) { return 2.0f * ((b.maxX - b.minX) + (b.maxY - b.minY)); }
+inline bool contains(const AABB& outer, const AABB& inner) {
+    return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.maxX >= inner.maxX && outer.maxY >= inner.maxY;
+}
 
-            // frame cap
-            frameTime = SDL_GetTicks() - frameStart;
-            if (frameDelay > frameTime) SDL_Delay(frameDelay - frameTime);
-        }
+// Swept test: `a` moves by (vx, vy) over one step while `b` stays put (pass relative motion when
+// both move). On a hit, toi is the first time in [0, 1] the boxes touch; 0 if they start overlapping.
+inline bool sweepAABB(const AABB& a, float vx, float vy, const AABB& b, float& toi) {
+    float enter = 0, exit = 1;
+    const float v[2] = { vx, vy };
+    const float aLo[2] = { a.minX, a.minY }, aHi[2] = { a.maxX, a.maxY }, bLo[2] = { b.minX, b.minY }, bHi[2] = { b.maxX, b.maxY };
+    for (int k = 0; k < 2; k++) {
+        if (v[k] == 0) { if (aHi[k] < bLo[k] || aLo[k] > bHi[k]) return false; continue; }
+        float t0 = (bLo[k] - aHi[k]) / v[k], t1 = (bHi[k] - aLo[k]) / v[k];
+        if (t0 > t1) std::swap(t0, t1);
+        enter = std::max(enter, t0); exit = std::min(exit, t1);
+        if (enter > exit) return false;
     }
+    toi = enter;
+    return true;
+}
 
-    void stop() { if (running) { running=false; window.destroy(); texman->clear(); fontman->clear(); audioman->cleanup(); }}
+// Boxes as separate min/max arrays (SoA) for the batched overlap test. Storage is padded with
+// OverlapLanes never-overlapping boxes, so a batch may start at any index below size().
+static const int OverlapLanes = 8;
 
-    // helpers for demo usage
-    SDL_Texture* loadTexture(const string& path) { return texman->load(path); }
-    TTF_Font* loadFont(const string& path, int size) { return fontman->load(path,size); }
-    Mix_Chunk* loadSfx(const string& path) { return audioman->loadSfx(path); }
-    Mix_Music* loadMusic(const string& path) { return audioman->loadMusic(path); }
+struct AABBLanes {
+    vector<float> minX, minY, maxX, maxY;
 
-    World& getWorld() { return *world; }
-    SDL_Renderer* renderer() { return window.renderer; }
-    EngineConfig cfg;
-    InputState input;
+    size_t size() const { return count; }
+    void resize(size_t n) {
+        count = n;
+        // empty boxes (min > max) fail every comparison, even against infinite query boxes
+        minX.assign(n + OverlapLanes, INFINITY); minY.assign(n + OverlapLanes, INFINITY);
+        maxX.assign(n + OverlapLanes, -INFINITY); maxY.assign(n + OverlapLanes, -INFINITY);
+    }
+    void set(size_t i, const AABB& b) { minX[i] = b.minX; minY[i] = b.minY; maxX[i] = b.maxX; maxY[i] = b.maxY; }
+    AABB get(size_t i) const { return { minX[i], minY[i], maxX[i], maxY[i] }; }
 
 private:
-    GLWindow window;
-    unique_ptr<TextureManager> texman;
-    unique_ptr<FontManager> fontman;
-    unique_ptr<AudioManager> audioman;
-    unique_ptr<World> world;
-    bool running = false;
+    size_t count = 0;
 };
 
-// --------------------------- Simple Systems ---------------------------
-
-// Draw all entities which have Transform + Sprite
-void renderEntities(Engine& eng) {
-    auto ents = eng.getWorld().all();
-    for (auto &e : ents) {
-        auto t = e->getComponent<Transform>();
-        auto s = e->getComponent<Sprite>();
-        if (!t) continue;
-        if (s && s->texture) {
-            SDL_Rect dst = { (int)std::round(t->x), (int)std::round(t->y), (int)std::round(t->w * s->scale), (int)std::round(t->h * s->scale) };
-            if (s->srcW>0 && s->srcH>0) {
-                SDL_Rect src = { s->srcX, s->srcY, s->srcW, s->srcH };
-                SDL_RenderCopyEx(eng.renderer(), s->texture, &src, &dst, t->angle, nullptr, SDL_FLIP_NONE);
-            } else {
-                SDL_RenderCopyEx(eng.renderer(), s->texture, nullptr, &dst, t->angle, nullptr, SDL_FLIP_NONE);
-            }
-        } else {
-            // fallback rectangle
-            SDL_SetRenderDrawColor(eng.renderer(), 255, 0, 255, 255);
-            SDL_Rect r = { (int)std::round(t->x), (int)std::round(t->y), (int)std::round(t->w), (int)std::round(t->h) };
-            SDL_RenderFillRect(eng.renderer(), &r);
-        }
+// Bit k set when `box` overlaps lanes box first+k (k < 8), with the same inclusive test as
+// aabbOverlap. AVX2 does 8 boxes per compare, SSE2 4, otherwise a scalar loop; build with
+// -mavx2 (or -march=native) to get the 8-wide path.
+inline uint32_t overlapMask(const AABB& box, const AABBLanes& l, size_t first) {
+#if defined(__AVX2__)
+    __m256 m = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&l.minX[first]), _mm256_set1_ps(box.maxX), _CMP_LE_OQ),
+                      _mm256_cmp_ps(_mm256_loadu_ps(&l.maxX[first]), _mm256_set1_ps(box.minX), _CMP_GE_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&l.minY[first]), _mm256_set1_ps(box.maxY), _CMP_LE_OQ),
+                      _mm256_cmp_ps(_mm256_loadu_ps(&l.maxY[first]), _mm256_set1_ps(box.minY), _CMP_GE_OQ)));
+    return (uint32_t)_mm256_movemask_ps(m);
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128 bx0 = _mm_set1_ps(box.minX), bx1 = _mm_set1_ps(box.maxX);
+    const __m128 by0 = _mm_set1_ps(box.minY), by1 = _mm_set1_ps(box.maxY);
+    uint32_t bits = 0;
+    for (int h = 0; h < OverlapLanes; h += 4) {
+        size_t i = first + h;
+        __m128 m = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&l.minX[i]), bx1), _mm_cmpge_ps(_mm_loadu_ps(&l.maxX[i]), bx0)),
+            _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&l.minY[i]), by1), _mm_cmpge_ps(_mm_loadu_ps(&l.maxY[i]), by0)));
+        bits |= (uint32_t)_mm_movemask_ps(m) << h;
     }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (int k = 0; k < OverlapLanes; k++) bits |= (uint32_t)aabbOverlap(box, l.get(first + k)) << k;
+    return bits;
+#endif
 }
 
-// Basic physics: apply velocity to transform
-void physicsSystem(Engine& eng) {
-    auto ents = eng.getWorld().all();
-    for (auto &e : ents) {
-        auto t = e->getComponent<Transform>();
-        auto v = e->getComponent<Velocity>();
-        if (t && v) {
-            t->x += v->vx;
-            t->y += v->vy;
-            // simple bounds clamp
-            if (t->x < 0) t->x = 0;
-            if (t->y < 0) t->y = 0;
-            if (t->x + t->w > eng.cfg.width) t->x = eng.cfg.width - t->w;
-            if (t->y + t->h > eng.cfg.height) t->y = eng.cfg.height - t->h;
-        }
-    }
+inline int lowestBit(uint32_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(m);
+#else
+    int k = 0; while (!(m & 1u)) { m >>= 1; k++; } return k;
+#endif
 }
 
-// Simple AABB collision check
-bool aabbIntersect(const Transform& a, const Transform& b) {
-    return !(a.x + a.w < b.x || a.x > b.x + b.w || a.y + a.h < b.y || a.y > b.y + b.h);
+// f(i) for every lanes box in [from, to) that overlaps `box`
+template<typename F>
+void forEachOverlap(const AABB& box, const AABBLanes& l, size_t from, size_t to, F&& f) {
+    for (size_t i = from; i < to; i += OverlapLanes) {
+        uint32_t m = overlapMask(box, l, i);
+        if (to - i < (size_t)OverlapLanes) m &= (1u << (to - i)) - 1;
+        while (m) { f(i + lowestBit(m)); m &= m - 1; }
+    }
 }
 
-// --------------------------- Demo Game Using Engine ---------------------------
-
-// The demo is a small game: player moves with WASD/arrow, collects targets, enemy chases player.
-int main(int argc, char* argv[]) {
-    EngineConfig cfg;
-    cfg.width = 800; cfg.height = 600; cfg.title = "Engine Demo"; cfg.targetFPS = 60;
+// Which collision layers meet: a symmetric 32x32 bit matrix, everything on by default.
+// The broadphase drops pairs of layers that don't, so they never reach the narrowphase.
+struct CollisionLayers {
+    static const int Count = 32;
+    uint32_t masks[Count];
 
-    Engine eng(cfg);
-    if (!eng.init()) { cerr << "Engine init failed\n"; return 1; }
+    CollisionLayers() { for (auto &m : masks) m = ~0u; }
+    void set(int a, int b, bool collide) {
+        if (collide) { masks[a] |= 1u << b; masks[b] |= 1u << a; }
+        else { masks[a] &= ~(1u << b); masks[b] &= ~(1u << a); }
+    }
+    bool collides(int a, int b) const { return (masks[a] >> b) & 1u; }
+};
 
-    // Load assets (placeholders if you don't have assets)
-    SDL_Texture* playerTex = eng.loadTexture("player.png");
-    SDL_Texture* targetTex = eng.loadTexture("target.png");
-    SDL_Texture* enemyTex = eng.loadTexture("enemy.png");
-    SDL_Texture* bgTex = eng.loadTexture("bg.png");
-    TTF_Font* font = eng.loadFont("font.ttf", 24);
-    Mix_Chunk* sfx = eng.loadSfx("hit.wav");
-    Mix_Music* music = eng.loadMusic("music.ogg");
-    if (music) Mix_PlayMusic(music, -1);
+// Collision proxies in slot order; a slot keeps its index while its entity lives,
+// so broadphases can keep state between ticks.
+struct CollisionProxies {
+    vector<AABB> boxes;           // current box
+    vector<AABB> previous;        // box at the last detect(); where continuous sweeps start
+    vector<uint8_t> continuous;
+    vector<uint8_t> restarted;    // new, teleported or pushed by the solver since the last detect(): counts as moved, sweep starts at the box
+    vector<uint8_t> relayered;    // layer, layer row or continuous flag changed since the last detect(): counts as moved
+    vector<uint8_t> active;
+    vector<uint8_t> resting;      // static (no Velocity) or its Velocity is asleep
+    vector<uint8_t> asleep;       // resting and didn't move since the last detect(); set by detect()
+    vector<EntityId> owner;
+    vector<Transform*> transforms; // valid for the tick they were synced in
+    vector<Velocity*> velocities;  // same; null for static bodies
+    vector<RigidBody*> bodies;     // same; null without a RigidBody
+    vector<uint32_t> layerBits;    // 1 << layer
+    vector<uint32_t> layerMasks;   // the layers it meets (its row of CollisionLayers)
 
-    // Create entities
-    auto player = eng.getWorld().createEntity();
-    auto pTrans = player->addComponent<Transform>();
-    pTrans->x = cfg.width/2 - 32; pTrans->y = cfg.height/2 - 32; pTrans->w = 64; pTrans->h = 64;
-    auto pSprite = player->addComponent<Sprite>(); pSprite->texture = playerTex; pSprite->scale = 1.0f;
-    auto pVel = player->addComponent<Velocity>();
+    size_t size() const { return boxes.size(); }
+    void resize(size_t n) {
+        boxes.resize(n); previous.resize(n); continuous.resize(n, 0); restarted.resize(n, 1); relayered.resize(n, 0);
+        active.resize(n, 0); resting.resize(n, 0); asleep.resize(n, 0); owner.resize(n, INVALID_ENTITY);
+        transforms.resize(n, nullptr); velocities.resize(n, nullptr); bodies.resize(n, nullptr); layerBits.resize(n, 1u); layerMasks.resize(n, ~0u);
+    }
+    bool awake(size_t i) const { return active[i] & !asleep[i]; }
+    bool layersMeet(size_t a, size_t b) const { return (layerMasks[a] & layerBits[b]) != 0; }
+    // What broadphases sort: the box, or for continuous proxies the area swept since the last detect()
+    AABB bounds(size_t i) const { return continuous[i] ? combine(previous[i], boxes[i]) : boxes[i]; }
+};
 
-    auto target = eng.getWorld().createEntity();
-    auto tTrans = target->addComponent<Transform>();
-    tTrans->x = rand() % (cfg.width - 32); tTrans->y = rand() % (cfg.height - 32); tTrans->w = 32; tTrans->h = 32;
-    auto tSprite = target->addComponent<Sprite>(); tSprite->texture = targetTex;
+struct ProxyPair { uint32_t a, b; }; // a < b
 
-    auto enemy = eng.getWorld().createEntity();
-    auto eTrans = enemy->addComponent<Transform>();
-    eTrans->x = rand() % (cfg.width - 64); eTrans->y = rand() % (cfg.height - 64); eTrans->w = 48; eTrans->h = 48;
-    auto eSprite = enemy->addComponent<Sprite>(); eSprite->texture = enemyTex;
+// Broadphase: finds pairs of awake proxies whose boxes may overlap. Narrowphase confirms them.
+// Sleeping proxies are left out; CollisionWorld pairs them with awake ones separately.
+struct Broadphase {
+    JobSystem* jobs = nullptr; // optional; set through CollisionWorld::setJobs
+    virtual ~Broadphase() = default;
+    virtual const char* name() const = 0;
+    virtual void update(const CollisionProxies& proxies) = 0;
+    virtual void findPairs(vector<ProxyPair>& out) = 0;
+};
 
-    int score = 0;
+// Uniform grid broadphase, rebuilt every tick with a counting sort (O(n), no per-tick allocation
+// once warmed up). Each proxy is stored once, in the cell holding its min corner, with its box
+// copied alongside so neighbour scans stay in cache. Cells are at least as large as a box, so a
+// box can only overlap boxes from its own cell or the 8 around it. Boxes larger than a cell go
+// to a short "oversized" list. Cells are a dense array when the occupied area is compact and a
+// spatial hash otherwise.
+struct SpatialHashGrid : Broadphase {
+    float cellSize = 0; // 0 = 1.5x the average box extent, recomputed every update
+    float usedCellSize = 64;
+    bool indexSleeping = false; // index the sleeping proxies instead of the awake ones
 
-    // update function
-    auto onUpdate = [&](Engine& E) {
-        // input
-        const auto& keys = E.input.keys;
-        float speed = 4.0f;
-        auto pv = player->getComponent<Velocity>();
-        pv->vx = 0; pv->vy = 0;
-        if (keys.at(SDL_SCANCODE_W) || keys.at(SDL_SCANCODE_UP)) pv->vy = -speed;
-        if (keys.at(SDL_SCANCODE_S) || keys.at(SDL_SCANCODE_DOWN)) pv->vy = speed;
-        if (keys.at(SDL_SCANCODE_A) || keys.at(SDL_SCANCODE_LEFT)) pv->vx = -speed;
-        if (keys.at(SDL_SCANCODE_D) || keys.at(SDL_SCANCODE_RIGHT)) pv->vx = speed;
+    const char* name() const override { return "grid"; }
 
-        // physics
-        physicsSystem(E);
+    void update(const CollisionProxies& px) override {
+        const uint32_t n = (uint32_t)px.size();
+        float cs = cellSize;
+        if (cs <= 0) {
+            double sum = 0; size_t cnt = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                if (!indexed(px, i)) continue;
+                const AABB b = px.bounds(i);
+                sum += std::max(b.maxX - b.minX, b.maxY - b.minY); cnt++;
+            }
+            cs = cnt ? (float)(sum / cnt) * 1.5f : 64.0f;
+        }
+        usedCellSize = std::max(cs, 1.0f);
+        invCell = 1.0f / usedCellSize;
 
-        // enemy AI: move toward player
-        auto pt = player->getComponent<Transform>();
-        auto et = enemy->getComponent<Transform>();
-        float dx = (pt->x + pt->w/2.0f) - (et->x + et->w/2.0f);
-        float dy = (pt->y + pt->h/2.0f) - (et->y + et->h/2.0f);
-        float dist = sqrtf(dx*dx + dy*dy);
-        if (dist > 0.001f) {
-            float nx = dx / dist; float ny = dy / dist;
-            et->x += nx * 1.5f; et->y += ny * 1.5f;
+        cellX.resize(n); cellY.resize(n);
+        oversized.clear();
+        uint32_t count = 0;
+        int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+        maxW = 0; maxH = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            cellX[i] = INT_MIN;
+            if (!indexed(px, i)) continue;
+            const AABB b = px.bounds(i);
+            if (b.maxX - b.minX > usedCellSize || b.maxY - b.minY > usedCellSize) { oversized.push_back(i); continue; }
+            maxW = std::max(maxW, b.maxX - b.minX); maxH = std::max(maxH, b.maxY - b.minY);
+            int cx = cellOf(b.minX), cy = cellOf(b.minY);
+            cellX[i] = cx; cellY[i] = cy; count++;
+            x0 = std::min(x0, cx); x1 = std::max(x1, cx); y0 = std::min(y0, cy); y1 = std::max(y1, cy);
         }
 
+        dense = count > 0 && (Uint64)(x1 - x0 + 1) * (Uint64)(y1 - y0 + 1) <= 4ull * count + 64;
+        size_t buckets;
+        if (dense) { originX = x0; originY = y0; gridW = x1 - x0 + 1; gridH = y1 - y0 + 1; buckets = (size_t)gridW * gridH; }
+        else { buckets = 16; while (buckets < 2ull * count) buckets <<= 1; mask = (uint32_t)(buckets - 1); }
+
+        // counting sort by cell
+        bucketStart.assign(buckets + 1, 0);
+        for (uint32_t i = 0; i < n; i++) if (cellX[i] != INT_MIN) bucketStart[bucketOf(cellX[i], cellY[i])]++;
+        uint32_t run = 0;
+        for (size_t b = 0; b < buckets; b++) { uint32_t c = bucketStart[b]; bucketStart[b] = run; run += c; }
+        bucketStart[buckets] = run;
+        cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+        entries.resize(count);
+        for (uint32_t i = 0; i < n; i++) {
+            if (cellX[i] == INT_MIN) continue;
+            entries[cursor[bucketOf(cellX[i], cellY[i])]++] = { px.bounds(i), cellX[i], cellY[i], i };
+        }
+        // layers live beside the entries, and are only looked at if some pair is filtered
+        filtering = false;
+        for (uint32_t i = 0; i < n && !filtering; i++) filtering = indexed(px, i) && px.layerMasks[i] != ~0u;
+        if (filtering) {
+            entryLayers.resize(count);
+            for (uint32_t k = 0; k < count; k++) entryLayers[k] = { px.layerBits[entries[k].proxy], px.layerMasks[entries[k].proxy] };
+        }
+        proxies = &px;
+    }
+
+    // Pairs whose boxes overlap (inclusive), each reported once
+    void findPairs(vector<ProxyPair>& out) override {
+        out.clear();
+        if (dense) densePairs(out); else hashedPairs(out);
+        // oversized boxes: against the grid via query, then against each other
+        for (size_t k = 0; k < oversized.size(); k++) {
+            uint32_t a = oversized[k];
+            const AABB box = proxies->bounds(a);
+            queryGrid(box, [&](uint32_t p) { if (proxies->layersMeet(a, p)) push(out, a, p); return true; });
+            for (size_t m = k + 1; m < oversized.size(); m++)
+                if (aabbOverlap(box, proxies->bounds(oversized[m])) && proxies->layersMeet(a, oversized[m])) push(out, a, oversized[m]);
+        }
+    }
+
+    // Proxies whose boxes overlap `box`, as of the last update
+    void query(const AABB& box, vector<uint32_t>& out) const {
+        out.clear();
+        query(box, [&](uint32_t p) { out.push_back(p); });
+    }
+    template<typename F> void query(const AABB& box, F&& f) const {
+        queryWhile(box, [&](uint32_t p) { f(p); return true; });
+    }
+    // Same, stopping as soon as f returns false. Proxies come in cell order, row by row.
+    template<typename F> void queryWhile(const AABB& box, F&& f) const {
+        if (!proxies || !queryGrid(box, f)) return;
+        for (uint32_t p : oversized) if (aabbOverlap(box, proxies->bounds(p)) && !f(p)) return;
+    }
+
+private:
+    struct Entry { AABB box; int cx, cy; uint32_t proxy; };
+    struct EntryLayers { uint32_t bit, mask; };
+    vector<EntryLayers> entryLayers; // per entry, when filtering
+    bool filtering = false;          // some proxy skips some layer
+    bool meet(uint32_t i, uint32_t j) const { return !filtering || (entryLayers[i].mask & entryLayers[j].bit) != 0; }
+    const CollisionProxies* proxies = nullptr;
+    float invCell = 1.0f / 64.0f;
+    float maxW = 0, maxH = 0; // largest gridded box; how far left/up of a query a stored min corner can be
+    bool dense = false;
+    int originX = 0, originY = 0, gridW = 0, gridH = 0;
+    uint32_t mask = 0;
+    vector<int> cellX, cellY;
+    vector<uint32_t> bucketStart, cursor, oversized;
+    vector<Entry> entries;
+
+    bool indexed(const CollisionProxies& px, uint32_t i) const { return px.active[i] && px.asleep[i] == (uint8_t)indexSleeping; }
+    int cellOf(float v) const { float s = v * invCell; int i = (int)s; return i - (s < (float)i); } // floor without libm
+    bool hasCell(int cx, int cy) const {
+        return !dense || (cx >= originX && cy >= originY && cx < originX + gridW && cy < originY + gridH);
+    }
+    uint32_t bucketOf(int cx, int cy) const {
+        if (dense) return (uint32_t)((cy - originY) * gridW + (cx - originX));
+        return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & mask;
+    }
+    static void push(vector<ProxyPair>& out, uint32_t a, uint32_t b) { out.push_back(a < b ? ProxyPair{ a, b } : ProxyPair{ b, a }); }
+
+    static const size_t ParallelGrain = 8192; // entries per job; entries are in cell order, so a job is a band of cells
+    vector<vector<ProxyPair>> chunkPairs;
+
+    // With a job system, bands of cells are scanned in parallel and appended in band order
+    void densePairs(vector<ProxyPair>& out) {
+        const size_t count = entries.size();
+        if (!jobs || jobs->threadCount() == 1 || count <= ParallelGrain) { densePairsRange(0, (uint32_t)count, out); return; }
+        chunkPairs.resize(JobSystem::chunkCount(count, ParallelGrain));
+        jobs->parallelFor(count, ParallelGrain, [&](size_t b, size_t e, int) {
+            auto &buf = chunkPairs[b / ParallelGrain];
+            buf.clear();
+            densePairsRange((uint32_t)b, (uint32_t)e, buf);
+        });
+        size_t total = 0;
+        for (auto &c : chunkPairs) total += c.size();
+        out.reserve(total);
+        for (auto &c : chunkPairs) out.insert(out.end(), c.begin(), c.end());
+    }
+
+    // Dense grid, walked entry by entry. Cells are stored row-major, so for an entry in cell c the
+    // rest of c plus cell c+1 is one contiguous range, and cells c+W-1..c+W+1 below are another.
+    // Two loops per entry, and hits are written without a branch: the cursor advances on overlap.
+    // Appends the pairs of entries [from, to) to `out`.
+    void densePairsRange(uint32_t from, uint32_t to, vector<ProxyPair>& out) const {
+        if (filtering) densePairsRange<true>(from, to, out); else densePairsRange<false>(from, to, out);
+    }
+    template<bool Filter>
+    void densePairsRange(uint32_t from, uint32_t to, vector<ProxyPair>& out) const {
+        size_t k = out.size();
+        const EntryLayers* L = entryLayers.data();
+        const Entry* e = entries.data();
+        const uint32_t* start = bucketStart.data();
+        for (uint32_t i = from; i < to; i++) {
+            const Entry& A = e[i];
+            int x = A.cx - originX, y = A.cy - originY;
+            uint32_t c = (uint32_t)(y * gridW + x);
+            uint32_t rightEnd = start[x + 1 < gridW ? c + 2 : c + 1];
+            uint32_t belowFrom = 0, belowTo = 0;
+            if (y + 1 < gridH) {
+                uint32_t below = c + gridW;
+                belowFrom = start[x > 0 ? below - 1 : below];
+                belowTo = start[x + 1 < gridW ? below + 2 : below + 1];
+            }
+            size_t worst = (rightEnd - i - 1) + (belowTo - belowFrom);
+            if (k + worst > out.size()) out.resize(std::max(out.size() * 2, k + worst + 1024));
+            ProxyPair* dst = out.data();
+            for (uint32_t j = i + 1; j < rightEnd; j++) {
+                dst[k] = { std::min(A.proxy, e[j].proxy), std::max(A.proxy, e[j].proxy) };
+                k += aabbOverlap(A.box, e[j].box) & (!Filter || (L[i].mask & L[j].bit) != 0);
+            }
+            for (uint32_t j = belowFrom; j < belowTo; j++) {
+                dst[k] = { std::min(A.proxy, e[j].proxy), std::max(A.proxy, e[j].proxy) };
+                k += aabbOverlap(A.box, e[j].box) & (!Filter || (L[i].mask & L[j].bit) != 0);
+            }
+        }
+        out.resize(k);
+    }
+
+    // Hashed grid: a bucket can mix cells, so compare cell coordinates per entry
+    void hashedPairs(vector<ProxyPair>& out) {
+        static const int fwd[4][2] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} }; // half the neighbourhood: each pair once
+        const uint32_t count = (uint32_t)entries.size();
+        for (uint32_t i = 0; i < count; i++) {
+            const Entry& A = entries[i];
+            uint32_t b = bucketOf(A.cx, A.cy);
+            for (uint32_t j = i + 1; j < bucketStart[b + 1]; j++) {
+                const Entry& B = entries[j];
+                if (B.cx == A.cx && B.cy == A.cy && aabbOverlap(A.box, B.box) && meet(i, j)) push(out, A.proxy, B.proxy);
+            }
+            for (auto &d : fwd) {
+                int nx = A.cx + d[0], ny = A.cy + d[1];
+                uint32_t nb = bucketOf(nx, ny);
+                for (uint32_t j = bucketStart[nb]; j < bucketStart[nb + 1]; j++) {
+                    const Entry& B = entries[j];
+                    if (B.cx == nx && B.cy == ny && aabbOverlap(A.box, B.box) && meet(i, j)) push(out, A.proxy, B.proxy);
+                }
+            }
+        }
+    }
+
+    // Grid entries overlapping `box`: their min corner is at most one cell before box.min
+    template<typename F>
+    bool queryGrid(const AABB& box, F&& f) const { // false once f has returned false
+        if (entries.empty()) return true;
+        int qx0 = cellOf(box.minX - maxW), qx1 = cellOf(box.maxX), qy0 = cellOf(box.minY - maxH), qy1 = cellOf(box.maxY);
+        if (dense) {
+            // each row's cells qx0..qx1 are one contiguous run of entries
+            qx0 = std::max(qx0, originX); qy0 = std::max(qy0, originY);
+            qx1 = std::min(qx1, originX + gridW - 1); qy1 = std::min(qy1, originY + gridH - 1);
+            if (qx0 > qx1) return true;
+            for (int cy = qy0; cy <= qy1; cy++) {
+                uint32_t row = (uint32_t)((cy - originY) * gridW);
+                uint32_t end = bucketStart[row + (qx1 - originX) + 1];
+                for (uint32_t j = bucketStart[row + (qx0 - originX)]; j < end; j++)
+                    if (aabbOverlap(box, entries[j].box) && !f(entries[j].proxy)) return false;
+            }
+            return true;
+        }
+        for (int cy = qy0; cy <= qy1; cy++) {
+            for (int cx = qx0; cx <= qx1; cx++) {
+                uint32_t b = bucketOf(cx, cy);
+                for (uint32_t j = bucketStart[b]; j < bucketStart[b + 1]; j++) {
+                    const Entry& E = entries[j];
+                    if (E.cx == cx && E.cy == cy && aabbOverlap(box, E.box) && !f(E.proxy)) return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Sweep-and-prune broadphase. Boxes are kept sorted by their min on one axis, in an order that
+// persists between ticks and is repaired with insertion sort, which is close to O(n) when bodies
+// move coherently (few boxes change places per tick). Pairs come from sweeping that order: for
+// each box, later boxes are tested on the other axis until their min passes its max. The sweep
+// axis follows the larger spread of box centres, so clustered or strip-shaped scenes sweep along
+// their long side; switching axis re-sorts once. Cost grows with the number of boxes that share
+// a sweep-axis interval, so large uniform square scenes favour SpatialHashGrid.
+struct SweepAndPrune : Broadphase {
+    float axisSwitchRatio = 1.5f; // other axis spread must exceed this multiple to switch
+
+    const char* name() const override { return "sap"; }
+
+    void update(const CollisionProxies& px) override {
+        const uint32_t n = (uint32_t)px.size();
+        listed.resize(n, 0);
+
+        // spread of centres per axis, to pick the sweep axis
+        double sx = 0, sy = 0, sxx = 0, syy = 0; uint32_t cnt = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (!px.awake(i)) continue;
+            const AABB b = px.bounds(i);
+            double cx = 0.5 * (b.minX + b.maxX), cy = 0.5 * (b.minY + b.maxY);
+            sx += cx; sy += cy; sxx += cx * cx; syy += cy * cy; cnt++;
+        }
+        if (cnt) {
+            double vx = sxx / cnt - (sx / cnt) * (sx / cnt), vy = syy / cnt - (sy / cnt) * (sy / cnt);
+            bool wantY = axisY ? !(vx > vy * axisSwitchRatio) : vy > vx * axisSwitchRatio;
+            if (wantY != axisY) { axisY = wantY; resorted++; entries.clear(); std::fill(listed.begin(), listed.end(), 0); }
+        }
+
+        // refresh boxes in the kept order, dropping proxies that went inactive
+        size_t keep = 0;
+        for (size_t k = 0; k < entries.size(); k++) {
+            uint32_t p = entries[k].proxy;
+            if (p >= n || !px.awake(p)) { if (p < n) listed[p] = 0; continue; }
+            entries[keep++] = entryOf(px.bounds(p), p);
+        }
+        entries.resize(keep);
+        insertionSort(0, keep);
+
+        // newly active proxies: sort them on their own, then merge into the kept order
+        for (uint32_t i = 0; i < n; i++) {
+            if (!px.awake(i) || listed[i]) continue;
+            listed[i] = 1;
+            entries.push_back(entryOf(px.bounds(i), i));
+        }
+        if (entries.size() > keep) {
+            auto byLo = [](const Entry& a, const Entry& b) { return a.lo < b.lo; };
+            std::sort(entries.begin() + keep, entries.end(), byLo);
+            std::inplace_merge(entries.begin(), entries.begin() + keep, entries.end(), byLo);
+        }
+
+        // sorted order as SoA lanes (sweep axis in x) for the batched sweep
+        lanes.resize(entries.size());
+        for (size_t k = 0; k < entries.size(); k++) lanes.set(k, { entries[k].lo, entries[k].olo, entries[k].hi, entries[k].ohi });
+        proxies = &px;
+    }
+
+    // Pairs whose boxes overlap (inclusive), each reported once. Each box is tested against the
+    // boxes after it 8 at a time with overlapMask; since they are sorted by min, the sweep stops
+    // at the first batch whose last box starts past this box's max.
+    void findPairs(vector<ProxyPair>& out) override {
+        out.clear();
+        const Entry* e = entries.data();
+        const float* lo = lanes.minX.data();
+        const size_t count = entries.size();
+        for (size_t i = 0; i < count; i++) {
+            const AABB A = lanes.get(i);
+            const uint32_t pa = e[i].proxy;
+            const uint32_t layerMask = proxies->layerMasks[pa];
+            for (size_t j = i + 1; j < count; j += OverlapLanes) {
+                uint32_t m = overlapMask(A, lanes, j); // padding lanes never overlap
+                while (m) {
+                    uint32_t pb = e[j + lowestBit(m)].proxy;
+                    if (layerMask & proxies->layerBits[pb]) out.push_back({ std::min(pa, pb), std::max(pa, pb) });
+                    m &= m - 1;
+                }
+                if (lo[j + OverlapLanes - 1] > A.maxX) break;
+            }
+        }
+    }
+
+    bool sweepsY() const { return axisY; }
+    size_t lastSwaps() const { return swaps; }
+    size_t axisSwitches() const { return resorted; }
+
+private:
+    // lo/hi on the sweep axis, olo/ohi on the other one
+    struct Entry { float lo, hi, olo, ohi; uint32_t proxy; };
+    const CollisionProxies* proxies = nullptr;
+    vector<Entry> entries;
+    AABBLanes lanes;
+    vector<uint8_t> listed;
+    bool axisY = false;
+    size_t swaps = 0, resorted = 0;
+
+    Entry entryOf(const AABB& b, uint32_t p) const {
+        return axisY ? Entry{ b.minY, b.maxY, b.minX, b.maxX, p } : Entry{ b.minX, b.maxX, b.minY, b.maxY, p };
+    }
+
+    void insertionSort(size_t from, size_t to) {
+        swaps = 0;
+        for (size_t i = from + 1; i < to; i++) {
+            Entry v = entries[i];
+            size_t j = i;
+            while (j > from && entries[j - 1].lo > v.lo) { entries[j] = entries[j - 1]; j--; }
+            swaps += i - j;
+            entries[j] = v;
+        }
+    }
+};
+
+// Entry parameter of segment origin + t*dir against `b`, if it hits within [0, tMax]
+inline bool rayHitsBox(const AABB& b, float ox, float oy, float dx, float dy, float tMax, float& tHit) {
+    float t0 = 0, t1 = tMax;
+    const float o[2] = { ox, oy }, d[2] = { dx, dy }, lo[2] = { b.minX, b.minY }, hi[2] = { b.maxX, b.maxY };
+    for (int k = 0; k < 2; k++) {
+        if (std::fabs(d[k]) < 1e-12f) { if (o[k] < lo[k] || o[k] > hi[k]) return false; continue; }
+        float inv = 1.0f / d[k];
+        float a = (lo[k] - o[k]) * inv, c = (hi[k] - o[k]) * inv;
+        if (a > c) std::swap(a, c);
+        t0 = std::max(t0, a); t1 = std::min(t1, c);
+        if (t0 > t1) return false;
+    }
+    tHit = t0;
+    return true;
+}
+
+// Dynamic AABB tree (bounding volume hierarchy) for spatial queries. Leaves hold "fat" boxes
+// padded by `margin`, so a moving box only touches the tree when it leaves its fat box; then the
+// leaf is removed and reinserted, refitting its ancestors on the way up. Insertion picks the
+// sibling with the lowest total perimeter cost (the 2D surface area heuristic) and AVL-style
+// rotations keep the height near log2(n). Queries report leaves whose fat box passes, so callers
+// test the exact box themselves (CollisionWorld does).
+struct AABBTree {
+    static constexpr int Null = -1;
+    float margin = 4.0f;
+
+    // Returns the leaf id for `box`; `data` is handed back by queries
+    int create(const AABB& box, uint32_t data) {
+        int leaf = allocate();
+        nodes[leaf].box = fatten(box);
+        nodes[leaf].data = data;
+        nodes[leaf].height = 0;
+        insertLeaf(leaf);
+        leafCount++;
+        return leaf;
+    }
+
+    void destroy(int leaf) {
+        removeLeaf(leaf);
+        release(leaf);
+        leafCount--;
+    }
+
+    // Returns true when the leaf had to be reinserted
+    bool move(int leaf, const AABB& box) {
+        if (contains(nodes[leaf].box, box)) return false;
+        removeLeaf(leaf);
+        nodes[leaf].box = fatten(box);
+        insertLeaf(leaf);
+        return true;
+    }
+
+    void clear() { nodes.clear(); root = Null; freeList = Null; leafCount = 0; }
+
+    const AABB& fatBox(int leaf) const { return nodes[leaf].box; }
+    uint32_t data(int leaf) const { return nodes[leaf].data; }
+    size_t size() const { return leafCount; }
+    int height() const { return root == Null ? 0 : nodes[root].height; }
+
+    // f(data) for every leaf whose fat box overlaps `box`
+    template<typename F>
+    void query(const AABB& box, F&& f) const {
+        visit([&](const AABB& b) { return aabbOverlap(b, box); }, f);
+    }
+
+    template<typename F>
+    void queryPoint(float x, float y, F&& f) const { query({ x, y, x, y }, f); }
+
+    // f(data) for every leaf whose fat box comes within `radius` of (x, y)
+    template<typename F>
+    void queryRadius(float x, float y, float radius, F&& f) const {
+        const float r2 = radius * radius;
+        visit([&](const AABB& b) {
+            float dx = std::max(std::max(b.minX - x, x - b.maxX), 0.0f);
+            float dy = std::max(std::max(b.minY - y, y - b.maxY), 0.0f);
+            return dx * dx + dy * dy <= r2;
+        }, f);
+    }
+
+    // Segment (x0,y0)->(x1,y1). f(data, tMax) returns the new tMax in [0, 1]: return tMax to keep
+    // going, a smaller value to clip the segment at a hit, 0 to stop.
+    template<typename F>
+    void raycast(float x0, float y0, float x1, float y1, F&& f) const {
+        if (root == Null) return;
+        const float dx = x1 - x0, dy = y1 - y0;
+        float tMax = 1.0f;
+        int stack[StackSize]; int sp = 0;
+        stack[sp++] = root;
+        while (sp > 0) {
+            const Node& n = nodes[stack[--sp]];
+            float t;
+            if (!rayHitsBox(n.box, x0, y0, dx, dy, tMax, t)) continue;
+            if (n.isLeaf()) {
+                tMax = f(n.data, tMax);
+                if (tMax <= 0) return;
+            } else {
+                assert(sp + 2 <= StackSize);
+                stack[sp++] = n.left; stack[sp++] = n.right;
+            }
+        }
+    }
+
+private:
+    // AVL balancing bounds the height by ~1.44 log2(n); 256 covers far more leaves than memory
+    static constexpr int StackSize = 256;
+    struct Node {
+        AABB box;
+        int parent = Null, left = Null, right = Null;
+        int height = -1; // 0 for leaves, -1 when free
+        uint32_t data = 0;
+        bool isLeaf() const { return left == Null; }
+    };
+    vector<Node> nodes;
+    int root = Null;
+    int freeList = Null; // chained through Node::parent
+    size_t leafCount = 0;
+
+    AABB fatten(const AABB& b) const { return { b.minX - margin, b.minY - margin, b.maxX + margin, b.maxY + margin }; }
+
+    int allocate() {
+        if (freeList == Null) { nodes.emplace_back(); return (int)nodes.size() - 1; }
+        int id = freeList;
+        freeList = nodes[id].parent;
+        nodes[id] = Node();
+        return id;
+    }
+    void release(int id) { nodes[id].height = -1; nodes[id].parent = freeList; freeList = id; }
+
+    template<typename Test, typename F>
+    void visit(Test&& test, F& f) const {
+        if (root == Null) return;
+        int stack[StackSize]; int sp = 0;
+        stack[sp++] = root;
+        while (sp > 0) {
+            const Node& n = nodes[stack[--sp]];
+            if (!test(n.box)) continue;
+            if (n.isLeaf()) f(n.data);
+            else { assert(sp + 2 <= StackSize); stack[sp++] = n.left; stack[sp++] = n.right; }
+        }
+    }
+
+    void insertLeaf(int leaf) {
+        if (root == Null) { root = leaf; nodes[leaf].parent = Null; return; }
+
+        // Best sibling by branch and bound. Pairing the leaf with node S costs the perimeter of
+        // their new parent plus the growth of every ancestor of S (the "inherited" cost). A subtree
+        // is skipped when even a perfect fit inside it can't beat the best cost found so far.
+        const AABB box = nodes[leaf].box;
+        const float leafArea = perimeter(box);
+        int sibling = root;
+        float bestCost = perimeter(combine(nodes[root].box, box));
+        struct Candidate { int node; float inherited; };
+        Candidate stack[StackSize]; int sp = 0;
+        stack[sp++] = { root, 0.0f };
+        while (sp > 0) {
+            Candidate c = stack[--sp];
+            const Node& n = nodes[c.node];
+            float direct = perimeter(combine(n.box, box));
+            float cost = direct + c.inherited;
+            if (cost < bestCost) { bestCost = cost; sibling = c.node; }
+            if (n.isLeaf()) continue;
+            float inherited = c.inherited + direct - perimeter(n.box);
+            if (leafArea + inherited < bestCost && sp + 2 <= StackSize) {
+                stack[sp++] = { n.left, inherited };
+                stack[sp++] = { n.right, inherited };
+            }
+        }
+
+        int oldParent = nodes[sibling].parent;
+        int newParent = allocate(); // may reallocate `nodes`, so no references are held across it
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = combine(box, nodes[sibling].box);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].left = sibling;
+        nodes[newParent].right = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+        if (oldParent == Null) root = newParent;
+        else if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+        else nodes[oldParent].right = newParent;
+
+        refitFrom(nodes[leaf].parent);
+    }
+
+    void removeLeaf(int leaf) {
+        if (leaf == root) { root = Null; return; }
+        int parent = nodes[leaf].parent;
+        int grandParent = nodes[parent].parent;
+        int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+        release(parent);
+        nodes[sibling].parent = grandParent;
+        if (grandParent == Null) { root = sibling; return; }
+        if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+        else nodes[grandParent].right = sibling;
+        refitFrom(grandParent);
+    }
+
+    // Walk to the root, rebalancing and recomputing boxes and heights
+    void refitFrom(int index) {
+        while (index != Null) {
+            index = balance(index);
+            Node& n = nodes[index];
+            n.height = 1 + std::max(nodes[n.left].height, nodes[n.right].height);
+            n.box = combine(nodes[n.left].box, nodes[n.right].box);
+            index = n.parent;
+        }
+    }
+
+    // If one child of `a` is 2+ levels taller, rotate it up; returns the subtree's new root
+    int balance(int a) {
+        Node& A = nodes[a];
+        if (A.isLeaf() || A.height < 2) return a;
+        int b = A.left, c = A.right;
+        int diff = nodes[c].height - nodes[b].height;
+        if (diff > 1) return rotateUp(a, c, b, false);
+        if (diff < -1) return rotateUp(a, b, c, true);
+        return a;
+    }
+
+    // Promote child `up` of `a` (its other child is `keep`). `up`'s taller child stays under it,
+    // its shorter child takes `up`'s old place under `a`.
+    int rotateUp(int a, int up, int keep, bool upIsLeft) {
+        Node& A = nodes[a];
+        Node& U = nodes[up];
+        int f = U.left, g = U.right;
+        U.left = a;
+        U.parent = A.parent;
+        A.parent = up;
+        if (U.parent == Null) root = up;
+        else if (nodes[U.parent].left == a) nodes[U.parent].left = up;
+        else nodes[U.parent].right = up;
+
+        int tall = nodes[f].height > nodes[g].height ? f : g;
+        int shortChild = tall == f ? g : f;
+        U.right = tall;
+        if (upIsLeft) A.left = shortChild; else A.right = shortChild;
+        nodes[shortChild].parent = a;
+        A.box = combine(nodes[keep].box, nodes[shortChild].box);
+        A.height = 1 + std::max(nodes[keep].height, nodes[shortChild].height);
+        U.box = combine(A.box, nodes[tall].box);
+        U.height = 1 + std::max(A.height, nodes[tall].height);
+        return up;
+    }
+};
+
+struct Contact {
+    EntityId a = INVALID_ENTITY, b = INVALID_ENTITY; // a < b
+    uint32_t proxyA = 0, proxyB = 0;
+    float toi = 1.0f; // continuous pairs: first touch within the tick (0..1); 1 for overlaps at the end
+    // RigidBodySolver state, kept while the contact lasts so the next tick can warm start
+    float nx = 0, ny = 0;                        // normal, from a to b
+    float normalImpulse = 0, tangentImpulse = 0; // accumulated
+};
+
+enum CollisionPhase { CollisionEnter, CollisionStay, CollisionExit };
+
+// One per pair per tick: Enter on the first tick two entities touch, Stay while they keep
+// touching, Exit on the first tick they don't (or one of them is gone).
+struct CollisionEvent {
+    CollisionPhase phase = CollisionEnter;
+    EntityId a = INVALID_ENTITY, b = INVALID_ENTITY; // a < b
+    float toi = 1.0f;                                // from the Contact; 1 for Exit
+};
+
+// Receives all of a tick's events at once, in proxy slot order
+using CollisionHandler = function<void(const vector<CollisionEvent>&)>;
+
+struct RayHit {
+    EntityId entity = INVALID_ENTITY;
+    float t = 1.0f; // fraction along the segment
+    float x = 0, y = 0;
+};
+
+// An island is a connected group of contacts: no body in one touches a body in another, so
+// islands can be resolved independently and in parallel
+struct Island {
+    uint32_t first = 0, count = 0; // range in CollisionWorld::islandContacts
+};
+
+// Collision pipeline: sync proxies from Transforms, broadphase, narrowphase, then Enter/Stay/Exit
+// events for subscribers. Contacts persist between ticks: a contact whose two proxies didn't move
+// is carried over without a narrowphase test, and candidate pairs where neither moved are skipped.
+// With a job system the broadphase and narrowphase run in parallel; contacts are merged in
+// chunk order and sorted by slot, so results don't depend on the thread count.
+// Sleeping proxies (static bodies, or asleep Velocity bodies that didn't move) skip the broadphase:
+// they sit in a second grid that is only rebuilt when the sleeping set changes, and awake proxies
+// are queried against it. Contacts between two sleeping proxies are carried over.
+// Also keeps an AABBTree over the same proxies for spatial queries; queries see the boxes as of
+// the last sync and are exact (fat tree boxes are re-tested against the proxy box).
+struct CollisionWorld {
+    CollisionProxies proxies;
+    unique_ptr<Broadphase> broadphase = make_unique<SpatialHashGrid>();
+    vector<ProxyPair> candidates;
+    vector<Contact> contacts; // this tick's overlapping pairs, sorted by proxy slots
+    vector<CollisionEvent> events; // this tick's, sent by dispatch()
+    bool reportStay = true;
+    size_t narrowphaseTests = 0;   // in the last detect()
+    AABBTree tree;
+    vector<Island> islands;        // from buildIslands(), ordered by their first contact
+    vector<uint32_t> islandContacts; // indices into contacts, grouped by island, in contact order
+    CollisionLayers layers;        // read by sync()
+
+    void setBroadphase(unique_ptr<Broadphase> bp) { broadphase = std::move(bp); broadphase->jobs = jobs; }
+    void setJobs(JobSystem* js) { jobs = js; broadphase->jobs = js; }
+
+    // Gather boxes for every entity with a Transform; slots of destroyed entities are recycled
+    void sync(World& world) {
+        stamp++;
+        for (auto &kv : world.entities) {
+            auto t = kv.second->getComponent<Transform>();
+            if (!t) continue;
+            uint32_t slot;
+            auto it = slotOf.find(kv.first);
+            if (it != slotOf.end()) slot = it->second;
+            else {
+                if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+                else { slot = (uint32_t)proxies.size(); proxies.resize(slot + 1); seen.resize(slot + 1, 0); treeLeaf.resize(slot + 1, AABBTree::Null); }
+                slotOf[kv.first] = slot;
+                proxies.restarted[slot] = 1;
+                proxies.owner[slot] = kv.first;
+            }
+            proxies.boxes[slot] = boxOf(*t);
+            proxies.transforms[slot] = t.get();
+            auto col = kv.second->getComponent<Collider>();
+            uint8_t continuous = col && col->continuous;
+            auto vel = kv.second->getComponent<Velocity>();
+            proxies.velocities[slot] = vel.get();
+            proxies.bodies[slot] = kv.second->getComponent<RigidBody>().get();
+            proxies.resting[slot] = !vel || vel->asleep;
+            int layer = col ? col->layer & (CollisionLayers::Count - 1) : 0;
+            // pairs that now meet (or no longer do) get tested again even if neither moves
+            proxies.relayered[slot] |= (proxies.layerBits[slot] != 1u << layer) | (proxies.layerMasks[slot] != layers.masks[layer]);
+            proxies.layerBits[slot] = 1u << layer;
+            proxies.layerMasks[slot] = layers.masks[layer];
+            if (proxies.restarted[slot]) proxies.previous[slot] = proxies.boxes[slot]; // no sweep across a spawn or teleport
+            // a pair that stops being continuous gets one last test, or a contact from mid-sweep
+            // would be carried over for as long as the pair rests
+            proxies.relayered[slot] |= proxies.continuous[slot] != continuous;
+            proxies.continuous[slot] = continuous;
+            proxies.active[slot] = 1;
+            seen[slot] = stamp;
+            if (treeLeaf[slot] == AABBTree::Null) treeLeaf[slot] = tree.create(proxies.boxes[slot], slot);
+            else tree.move(treeLeaf[slot], proxies.boxes[slot]);
+        }
+        for (uint32_t s = 0; s < (uint32_t)proxies.size(); s++) {
+            if (proxies.active[s] && seen[s] != stamp) {
+                tree.destroy(treeLeaf[s]);
+                treeLeaf[s] = AABBTree::Null;
+                proxies.active[s] = 0;
+                proxies.continuous[s] = 0;
+                proxies.transforms[s] = nullptr;
+                proxies.velocities[s] = nullptr;
+                proxies.bodies[s] = nullptr;
+                proxies.resting[s] = 0;
+                slotOf.erase(proxies.owner[s]);
+                proxies.owner[s] = INVALID_ENTITY;
+                freeSlots.push_back(s);
+            }
+        }
+    }
+
+    void detect() {
+        const size_t n = proxies.size();
+        moved.resize(n);
+        awakeSlots.clear();
+        bool sleepChanged = false;
+        size_t sleepingCount = 0;
+        for (size_t s = 0; s < n; s++) {
+            const AABB& b = proxies.boxes[s];
+            const AABB& p = proxies.previous[s];
+            moved[s] = proxies.restarted[s] | proxies.relayered[s] | (b.minX != p.minX) | (b.minY != p.minY) | (b.maxX != p.maxX) | (b.maxY != p.maxY);
+            uint8_t sleeping = proxies.active[s] & proxies.resting[s] & !moved[s];
+            sleepChanged |= sleeping != proxies.asleep[s];
+            proxies.asleep[s] = sleeping;
+            sleepingCount += sleeping;
+            if (proxies.active[s] & !sleeping) awakeSlots.push_back((uint32_t)s);
+        }
+
+        broadphase->update(proxies);
+        broadphase->findPairs(candidates);
+        if (sleepChanged) { sleepers.indexSleeping = true; sleepers.update(proxies); }
+        if (sleepingCount) runChunked(awakeSlots.size(), SleeperGrain, chunkPairs, candidates, [&](size_t begin, size_t end, vector<ProxyPair>& out) {
+            for (size_t k = begin; k < end; k++) {
+                uint32_t a = awakeSlots[k];
+                sleepers.query(proxies.bounds(a), [&](uint32_t s) { if (proxies.layersMeet(a, s)) out.push_back(a < s ? ProxyPair{ a, s } : ProxyPair{ s, a }); });
+            }
+            return (size_t)0;
+        });
+
+        // a discrete pair that didn't move keeps its answer from last tick; continuous pairs are
+        // always tested, since last tick's contact may have been mid-sweep
+        auto settled = [&](uint32_t a, uint32_t b) { return !(moved[a] | moved[b] | proxies.continuous[a] | proxies.continuous[b]); };
+
+        previousContacts.swap(contacts);
+        contacts.clear();
+        narrowphaseTests = 0;
+        for (auto &c : previousContacts) {
+            if (!proxies.active[c.proxyA] || !proxies.active[c.proxyB]) continue;
+            if (proxies.owner[c.proxyA] != c.a || proxies.owner[c.proxyB] != c.b) continue; // slot recycled
+            if (!proxies.layersMeet(c.proxyA, c.proxyB)) continue;                           // layers changed
+            if (settled(c.proxyA, c.proxyB)) contacts.push_back(c);
+            else if (proxies.asleep[c.proxyA] & proxies.asleep[c.proxyB]) {
+                // continuous and both asleep, so no broadphase reports the pair: retest it here,
+                // now that neither moves (a mid-sweep contact ends)
+                narrowphaseTests++;
+                if (aabbOverlap(proxies.boxes[c.proxyA], proxies.boxes[c.proxyB])) { contacts.push_back(c); contacts.back().toi = 1.0f; }
+            }
+        }
+        auto testRange = [&](size_t begin, size_t end, vector<Contact>& out) {
+            size_t tests = 0;
+            for (size_t i = begin; i < end; i++) {
+                const ProxyPair& p = candidates[i];
+                if (settled(p.a, p.b)) continue; // carried over above if it was touching
+                Contact c;
+                tests++;
+                if (!narrowphase(p.a, p.b, c.toi)) continue;
+                c.proxyA = p.a; c.proxyB = p.b;
+                c.a = proxies.owner[p.a]; c.b = proxies.owner[p.b];
+                if (c.a > c.b) { swap(c.a, c.b); swap(c.proxyA, c.proxyB); }
+                out.push_back(c);
+            }
+            return tests;
+        };
+        narrowphaseTests += runChunked(candidates.size(), NarrowphaseGrain, chunkContacts, contacts, testRange);
+
+        // a moving body wakes the sleeping bodies it touches
+        for (auto &c : contacts) {
+            wakeTouched(c.proxyA, c.proxyB);
+            wakeTouched(c.proxyB, c.proxyA);
+        }
+        sortContacts();
+        buildEvents();
+
+        // next tick's motion and sweeps are measured from here
+        for (size_t s = 0; s < n; s++) { proxies.previous[s] = proxies.boxes[s]; proxies.restarted[s] = 0; proxies.relayered[s] = 0; }
+    }
+
+    size_t subscribe(CollisionHandler h) { handlers.push_back({ nextHandler, std::move(h) }); return nextHandler++; }
+    void unsubscribe(size_t id) {
+        handlers.erase(remove_if(handlers.begin(), handlers.end(), [&](const pair<size_t, CollisionHandler>& h) { return h.first == id; }), handlers.end());
+    }
+
+    // Send this tick's events to every subscriber, one batch each. Handlers may move or destroy
+    // entities (changes show up next tick) but must not subscribe or unsubscribe.
+    void dispatch() {
+        if (events.empty()) return;
+        for (size_t i = 0; i < handlers.size(); i++) handlers[i].second(events);
+    }
+
+    // Exact test for a candidate pair. If either proxy is continuous, its motion since the last
+    // detect() is swept against the other (which moves along its own path if also continuous).
+    bool narrowphase(uint32_t a, uint32_t b, float& toi) const {
+        const AABB& A = proxies.boxes[a];
+        const AABB& B = proxies.boxes[b];
+        if (!(proxies.continuous[a] | proxies.continuous[b])) { toi = 1.0f; return aabbOverlap(A, B); }
+        const AABB& A0 = proxies.continuous[a] ? proxies.previous[a] : A;
+        const AABB& B0 = proxies.continuous[b] ? proxies.previous[b] : B;
+        float vx = (A.minX - A0.minX) - (B.minX - B0.minX), vy = (A.minY - A0.minY) - (B.minY - B0.minY);
+        return sweepAABB(A0, vx, vy, B0, toi);
+    }
+
+    // The entity jumped (respawn, editor move): don't sweep across the gap on the next tick
+    void teleported(EntityId id) {
+        auto it = slotOf.find(id);
+        if (it != slotOf.end()) proxies.restarted[it->second] = 1;
+    }
+
+    // Group this tick's contacts into islands: union-find over proxy slots, each contact joining
+    // its two bodies. Anchored bodies (anchored[slot] != 0: static, nothing writes to them) join
+    // no islands, so a wall doesn't chain everything touching it into one island; contacts between
+    // two anchored bodies are left out. Deterministic: islands are numbered by their first contact
+    // in slot order.
+    void buildIslands(const uint8_t* anchored = nullptr) {
+        islands.clear();
+        islandContacts.clear();
+        if (contacts.empty()) return;
+        auto fixed = [&](uint32_t s) { return anchored && anchored[s]; };
+        auto body = [&](const Contact& c) { return fixed(c.proxyA) ? c.proxyB : c.proxyA; }; // a free body of the contact
+        islandRoot.resize(proxies.size());
+        for (auto &c : contacts) { islandRoot[c.proxyA] = c.proxyA; islandRoot[c.proxyB] = c.proxyB; }
+        for (auto &c : contacts) {
+            if (fixed(c.proxyA) || fixed(c.proxyB)) continue;
+            uint32_t ra = findRoot(c.proxyA), rb = findRoot(c.proxyB);
+            if (ra != rb) islandRoot[std::max(ra, rb)] = std::min(ra, rb);
+        }
+        // islandOf[root] numbers the islands on first sight; then a counting sort of contacts by island
+        islandOf.resize(proxies.size());
+        for (auto &c : contacts) islandOf[findRoot(body(c))] = UINT32_MAX;
+        uint32_t total = 0;
+        for (auto &c : contacts) {
+            if (fixed(c.proxyA) && fixed(c.proxyB)) continue;
+            uint32_t& id = islandOf[findRoot(body(c))];
+            if (id == UINT32_MAX) { id = (uint32_t)islands.size(); islands.push_back({}); }
+            islands[id].count++;
+            total++;
+        }
+        for (size_t i = 1; i < islands.size(); i++) islands[i].first = islands[i - 1].first + islands[i - 1].count;
+        islandFill.resize(islands.size());
+        for (size_t i = 0; i < islands.size(); i++) islandFill[i] = islands[i].first;
+        islandContacts.resize(total);
+        for (uint32_t k = 0; k < (uint32_t)contacts.size(); k++) {
+            const Contact& c = contacts[k];
+            if (!(fixed(c.proxyA) && fixed(c.proxyB))) islandContacts[islandFill[islandOf[findRoot(body(c))]]++] = k;
+        }
+    }
+
+    // fn(island) for every island, spread over the job system. Islands share no bodies, so fn may
+    // write to the bodies of its own island freely.
+    void forEachIsland(const function<void(const Island&)>& fn) {
+        if (!jobs) { for (auto &is : islands) fn(is); return; }
+        jobs->parallelFor(islands.size(), IslandGrain, [&](size_t b, size_t e, int) {
+            for (size_t i = b; i < e; i++) fn(islands[i]);
+        });
+    }
+
+    void step(World& world) { sync(world); detect(); dispatch(); }
+
+    // Entities whose box overlaps `box` / contains the point / comes within `radius` of it
+    void queryRect(const AABB& box, vector<EntityId>& out) const {
+        out.clear();
+        tree.query(box, [&](uint32_t s) { if (aabbOverlap(proxies.boxes[s], box)) out.push_back(proxies.owner[s]); });
+    }
+    void queryPoint(float x, float y, vector<EntityId>& out) const { queryRect({ x, y, x, y }, out); }
+    void queryRadius(float x, float y, float radius, vector<EntityId>& out) const {
+        out.clear();
+        tree.queryRadius(x, y, radius, [&](uint32_t s) {
+            const AABB& b = proxies.boxes[s];
+            float dx = std::max(std::max(b.minX - x, x - b.maxX), 0.0f);
+            float dy = std::max(std::max(b.minY - y, y - b.maxY), 0.0f);
+            if (dx * dx + dy * dy <= radius * radius) out.push_back(proxies.owner[s]);
+        });
+    }
+
+    // Nearest box hit by the segment (x0,y0)->(x1,y1), skipping `ignore`
+    bool raycast(float x0, float y0, float x1, float y1, RayHit& hit, EntityId ignore = INVALID_ENTITY) const {
+        hit = RayHit();
+        const float dx = x1 - x0, dy = y1 - y0;
+        tree.raycast(x0, y0, x1, y1, [&](uint32_t s, float tMax) {
+            float t;
+            if (proxies.owner[s] == ignore || !rayHitsBox(proxies.boxes[s], x0, y0, dx, dy, tMax, t)) return tMax;
+            hit.entity = proxies.owner[s]; hit.t = t;
+            return t; // only nearer boxes from here on
+        });
+        if (hit.entity == INVALID_ENTITY) return false;
+        hit.x = x0 + dx * hit.t; hit.y = y0 + dy * hit.t;
+        return true;
+    }
+
+private:
+    static const size_t NarrowphaseGrain = 4096; // candidate pairs per job
+    static const size_t SleeperGrain = 1024;     // awake proxies per job, queried against the sleepers
+    static const size_t IslandGrain = 16;        // islands per job
+    JobSystem* jobs = nullptr;
+    vector<vector<Contact>> chunkContacts;
+    vector<vector<ProxyPair>> chunkPairs;
+    vector<size_t> chunkTotals;
+    SpatialHashGrid sleepers; // sleeping proxies, rebuilt when the set changes
+    vector<uint32_t> awakeSlots;
+
+    // fn(begin, end, out) over [0, count), returning a count; with a job system, chunks run in
+    // parallel into their own buffers, appended to `out` in chunk order. Returns the summed counts.
+    template<typename T, typename F>
+    size_t runChunked(size_t count, size_t grain, vector<vector<T>>& chunks, vector<T>& out, F&& fn) {
+        if (!jobs || jobs->threadCount() == 1 || count <= grain) return fn(0, count, out);
+        const size_t n = JobSystem::chunkCount(count, grain);
+        chunks.resize(n);
+        chunkTotals.assign(n, 0);
+        jobs->parallelFor(count, grain, [&](size_t b, size_t e, int) {
+            auto &buf = chunks[b / grain];
+            buf.clear();
+            chunkTotals[b / grain] = fn(b, e, buf);
+        });
+        size_t total = 0;
+        for (size_t k = 0; k < n; k++) { out.insert(out.end(), chunks[k].begin(), chunks[k].end()); total += chunkTotals[k]; }
+        return total;
+    }
+
+    void wakeTouched(uint32_t mover, uint32_t sleeper) {
+        if (moved[mover] && proxies.asleep[sleeper] && proxies.velocities[sleeper]) proxies.velocities[sleeper]->wake();
+    }
+    vector<uint32_t> islandRoot, islandOf, islandFill; // per slot, per slot, per island
+
+    // With path halving; roots are the smallest slot of their set
+    uint32_t findRoot(uint32_t s) {
+        while (islandRoot[s] != s) { islandRoot[s] = islandRoot[islandRoot[s]]; s = islandRoot[s]; }
+        return s;
+    }
+
+    unordered_map<EntityId, uint32_t> slotOf;
+    vector<uint32_t> freeSlots;
+    vector<uint32_t> seen;
+    vector<uint8_t> moved;
+    vector<Contact> previousContacts;
+    vector<pair<size_t, CollisionHandler>> handlers;
+    size_t nextHandler = 1;
+
+    vector<uint32_t> sortStart;
+    vector<Contact> sortScratch;
+
+    static uint32_t lowSlot(const Contact& c) { return std::min(c.proxyA, c.proxyB); }
+    static uint32_t highSlot(const Contact& c) { return std::max(c.proxyA, c.proxyB); }
+    static bool slotsBefore(const Contact& x, const Contact& y) {
+        return lowSlot(x) != lowSlot(y) ? lowSlot(x) < lowSlot(y) : highSlot(x) < highSlot(y);
+    }
+
+    // Order by (low slot, high slot): counting sort on the low slot, then insertion sort within
+    // each slot's few contacts. O(slots + contacts), unlike a comparison sort of every contact.
+    void sortContacts() {
+        const size_t n = proxies.size();
+        sortStart.assign(n + 1, 0);
+        for (auto &c : contacts) sortStart[lowSlot(c) + 1]++;
+        for (size_t s = 0; s < n; s++) sortStart[s + 1] += sortStart[s];
+        sortScratch.resize(contacts.size());
+        for (auto &c : contacts) sortScratch[sortStart[lowSlot(c)]++] = c; // sortStart[s] ends at slot s's end
+        for (size_t s = 0, begin = 0; s < n; begin = sortStart[s], s++) {
+            for (size_t k = begin + 1; k < sortStart[s]; k++) {
+                Contact v = sortScratch[k];
+                size_t m = k;
+                while (m > begin && highSlot(v) < highSlot(sortScratch[m - 1])) { sortScratch[m] = sortScratch[m - 1]; m--; }
+                sortScratch[m] = v;
+            }
+        }
+        contacts.swap(sortScratch);
+    }
+
+    // Merge last tick's sorted contacts with this tick's. A slot pair whose owners changed
+    // (a slot was recycled) is an Exit for the old pair and an Enter for the new one. A pair
+    // present in both keeps its solver state.
+    void buildEvents() {
+        events.clear();
+        size_t i = 0, j = 0;
+        while (i < previousContacts.size() || j < contacts.size()) {
+            bool takeOld = j == contacts.size() || (i < previousContacts.size() && slotsBefore(previousContacts[i], contacts[j]));
+            bool takeNew = !takeOld && (i == previousContacts.size() || slotsBefore(contacts[j], previousContacts[i]));
+            if (takeOld) {
+                const Contact& c = previousContacts[i++];
+                events.push_back({ CollisionExit, c.a, c.b, 1.0f });
+            } else if (takeNew) {
+                const Contact& c = contacts[j++];
+                events.push_back({ CollisionEnter, c.a, c.b, c.toi });
+            } else {
+                const Contact& o = previousContacts[i++];
+                Contact& c = contacts[j++];
+                if (o.a != c.a || o.b != c.b) {
+                    events.push_back({ CollisionExit, o.a, o.b, 1.0f });
+                    events.push_back({ CollisionEnter, c.a, c.b, c.toi });
+                    continue;
+                }
+                c.nx = o.nx; c.ny = o.ny; c.normalImpulse = o.normalImpulse; c.tangentImpulse = o.tangentImpulse; // retested contacts keep the solver's cache
+                if (reportStay) events.push_back({ CollisionStay, c.a, c.b, c.toi });
+            }
+        }
+    }
+    vector<int> treeLeaf; // per slot
+    uint32_t stamp = 0;
+};
+
+// --------------------------- Rigid bodies ---------------------------
+// Sequential-impulse contact solver for the axis-aligned boxes CollisionWorld works with (there
+// is no rotation: collision ignores Transform::angle). Run it between detect() and dispatch(),
+// after the bodies were integrated:
+//  - the bodies in contacts are gathered into per-slot SoA arrays (inverse mass, velocity,
+//    position correction);
+//  - each contact between two RigidBodies becomes one constraint with its normal along the axis
+//    of least overlap, taken where the boxes met (swept contacts are rewound to their toi);
+//  - constraints are warm started with last tick's accumulated impulses (kept in the Contact);
+//  - velocity iterations, then position iterations, run island by island on the job system;
+//  - velocities go back to Velocity, corrections to Transform.
+struct RigidBodySolver {
+    int velocityIterations = 8; // more: stiffer piles, fewer: cheaper
+    int positionIterations = 3;
+    float slop = 0.5f;          // px of overlap left alone, so resting contacts don't jitter
+    float correction = 0.4f;    // share of the remaining overlap removed per position iteration
+    float bounceSpeed = 30.0f;  // px/s; slower impacts don't bounce
+    bool warmStart = true;
+
+    size_t constraintCount = 0; // in the last solve()
+    float maxOverlap = 0;       // deepest overlap left after the last solve(), px
+
+    void solve(CollisionWorld& cw, float dt) {
+        CollisionProxies& px = cw.proxies;
+        const size_t n = px.size();
+        const size_t m = cw.contacts.size();
+        constraintCount = 0; maxOverlap = 0;
+        invMass.resize(n); vx.resize(n); vy.resize(n); dx.resize(n); dy.resize(n);
+        gathered.assign(n, 0); anchored.assign(n, 1);
+        touched.clear();
+        auto movable = [&](uint32_t s) { return px.bodies[s]->mass > 0 && px.velocities[s] && px.transforms[s]; };
+        // an immovable body with a Velocity is kinematic: it pushes but isn't pushed
+        auto gather = [&](uint32_t s) {
+            if (gathered[s]) return;
+            gathered[s] = 1;
+            invMass[s] = movable(s) ? 1.0f / px.bodies[s]->mass : 0.0f;
+            vx[s] = px.velocities[s] ? px.velocities[s]->vx : 0.0f;
+            vy[s] = px.velocities[s] ? px.velocities[s]->vy : 0.0f;
+            dx[s] = 0; dy[s] = 0;
+            if (invMass[s] > 0) { anchored[s] = 0; touched.push_back(s); }
+        };
+
+        constraints.resize(m);
+        for (size_t k = 0; k < m; k++) {
+            Contact& c = cw.contacts[k];
+            Constraint& cc = constraints[k];
+            cc.live = px.bodies[c.proxyA] && px.bodies[c.proxyB] && (movable(c.proxyA) || movable(c.proxyB));
+            if (!cc.live) continue;
+            cc.a = c.proxyA; cc.b = c.proxyB;
+            gather(cc.a); gather(cc.b);
+            build(cc, c, px, dt);
+            constraintCount++;
+        }
+        if (!constraintCount) return;
+
+        // warm start, serially
+        for (size_t k = 0; k < m; k++) {
+            Constraint& cc = constraints[k];
+            if (!cc.live) continue;
+            const Contact& c = cw.contacts[k];
+            bool same = warmStart && c.nx == cc.nx && c.ny == cc.ny;
+            cc.normalImpulse = same ? c.normalImpulse : 0.0f;
+            cc.tangentImpulse = same ? c.tangentImpulse : 0.0f;
+            applyImpulse(cc, cc.nx * cc.normalImpulse - cc.ny * cc.tangentImpulse, cc.ny * cc.normalImpulse + cc.nx * cc.tangentImpulse);
+        }
+
+        cw.buildIslands(anchored.data());
+        cw.forEachIsland([&](const Island& is) {
+            const uint32_t* ids = cw.islandContacts.data() + is.first;
+            for (int it = 0; it < velocityIterations; it++)
+                for (uint32_t k = 0; k < is.count; k++) if (constraints[ids[k]].live) solveVelocity(constraints[ids[k]]);
+            for (int it = 0; it < positionIterations; it++)
+                for (uint32_t k = 0; k < is.count; k++) if (constraints[ids[k]].live) solvePosition(constraints[ids[k]]);
+        });
+
+        for (size_t k = 0; k < m; k++) {
+            const Constraint& cc = constraints[k];
+            if (!cc.live) continue;
+            Contact& c = cw.contacts[k];
+            c.nx = cc.nx; c.ny = cc.ny; c.normalImpulse = cc.normalImpulse; c.tangentImpulse = cc.tangentImpulse;
+            maxOverlap = std::max(maxOverlap, -separation(cc));
+        }
+        for (uint32_t s : touched) {
+            px.velocities[s]->vx = vx[s]; px.velocities[s]->vy = vy[s];
+            px.transforms[s]->x += dx[s]; px.transforms[s]->y += dy[s];
+            // keep the proxy in step, so the next sweep starts from the corrected box; the push
+            // counts as a move, so its pairs get tested and a sleeper leaves the sleepers' grid
+            for (AABB* b : { &px.boxes[s], &px.previous[s] }) { b->minX += dx[s]; b->maxX += dx[s]; b->minY += dy[s]; b->maxY += dy[s]; }
+            px.restarted[s] |= dx[s] != 0 || dy[s] != 0;
+        }
+    }
+
+private:
+    struct Constraint {
+        uint32_t a = 0, b = 0;
+        float nx = 0, ny = 0;
+        float separation = 0;       // along the normal at the end of the step; < 0: overlap
+        float normalMass = 0;       // 1 / (invMassA + invMassB); no rotation, so also the tangent mass
+        float friction = 0;
+        float targetSpeed = 0;      // normal speed the velocity iterations aim for
+        float normalImpulse = 0, tangentImpulse = 0;
+        bool live = false;
+    };
+    vector<Constraint> constraints; // per contact
+    vector<float> invMass, vx, vy, dx, dy; // per slot
+    vector<uint8_t> gathered;       // per slot
+    vector<uint8_t> anchored;       // per slot: not moved by the solver
+    vector<uint32_t> touched;       // movable slots in some constraint
+
+    void build(Constraint& cc, const Contact& c, const CollisionProxies& px, float dt) {
+        const AABB& A = px.boxes[cc.a];
+        const AABB& B = px.boxes[cc.b];
+        // where the boxes met: a swept contact is rewound to its time of impact
+        float back = (1.0f - c.toi) * dt;
+        float ax = -vx[cc.a] * back, ay = -vy[cc.a] * back;
+        float bx = -vx[cc.b] * back, by = -vy[cc.b] * back;
+        float overlapX = std::min(A.maxX + ax, B.maxX + bx) - std::max(A.minX + ax, B.minX + bx);
+        float overlapY = std::min(A.maxY + ay, B.maxY + by) - std::max(A.minY + ay, B.minY + by);
+        float centreX = (B.minX + B.maxX + 2 * bx) - (A.minX + A.maxX + 2 * ax);
+        float centreY = (B.minY + B.maxY + 2 * by) - (A.minY + A.maxY + 2 * ay);
+        if (overlapX < overlapY) {
+            cc.nx = centreX < 0 ? -1.0f : 1.0f; cc.ny = 0;
+            cc.separation = cc.nx > 0 ? B.minX - A.maxX : A.minX - B.maxX;
+        } else {
+            cc.nx = 0; cc.ny = centreY < 0 ? -1.0f : 1.0f;
+            cc.separation = cc.ny > 0 ? B.minY - A.maxY : A.minY - B.maxY;
+        }
+        const RigidBody& ra = *px.bodies[cc.a];
+        const RigidBody& rb = *px.bodies[cc.b];
+        cc.normalMass = 1.0f / (invMass[cc.a] + invMass[cc.b]);
+        cc.friction = std::sqrt(ra.friction * rb.friction);
+        // a gap may close at most by its width this step; an impact faster than bounceSpeed bounces
+        float vn = (vx[cc.b] - vx[cc.a]) * cc.nx + (vy[cc.b] - vy[cc.a]) * cc.ny;
+        cc.targetSpeed = cc.separation > 0 ? -cc.separation / dt : 0.0f;
+        if (vn < -bounceSpeed && vn * dt < -cc.separation) cc.targetSpeed = std::max(cc.targetSpeed, -std::max(ra.restitution, rb.restitution) * vn);
+    }
+
+    // Impulse (px, py) from a onto b. Anchored bodies are never written: they may be shared by
+    // islands solved on other threads.
+    void applyImpulse(const Constraint& cc, float ix, float iy) {
+        if (invMass[cc.a] > 0) { vx[cc.a] -= ix * invMass[cc.a]; vy[cc.a] -= iy * invMass[cc.a]; }
+        if (invMass[cc.b] > 0) { vx[cc.b] += ix * invMass[cc.b]; vy[cc.b] += iy * invMass[cc.b]; }
+    }
+
+    void solveVelocity(Constraint& cc) {
+        const float tx = -cc.ny, ty = cc.nx;
+        float rvx = vx[cc.b] - vx[cc.a], rvy = vy[cc.b] - vy[cc.a];
+        // friction first, bounded by the normal impulse so far (Coulomb)
+        float limit = cc.friction * cc.normalImpulse;
+        float t = std::clamp(cc.tangentImpulse - (rvx * tx + rvy * ty) * cc.normalMass, -limit, limit);
+        float dtan = t - cc.tangentImpulse;
+        cc.tangentImpulse = t;
+        applyImpulse(cc, tx * dtan, ty * dtan);
+        rvx = vx[cc.b] - vx[cc.a]; rvy = vy[cc.b] - vy[cc.a];
+        // normal: push until the approach speed meets the target; impulses only push, never pull
+        float n = std::max(cc.normalImpulse - (rvx * cc.nx + rvy * cc.ny - cc.targetSpeed) * cc.normalMass, 0.0f);
+        float dn = n - cc.normalImpulse;
+        cc.normalImpulse = n;
+        applyImpulse(cc, cc.nx * dn, cc.ny * dn);
+    }
+
+    float separation(const Constraint& cc) const {
+        return cc.separation + (dx[cc.b] - dx[cc.a]) * cc.nx + (dy[cc.b] - dy[cc.a]) * cc.ny;
+    }
+
+    // Move overlapping bodies apart along the normal, shared by inverse mass
+    void solvePosition(const Constraint& cc) {
+        float c = separation(cc) + slop;
+        if (c >= 0) return;
+        float push = -c * correction * cc.normalMass;
+        if (invMass[cc.a] > 0) { dx[cc.a] -= cc.nx * push * invMass[cc.a]; dy[cc.a] -= cc.ny * push * invMass[cc.a]; }
+        if (invMass[cc.b] > 0) { dx[cc.b] += cc.nx * push * invMass[cc.b]; dy[cc.b] += cc.ny * push * invMass[cc.b]; }
+    }
+};
+
+// --------------------------- Cost grid ---------------------------
+// Movement costs over a rectangle of square cells, for the grid navigators (FlowField,
+// GridPathfinder): 1..254 per cell entered, Blocked for walls. Steps go 8 ways and cost 10
+// straight or 14 diagonally, times the cost of the cell entered; a diagonal step never squeezes
+// past a wall corner. version() changes with every edit, so navigators know when to rebuild.
+struct CostGrid {
+    static constexpr uint8_t Blocked = 255;
+    static constexpr int stepX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static constexpr int stepY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+    // Cells of `cellSize` px starting at (originX, originY), all of cost 1
+    void resize(int columns, int rowCount, float cellSize, float originX = 0, float originY = 0) {
+        cols = std::max(columns, 1); rows = std::max(rowCount, 1);
+        cell = std::max(cellSize, 1.0f); invCell = 1.0f / cell; x0 = originX; y0 = originY;
+        cost.assign((size_t)cols * rows, 1);
+        changes++;
+    }
+
+    int columns() const { return cols; }
+    int rowCount() const { return rows; }
+    float cellSize() const { return cell; }
+    size_t size() const { return cost.size(); }
+    uint64_t version() const { return changes; }
+
+    bool inside(int cx, int cy) const { return cx >= 0 && cy >= 0 && cx < cols && cy < rows; }
+    uint8_t at(int cx, int cy) const { return cost[(size_t)cy * cols + cx]; }
+    bool open(int cx, int cy) const { return inside(cx, cy) && at(cx, cy) != Blocked; }
+    bool canStep(int cx, int cy, int dx, int dy) const {
+        return open(cx + dx, cy + dy) && (dx == 0 || dy == 0 || (open(cx + dx, cy) && open(cx, cy + dy)));
+    }
+    uint32_t stepCost(int cx, int cy, bool diagonal) const { return (diagonal ? 14u : 10u) * at(cx, cy); } // entering (cx, cy)
+
+    void set(int cx, int cy, uint8_t c) {
+        if (!inside(cx, cy)) return;
+        uint8_t& slot = cost[(size_t)cy * cols + cx];
+        c = std::max<uint8_t>(c, 1);
+        if (slot != c) { slot = c; changes++; }
+    }
+    // Every cell the box touches
+    void fillRect(const AABB& box, uint8_t c) {
+        int cx0 = std::max(cellX(box.minX), 0), cx1 = std::min(cellX(box.maxX), cols - 1);
+        int cy0 = std::max(cellY(box.minY), 0), cy1 = std::min(cellY(box.maxY), rows - 1);
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) set(cx, cy, c);
+    }
+
+    int cellX(float x) const { return (int)std::floor((x - x0) * invCell); }
+    int cellY(float y) const { return (int)std::floor((y - y0) * invCell); }
+    float centerX(int cx) const { return x0 + ((float)cx + 0.5f) * cell; }
+    float centerY(int cy) const { return y0 + ((float)cy + 0.5f) * cell; }
+
+private:
+    int cols = 0, rows = 0;
+    float cell = 32, invCell = 1.0f / 32, x0 = 0, y0 = 0;
+    vector<uint8_t> cost;
+    uint64_t changes = 0;
+};
+
+// --------------------------- Flow fields ---------------------------
+// Paths toward one target for any number of chasers. The field's CostGrid is integrated outward
+// from the target's cell with Dijkstra, and each cell then points at its cheapest neighbour, so
+// a chaser needs one lookup to know where to go.
+//
+// The build is time-sliced and double-buffered: update() settles at most `budget` cells per
+// call, and once the last cell is settled computes the directions (in parallel on the job system)
+// and swaps them in; until then direction() keeps answering from the previous field. A finished
+// field is rebuilt when the target has entered another cell or costs changed. A target that moves
+// during a build doesn't restart it, so a field is always completed.
+struct FlowField {
+    static constexpr uint8_t Blocked = CostGrid::Blocked;
+    static constexpr uint32_t Unreached = UINT32_MAX;
+
+    void setJobs(JobSystem* j) { jobs = j; }
+
+    // Cells of `cellSize` px starting at (originX, originY), all of cost 1; drops any field
+    void resize(int columns, int rowCount, float cellSize, float originX = 0, float originY = 0) {
+        grid.resize(columns, rowCount, cellSize, originX, originY);
+        const size_t n = grid.size();
+        work.assign(n, Unreached); integration.assign(n, Unreached);
+        flow.assign(n, NoDir); nextFlow.assign(n, NoDir);
+        clearQueue();
+        source = -1; published = -1; building = false;
+    }
+
+    int columns() const { return grid.columns(); }
+    int rowCount() const { return grid.rowCount(); }
+    float cellSize() const { return grid.cellSize(); }
+    const CostGrid& costs() const { return grid; }
+
+    uint8_t costAt(int cx, int cy) const { return grid.at(cx, cy); }
+    void setCost(int cx, int cy, uint8_t c) { grid.set(cx, cy, c); }
+    void fillRect(const AABB& box, uint8_t c) { grid.fillRect(box, c); }
+
+    // Keep the field aimed at the point (x, y), clamped into the grid. Returns true when a new
+    // field was published by this call.
+    bool update(float x, float y, size_t budget) {
+        int target = clampedCell(x, y);
+        if (!building && (target != source || grid.version() != builtVersion)) restart(target);
+        if (!building) return false;
+        settle(budget);
+        if (pending) return false;
+        publish();
+        return true;
+    }
+
+    bool ready() const { return published >= 0; }           // a complete field is being sampled
+    bool rebuilding() const { return building; }
+    int targetCell() const { return published; }             // cell index of the published field, -1 = none
+
+    // Unit direction toward the target from the point (x, y). False outside the grid, in the
+    // target's cell, and where the target can't be reached.
+    bool direction(float x, float y, float& dx, float& dy) const {
+        int cx = grid.cellX(x), cy = grid.cellY(y);
+        if (!grid.inside(cx, cy)) return false;
+        uint8_t d = flow[(size_t)cy * grid.columns() + cx];
+        if (d == NoDir) return false;
+        dx = dirUnitX[d]; dy = dirUnitY[d];
+        return true;
+    }
+    // Published path cost from cell (cx, cy) to the target (see CostGrid); Unreached when there's no path
+    uint32_t distance(int cx, int cy) const { return integration[(size_t)cy * grid.columns() + cx]; }
+
+private:
+    static constexpr uint8_t NoDir = 8;
+    static constexpr float dirUnitX[8] = { 1, 0.70710678f, 0, -0.70710678f, -1, -0.70710678f, 0, 0.70710678f };
+    static constexpr float dirUnitY[8] = { 0, 0.70710678f, 1, 0.70710678f, 0, -0.70710678f, -1, -0.70710678f };
+    static const size_t RowGrain = 16;
+
+    JobSystem* jobs = nullptr;
+    CostGrid grid;
+    uint64_t builtVersion = 0;          // grid version the last build started from
+    vector<uint32_t> work, integration; // being built / published
+    vector<uint8_t> flow, nextFlow;     // published / being built: 0..7 into CostGrid::stepX/stepY, NoDir = none
+    // Dijkstra queue: edge costs are small integers, so cells wait in a ring of buckets by
+    // distance (Dial's algorithm) instead of a heap; entries made stale by a shorter path are skipped
+    static const uint32_t BucketCount = 14 * 254 + 1; // longer than the costliest step
+    vector<vector<uint32_t>> buckets;
+    size_t pending = 0;
+    uint32_t cursor = 0;
+    int source = -1, published = -1;
+    bool building = false;
+
+    int clampedCell(float x, float y) const {
+        if (grid.size() == 0) return -1;
+        int cx = std::clamp(grid.cellX(x), 0, grid.columns() - 1), cy = std::clamp(grid.cellY(y), 0, grid.rowCount() - 1);
+        return cy * grid.columns() + cx;
+    }
+
+    // CostGrid::canStep from an open cell, except that the target's cell may be entered even when
+    // it is a wall (a target standing against one)
+    bool stepsInto(int cx, int cy, int dx, int dy) const {
+        if (!grid.open(cx, cy) || !grid.inside(cx + dx, cy + dy)) return false;
+        if ((cy + dy) * grid.columns() + (cx + dx) != source) return grid.canStep(cx, cy, dx, dy);
+        return dx == 0 || dy == 0 || (grid.open(cx + dx, cy) && grid.open(cx, cy + dy));
+    }
+
+    void restart(int target) {
+        source = target; builtVersion = grid.version();
+        building = target >= 0;
+        if (!building) return;
+        if (jobs) jobs->parallelFor(work.size(), 1 << 16, [&](size_t b, size_t e, int) { std::fill(work.begin() + b, work.begin() + e, Unreached); });
+        else std::fill(work.begin(), work.end(), Unreached);
+        clearQueue();
+        work[target] = 0;
+        push(0, (uint32_t)target);
+    }
+
+    void clearQueue() {
+        buckets.resize(BucketCount);
+        for (auto &b : buckets) b.clear();
+        pending = 0; cursor = 0;
+    }
+    void push(uint32_t d, uint32_t c) { buckets[d % BucketCount].push_back(c); pending++; }
+
+    void settle(size_t budget) {
+        const int cols = grid.columns();
+        for (size_t done = 0; done < budget && pending; ) {
+            vector<uint32_t>& bucket = buckets[cursor % BucketCount];
+            if (bucket.empty()) { cursor++; continue; }
+            uint32_t c = bucket.back();
+            bucket.pop_back();
+            pending--;
+            if (work[c] != cursor) continue; // stale: a shorter path came along
+            const uint32_t d = cursor;
+            done++;
+            // outward from the target: a chaser on the neighbour would step back into c, paying for c
+            int cx = (int)(c % cols), cy = (int)(c / cols);
+            for (int k = 0; k < 8; k++) {
+                const int sx = CostGrid::stepX[k], sy = CostGrid::stepY[k];
+                if (!stepsInto(cx + sx, cy + sy, -sx, -sy)) continue;
+                size_t ni = (size_t)(cy + sy) * cols + (cx + sx);
+                uint32_t nd = d + grid.stepCost(cx, cy, sx != 0 && sy != 0);
+                if (nd < work[ni]) { work[ni] = nd; push(nd, (uint32_t)ni); }
+            }
+        }
+    }
+
+    // Each reached cell points at the neighbour its distance came through (the cheapest step plus
+    // remaining distance, first in step order on ties), row bands in parallel; then the new field
+    // replaces the old one
+    void publish() {
+        const int cols = grid.columns();
+        auto rowsRange = [&](size_t b, size_t e, int) {
+            for (int cy = (int)b; cy < (int)e; cy++) {
+                for (int cx = 0; cx < cols; cx++) {
+                    size_t i = (size_t)cy * cols + cx;
+                    uint8_t best = NoDir;
+                    if (work[i] != Unreached && work[i] != 0) {
+                        uint64_t bestD = UINT64_MAX;
+                        for (int k = 0; k < 8; k++) {
+                            const int sx = CostGrid::stepX[k], sy = CostGrid::stepY[k];
+                            if (!stepsInto(cx, cy, sx, sy)) continue;
+                            uint32_t nd = work[(size_t)(cy + sy) * cols + (cx + sx)];
+                            if (nd == Unreached) continue;
+                            uint64_t via = (uint64_t)nd + grid.stepCost(cx + sx, cy + sy, sx != 0 && sy != 0);
+                            if (via < bestD) { bestD = via; best = (uint8_t)k; }
+                        }
+                    }
+                    nextFlow[i] = best;
+                }
+            }
+        };
+        if (jobs) jobs->parallelFor((size_t)grid.rowCount(), RowGrain, rowsRange);
+        else rowsRange(0, (size_t)grid.rowCount(), 0);
+        swap(work, integration);
+        swap(flow, nextFlow);
+        published = source;
+        building = false;
+    }
+};
+
+// --------------------------- Grid pathfinding ---------------------------
+// Point-to-point paths on a CostGrid, for agents with goals of their own (a FlowField serves
+// many agents with one goal). Three layers:
+//  - A* with the octile heuristic. The open list is a binary heap and the per-cell records are
+//    stamped with a query number; both are kept between queries, so once they have grown a query
+//    allocates nothing;
+//  - HPA*: the grid is cut into clusters of clusterSize x clusterSize cells. Each run of open
+//    cells along a cluster border gets entrances (one in the middle, or one at each end of a long
+//    run), and the entrances of a cluster are linked by their cost inside it. A query between
+//    clusters links its start and goal into that graph, searches the graph, then fills in each
+//    hop with A* inside one cluster, so no search covers more than a cluster however large the
+//    map. Paths come out near-optimal rather than optimal; ends in touching clusters first try
+//    A* over the two, since short trips suffer most from being routed through entrances;
+//  - a cache of graph routes keyed by (start cluster, goal cluster), so agents travelling between
+//    the same two areas skip the graph search (and share its entrances).
+// The graph and cache are rebuilt when the grid's version changes. Queries queued with request()
+// run in update(), which starts no new query once `budget` cells and graph nodes were expanded
+// this call; a query always finishes once started.
+struct GridPathfinder {
+    struct Point { float x, y; }; // cell centers, px
+    using Done = function<void(bool found, const vector<Point>& path)>;
+
+    int clusterSize = 16;     // cells; takes effect at the next graph rebuild
+    size_t cacheLimit = 4096; // routes kept before the cache starts over; 0 = no cache
+
+    size_t expanded = 0;                   // by the last findPath()/findCells()/update()
+    size_t cacheHits = 0, cacheMisses = 0; // since the graph was last built
+
+    void setGrid(const CostGrid* g) { grid = g; builtVersion = UINT64_MAX; }
+
+    // Path between two points as waypoints: the start cell's center, each corner, the goal
+    // cell's center. False when either end is outside the grid or walled off, or no path exists.
+    bool findPath(float fromX, float fromY, float toX, float toY, vector<Point>& out) {
+        expanded = 0;
+        return query(fromX, fromY, toX, toY, out);
+    }
+
+    // Cell indices (cy * columns + cx) from start to goal; plain A* over the whole grid with
+    // hierarchical = false, which is optimal
+    bool findCells(int sx, int sy, int gx, int gy, vector<uint32_t>& cells, bool hierarchical = true) {
+        expanded = 0;
+        cells.clear();
+        if (!grid || !grid->open(sx, sy) || !grid->open(gx, gy)) return false;
+        const uint32_t s = cellIndex(sx, sy), g = cellIndex(gx, gy);
+        if (!hierarchical) {
+            if (!search(s, (int)g, { 0, 0, grid->columns() - 1, grid->rowCount() - 1 }, false)) return false;
+            appendPath(s, g, cells);
+            return true;
+        }
+        return hierarchicalPath(s, g, cells);
+    }
+
+    // Builds the cluster graph now if the grid or clusterSize changed since the last build (queries
+    // otherwise build it on first use); `expanded` counts the cells the build searched
+    void prepare() {
+        expanded = 0;
+        if (grid && graphStale()) buildGraph();
+    }
+
+    void request(float fromX, float fromY, float toX, float toY, Done done) {
+        queue.push_back({ fromX, fromY, toX, toY, std::move(done) });
+    }
+    size_t pendingCount() const { return queue.size(); }
+
+    // Run queued requests in order, calling each one's callback, until `budget` expansions are used
+    void update(size_t budget) {
+        expanded = 0;
+        while (!queue.empty() && expanded < budget) {
+            Request r = std::move(queue.front());
+            queue.pop_front();
+            bool found = query(r.fromX, r.fromY, r.toX, r.toY, points);
+            if (r.done) r.done(found, points);
+        }
+    }
+
+private:
+    struct Box { int x0, y0, x1, y1; }; // inclusive cell range a search stays in
+    struct Open { uint32_t f, h, cell; };
+    struct Edge { uint32_t to, cost; };
+    struct Request { float fromX, fromY, toX, toY; Done done; };
+
+    const CostGrid* grid = nullptr;
+    uint64_t builtVersion = UINT64_MAX;
+    int usedCluster = 16, clustersX = 0, clustersY = 0;
+
+    // cell search records, valid where stamp == query
+    vector<uint32_t> gCost, parent, stamp, closedStamp;
+    uint32_t searchId = 0;
+    vector<Open> open;
+
+    // abstract graph: entrance cells, edges within and between clusters
+    vector<uint32_t> nodeCell;
+    vector<vector<Edge>> edges;
+    vector<vector<uint32_t>> clusterNodes;
+    vector<int32_t> nodeOf; // per cell, -1 = not an entrance
+    // graph search records, valid where nodeStamp == graphSearchId; two extra slots for start and goal
+    vector<uint32_t> nodeG, nodeParent, nodeStamp, nodeClosed;
+    uint32_t graphSearchId = 0;
+    vector<Open> nodeOpen;
+    vector<uint32_t> startCost, goalCost; // per node of the start/goal cluster, UINT32_MAX = unreachable
+
+    unordered_map<uint64_t, vector<uint32_t>> routes; // (start cluster, goal cluster) -> graph nodes
+    deque<Request> queue;
+    vector<uint32_t> cells, route, segment;
+    vector<Point> points;
+
+    uint32_t cellIndex(int cx, int cy) const { return (uint32_t)cy * (uint32_t)grid->columns() + (uint32_t)cx; }
+    int cellXOf(uint32_t c) const { return (int)(c % (uint32_t)grid->columns()); }
+    int cellYOf(uint32_t c) const { return (int)(c / (uint32_t)grid->columns()); }
+    int clusterOf(uint32_t c) const { return (cellYOf(c) / usedCluster) * clustersX + cellXOf(c) / usedCluster; }
+    Box clusterBox(int k) const {
+        int cx = (k % clustersX) * usedCluster, cy = (k / clustersX) * usedCluster;
+        return { cx, cy, std::min(cx + usedCluster, grid->columns()) - 1, std::min(cy + usedCluster, grid->rowCount()) - 1 };
+    }
+    // Octile distance at the cheapest cost, never more than the real cost
+    static uint32_t octile(int dx, int dy) {
+        dx = abs(dx); dy = abs(dy);
+        return 10u * (uint32_t)std::max(dx, dy) + 4u * (uint32_t)std::min(dx, dy);
+    }
+    static bool later(const Open& a, const Open& b) { return a.f != b.f ? a.f > b.f : a.h > b.h; }
+
+    bool query(float fromX, float fromY, float toX, float toY, vector<Point>& out) {
+        out.clear();
+        if (!grid) return false;
+        int sx = grid->cellX(fromX), sy = grid->cellY(fromY), gx = grid->cellX(toX), gy = grid->cellY(toY);
+        if (!grid->open(sx, sy) || !grid->open(gx, gy)) return false;
+        if (!hierarchicalPath(cellIndex(sx, sy), cellIndex(gx, gy), cells)) return false;
+        // keep the ends and the cells where the direction changes
+        for (size_t i = 0; i < cells.size(); i++) {
+            if (i > 0 && i + 1 < cells.size()) {
+                int ax = cellXOf(cells[i]) - cellXOf(cells[i - 1]), ay = cellYOf(cells[i]) - cellYOf(cells[i - 1]);
+                int bx = cellXOf(cells[i + 1]) - cellXOf(cells[i]), by = cellYOf(cells[i + 1]) - cellYOf(cells[i]);
+                if (ax == bx && ay == by) continue;
+            }
+            out.push_back({ grid->centerX(cellXOf(cells[i])), grid->centerY(cellYOf(cells[i])) });
+        }
+        return true;
+    }
+
+    // Best-first search from `start` inside `box`. With a goal: A* until the goal is closed, true
+    // when it was reached. Without (goal < 0): Dijkstra over the whole box, always true. `reverse`
+    // charges each step the cost of the cell left rather than the one entered, which searching
+    // outward from a goal needs. Results stay in gCost/parent for the cells stamped this search.
+    bool search(uint32_t start, int goal, const Box& box, bool reverse) {
+        const size_t n = grid->size();
+        if (gCost.size() != n) { gCost.assign(n, 0); parent.assign(n, 0); stamp.assign(n, 0); closedStamp.assign(n, 0); searchId = 0; }
+        if (++searchId == 0) { fill(stamp.begin(), stamp.end(), 0); fill(closedStamp.begin(), closedStamp.end(), 0); searchId = 1; }
+        const int gx = goal >= 0 ? cellXOf((uint32_t)goal) : 0, gy = goal >= 0 ? cellYOf((uint32_t)goal) : 0;
+        auto heuristic = [&](int cx, int cy) { return goal >= 0 ? octile(cx - gx, cy - gy) : 0u; };
+        open.clear();
+        gCost[start] = 0; parent[start] = start; stamp[start] = searchId;
+        open.push_back({ heuristic(cellXOf(start), cellYOf(start)), 0, start });
+        while (!open.empty()) {
+            pop_heap(open.begin(), open.end(), later);
+            const uint32_t c = open.back().cell;
+            open.pop_back();
+            if (closedStamp[c] == searchId) continue; // stale entry
+            closedStamp[c] = searchId;
+            expanded++;
+            if ((int)c == goal) return true;
+            const int cx = cellXOf(c), cy = cellYOf(c);
+            for (int k = 0; k < 8; k++) {
+                const int dx = CostGrid::stepX[k], dy = CostGrid::stepY[k];
+                const int nx = cx + dx, ny = cy + dy;
+                if (nx < box.x0 || ny < box.y0 || nx > box.x1 || ny > box.y1) continue;
+                // a reverse search walks the real steps backwards, so it checks the step from the neighbour
+                if (reverse ? !grid->canStep(nx, ny, -dx, -dy) : !grid->canStep(cx, cy, dx, dy)) continue;
+                const uint32_t ni = cellIndex(nx, ny);
+                if (closedStamp[ni] == searchId) continue;
+                const bool diagonal = dx != 0 && dy != 0;
+                const uint32_t g = gCost[c] + (reverse ? grid->stepCost(cx, cy, diagonal) : grid->stepCost(nx, ny, diagonal));
+                if (stamp[ni] == searchId && g >= gCost[ni]) continue;
+                gCost[ni] = g; parent[ni] = c; stamp[ni] = searchId;
+                const uint32_t h = heuristic(nx, ny);
+                open.push_back({ g + h, h, ni });
+                push_heap(open.begin(), open.end(), later);
+            }
+        }
+        return goal < 0;
+    }
+
+    bool reached(uint32_t c) const { return stamp[c] == searchId; }
+
+    // Append the cells of the last forward search from `from` to `to`, skipping `from` when
+    // `out` already ends there
+    void appendPath(uint32_t from, uint32_t to, vector<uint32_t>& out) {
+        segment.clear();
+        for (uint32_t c = to; c != from; c = parent[c]) segment.push_back(c);
+        if (out.empty() || out.back() != from) out.push_back(from);
+        out.insert(out.end(), segment.rbegin(), segment.rend());
+    }
+
+    // A* between two cells of one cluster, appended to `out`
+    bool refineInCluster(uint32_t from, uint32_t to, vector<uint32_t>& out) {
+        if (from == to) { if (out.empty() || out.back() != from) out.push_back(from); return true; }
+        if (!search(from, (int)to, clusterBox(clusterOf(from)), false)) return false;
+        appendPath(from, to, out);
+        return true;
+    }
+
+    void addEntrance(uint32_t a, uint32_t b) {
+        uint32_t ids[2];
+        const uint32_t pair[2] = { a, b };
+        for (int k = 0; k < 2; k++) {
+            uint32_t c = pair[k];
+            if (nodeOf[c] < 0) {
+                nodeOf[c] = (int32_t)nodeCell.size();
+                nodeCell.push_back(c);
+                edges.emplace_back();
+                clusterNodes[clusterOf(c)].push_back((uint32_t)nodeOf[c]);
+            }
+            ids[k] = (uint32_t)nodeOf[c];
+        }
+        const bool diagonal = false; // borders are crossed straight
+        edges[ids[0]].push_back({ ids[1], grid->stepCost(cellXOf(b), cellYOf(b), diagonal) });
+        edges[ids[1]].push_back({ ids[0], grid->stepCost(cellXOf(a), cellYOf(a), diagonal) });
+    }
+
+    // Entrances along the border between cells (x, y) and (x + ox, y + oy), walking (wx, wy) for
+    // `length` cells
+    void scanBorder(int x, int y, int ox, int oy, int wx, int wy, int length) {
+        int runStart = -1;
+        for (int i = 0; i <= length; i++) {
+            int ax = x + wx * i, ay = y + wy * i;
+            bool both = i < length && grid->open(ax, ay) && grid->open(ax + ox, ay + oy);
+            if (both && runStart < 0) runStart = i;
+            if (both || runStart < 0) continue;
+            int last = i - 1;
+            auto entrance = [&](int j) { addEntrance(cellIndex(x + wx * j, y + wy * j), cellIndex(x + wx * j + ox, y + wy * j + oy)); };
+            if (last - runStart + 1 >= 6) { entrance(runStart); entrance(last); }
+            else entrance((runStart + last) / 2);
+            runStart = -1;
+        }
+    }
+
+    bool graphStale() const { return builtVersion != grid->version() || usedCluster != std::max(clusterSize, 2); }
+
+    void buildGraph() {
+        builtVersion = grid->version();
+        usedCluster = std::max(clusterSize, 2);
+        clustersX = (grid->columns() + usedCluster - 1) / usedCluster;
+        clustersY = (grid->rowCount() + usedCluster - 1) / usedCluster;
+        nodeCell.clear(); edges.clear(); routes.clear();
+        clusterNodes.assign((size_t)clustersX * clustersY, {});
+        nodeOf.assign(grid->size(), -1);
+        cacheHits = cacheMisses = 0;
+        for (int ky = 0; ky < clustersY; ky++) {
+            for (int kx = 0; kx < clustersX; kx++) {
+                Box b = clusterBox(ky * clustersX + kx);
+                if (b.x1 + 1 < grid->columns()) scanBorder(b.x1, b.y0, 1, 0, 0, 1, b.y1 - b.y0 + 1); // right neighbour
+                if (b.y1 + 1 < grid->rowCount()) scanBorder(b.x0, b.y1, 0, 1, 1, 0, b.x1 - b.x0 + 1); // lower neighbour
+            }
+        }
+        // link the entrances of each cluster: one Dijkstra per entrance covers all its partners
+        for (int k = 0; k < clustersX * clustersY; k++) {
+            const vector<uint32_t>& ids = clusterNodes[k];
+            if (ids.size() < 2) continue;
+            for (uint32_t a : ids) {
+                search(nodeCell[a], -1, clusterBox(k), false);
+                for (uint32_t b : ids)
+                    if (b != a && reached(nodeCell[b])) edges[a].push_back({ b, gCost[nodeCell[b]] });
+            }
+        }
+        const size_t slots = nodeCell.size() + 2;
+        nodeG.assign(slots, 0); nodeParent.assign(slots, 0); nodeStamp.assign(slots, 0); nodeClosed.assign(slots, 0);
+        graphSearchId = 0;
+    }
+
+    // A* over the graph from a virtual start node (linked to the start cluster's entrances by
+    // startCost) to a virtual goal node (linked from the goal cluster's by goalCost). Fills
+    // `route` with the entrances in between.
+    bool searchGraph(int startCluster, int goalCluster, uint32_t goalCell) {
+        const uint32_t S = (uint32_t)nodeCell.size(), G = S + 1;
+        if (++graphSearchId == 0) { fill(nodeStamp.begin(), nodeStamp.end(), 0); fill(nodeClosed.begin(), nodeClosed.end(), 0); graphSearchId = 1; }
+        const int gx = cellXOf(goalCell), gy = cellYOf(goalCell);
+        auto h = [&](uint32_t v) { return v >= S ? 0u : octile(cellXOf(nodeCell[v]) - gx, cellYOf(nodeCell[v]) - gy); };
+        const vector<uint32_t>& goalIds = clusterNodes[goalCluster];
+        auto relax = [&](uint32_t from, uint32_t to, uint32_t cost) {
+            if (nodeClosed[to] == graphSearchId) return;
+            uint32_t g = nodeG[from] + cost;
+            if (nodeStamp[to] == graphSearchId && g >= nodeG[to]) return;
+            nodeG[to] = g; nodeParent[to] = from; nodeStamp[to] = graphSearchId;
+            nodeOpen.push_back({ g + h(to), h(to), to });
+            push_heap(nodeOpen.begin(), nodeOpen.end(), later);
+        };
+        nodeOpen.clear();
+        nodeG[S] = 0; nodeStamp[S] = graphSearchId;
+        nodeOpen.push_back({ 0, 0, S });
+        while (!nodeOpen.empty()) {
+            pop_heap(nodeOpen.begin(), nodeOpen.end(), later);
+            const uint32_t v = nodeOpen.back().cell;
+            nodeOpen.pop_back();
+            if (nodeClosed[v] == graphSearchId) continue;
+            nodeClosed[v] = graphSearchId;
+            expanded++;
+            if (v == G) break;
+            if (v == S) {
+                const vector<uint32_t>& ids = clusterNodes[startCluster];
+                for (size_t i = 0; i < ids.size(); i++) if (startCost[i] != UINT32_MAX) relax(S, ids[i], startCost[i]);
+                continue;
+            }
+            for (const Edge& e : edges[v]) relax(v, e.to, e.cost);
+            if (clusterOf(nodeCell[v]) == goalCluster) {
+                size_t i = find(goalIds.begin(), goalIds.end(), v) - goalIds.begin();
+                if (goalCost[i] != UINT32_MAX) relax(v, G, goalCost[i]);
+            }
+        }
+        if (nodeClosed[G] != graphSearchId) return false;
+        route.clear();
+        for (uint32_t v = nodeParent[G]; v != S; v = nodeParent[v]) route.push_back(v);
+        reverse(route.begin(), route.end());
+        return !route.empty();
+    }
+
+    bool hierarchicalPath(uint32_t s, uint32_t g, vector<uint32_t>& out) {
+        out.clear();
+        if (graphStale()) buildGraph();
+        const int sc = clusterOf(s), gc = clusterOf(g);
+        // close by (the same or touching clusters): A* over both clusters is small and avoids the
+        // detours through entrances that short trips would take; it may still need to go further
+        if (abs(sc % clustersX - gc % clustersX) <= 1 && abs(sc / clustersX - gc / clustersX) <= 1) {
+            Box a = clusterBox(sc), b = clusterBox(gc);
+            if (search(s, (int)g, { std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) }, false)) {
+                appendPath(s, g, out);
+                return true;
+            }
+        }
+
+        const uint64_t key = (uint64_t)(uint32_t)sc << 32 | (uint32_t)gc;
+        auto hit = cacheLimit ? routes.find(key) : routes.end();
+        if (hit != routes.end()) {
+            route = hit->second;
+            if (refineInCluster(s, nodeCell[route.front()], out) && refineRoute(g, out)) { cacheHits++; return true; }
+            out.clear(); // this start or goal can't use the cached entrances
+        }
+        cacheMisses++;
+
+        // costs from s to its cluster's entrances, and from the goal cluster's entrances to g
+        const vector<uint32_t>& startIds = clusterNodes[sc];
+        const vector<uint32_t>& goalIds = clusterNodes[gc];
+        search(s, -1, clusterBox(sc), false);
+        startCost.resize(startIds.size());
+        for (size_t i = 0; i < startIds.size(); i++) startCost[i] = reached(nodeCell[startIds[i]]) ? gCost[nodeCell[startIds[i]]] : UINT32_MAX;
+        search(g, -1, clusterBox(gc), true);
+        goalCost.resize(goalIds.size());
+        for (size_t i = 0; i < goalIds.size(); i++) goalCost[i] = reached(nodeCell[goalIds[i]]) ? gCost[nodeCell[goalIds[i]]] : UINT32_MAX;
+
+        if (!searchGraph(sc, gc, g)) return false;
+        if (cacheLimit) {
+            if (routes.size() >= cacheLimit) routes.clear();
+            routes[key] = route;
+        }
+        return refineInCluster(s, nodeCell[route.front()], out) && refineRoute(g, out);
+    }
+
+    // Cells for `route` after its first entrance (already in `out`), then on to g
+    bool refineRoute(uint32_t g, vector<uint32_t>& out) {
+        for (size_t i = 0; i + 1 < route.size(); i++) {
+            uint32_t a = nodeCell[route[i]], b = nodeCell[route[i + 1]];
+            if (clusterOf(a) != clusterOf(b)) out.push_back(b); // across a border: one step
+            else if (!refineInCluster(a, b, out)) return false;
+        }
+        return refineInCluster(nodeCell[route.back()], g, out);
+    }
+};
+
+// --------------------------- Steering ---------------------------
+// Chaser positions and targets as SoA lanes for seekLanes. Storage is padded to SteerLanes with
+// zero-speed lanes, so a batch may start at any multiple of SteerLanes below size().
+static const int SteerLanes = 8;
+
+struct SeekLanes {
+    vector<float> sx, sy, tx, ty; // chaser and target centers
+    vector<float> speed, range2;  // range2 = range squared, 0 = unlimited
+    vector<float> vx, vy;         // out
+
+    size_t size() const { return count; }
+    void resize(size_t n) {
+        count = n;
+        size_t padded = (n + SteerLanes - 1) / SteerLanes * SteerLanes;
+        for (auto v : { &sx, &sy, &tx, &ty, &speed, &range2, &vx, &vy }) v->assign(padded, 0.0f);
+    }
+
+private:
+    size_t count = 0;
+};
+
+// Velocities for lanes first..first+7, as chaseStep computes them: toward the target at `speed`,
+// zero when the centers are within 0.001 px or further apart than the range. AVX2 does 8 lanes
+// per instruction, SSE2 4, both with the reciprocal square root estimate refined by one Newton
+// step (about 1e-7 relative error); otherwise a scalar loop.
+inline void seekLanes(SeekLanes& l, size_t first) {
+#if defined(__AVX2__)
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&l.tx[first]), _mm256_loadu_ps(&l.sx[first]));
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&l.ty[first]), _mm256_loadu_ps(&l.sy[first]));
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    __m256 r = _mm256_rsqrt_ps(d2);
+    r = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), r), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(d2, r), r)));
+    __m256 r2 = _mm256_loadu_ps(&l.range2[first]);
+    __m256 ok = _mm256_and_ps(_mm256_cmp_ps(d2, _mm256_set1_ps(1e-6f), _CMP_GT_OQ),
+                              _mm256_or_ps(_mm256_cmp_ps(r2, _mm256_setzero_ps(), _CMP_EQ_OQ), _mm256_cmp_ps(d2, r2, _CMP_LE_OQ)));
+    __m256 s = _mm256_and_ps(_mm256_mul_ps(_mm256_loadu_ps(&l.speed[first]), r), ok); // masks the NaN of d2 = 0
+    _mm256_storeu_ps(&l.vx[first], _mm256_mul_ps(dx, s));
+    _mm256_storeu_ps(&l.vy[first], _mm256_mul_ps(dy, s));
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128 half = _mm_set1_ps(0.5f), three = _mm_set1_ps(3.0f), eps = _mm_set1_ps(1e-6f), zero = _mm_setzero_ps();
+    for (int h = 0; h < SteerLanes; h += 4) {
+        size_t i = first + h;
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&l.tx[i]), _mm_loadu_ps(&l.sx[i]));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&l.ty[i]), _mm_loadu_ps(&l.sy[i]));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 r = _mm_rsqrt_ps(d2);
+        r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(d2, r), r)));
+        __m128 r2 = _mm_loadu_ps(&l.range2[i]);
+        __m128 ok = _mm_and_ps(_mm_cmpgt_ps(d2, eps), _mm_or_ps(_mm_cmpeq_ps(r2, zero), _mm_cmple_ps(d2, r2)));
+        __m128 s = _mm_and_ps(_mm_mul_ps(_mm_loadu_ps(&l.speed[i]), r), ok); // masks the NaN of d2 = 0
+        _mm_storeu_ps(&l.vx[i], _mm_mul_ps(dx, s));
+        _mm_storeu_ps(&l.vy[i], _mm_mul_ps(dy, s));
+    }
+#else
+    for (size_t i = first; i < first + SteerLanes; i++) {
+        float dx = l.tx[i] - l.sx[i], dy = l.ty[i] - l.sy[i];
+        float d2 = dx * dx + dy * dy;
+        float s = d2 > 1e-6f && (l.range2[i] == 0 || d2 <= l.range2[i]) ? l.speed[i] / sqrtf(d2) : 0.0f;
+        l.vx[i] = dx * s; l.vy[i] = dy * s;
+    }
+#endif
+}
+
+// Chase steering for every chaser at once. sync() finds the entities with Chase + Transform +
+// Velocity and their targets' Transforms, a walk over the whole world; it only needs to run
+// again when chasers or targets come and go or a Chase changes target (the components are held,
+// so a destroyed entity is steered harmlessly until then). update() gathers the centers into
+// SeekLanes, runs seekLanes over them and writes the velocities back, in chunks on the job
+// system. Steering doesn't integrate: physicsSystem moves the chasers. Chasers of a target with a
+// FlowField (see follow()) take the field's direction instead of the straight line wherever it
+// has one, and head straight in the target's own cell.
+// With `separation` on, chasers also push apart so they don't stack on their target: the centers
+// go into a SpatialHashGrid of separationRadius cells, and each chaser is pushed away from the
+// chasers within that radius, harder the closer they are, looking at no more than maxNeighbours
+// of them (the first found, in cell order; past that a crowd is dense enough that more pushes
+// change little and the cost would grow with it). The sum is capped at the Chase's speed.
+struct SteeringSystem {
+    size_t chasing = 0; // chasers moving toward their target after the last update()
+    float separation = 0;           // push at zero distance as a fraction of Chase::speed; 0 = off
+    float separationRadius = 32.0f; // px, center to center
+    int maxNeighbours = 8;
+
+    void setJobs(JobSystem* j) { jobs = j; }
+    size_t chaserCount() const { return chasers.size(); }
+
+    // Chasers of `target` follow `field` (kept updated by the caller) from the next sync();
+    // nullptr goes back to straight lines
+    void follow(EntityId target, const FlowField* field) {
+        if (field) fields[target] = field;
+        else fields.erase(target);
+    }
+
+    void sync(World& world) {
+        chasers.clear();
+        held.clear();
+        targets.clear();
+        for (auto &kv : world.entities) {
+            // one pass over the components with raw casts: getComponent three times would copy
+            // (and atomically count) a shared_ptr per component tried
+            const shared_ptr<Component> *c = nullptr, *t = nullptr, *v = nullptr;
+            for (auto &comp : kv.second->components) {
+                Component* p = comp.get();
+                if (!c && dynamic_cast<Chase*>(p)) c = &comp;
+                else if (!t && dynamic_cast<Transform*>(p)) t = &comp;
+                else if (!v && dynamic_cast<Velocity*>(p)) v = &comp;
+            }
+            if (!c || !t || !v) continue;
+            const Chase* chase = static_cast<const Chase*>(c->get());
+            // most chasers share a few targets
+            auto it = targets.find(chase->target);
+            if (it == targets.end()) {
+                auto e = world.entities.find(chase->target);
+                it = targets.emplace(chase->target, e != world.entities.end() ? e->second->getComponent<Transform>() : nullptr).first;
+            }
+            auto f = fields.find(chase->target);
+            chasers.push_back({ static_cast<Transform*>(t->get()), static_cast<Velocity*>(v->get()), chase, it->second.get(),
+                                f != fields.end() ? f->second : nullptr });
+            held.push_back(*t); held.push_back(*v); held.push_back(*c);
+        }
+    }
+
+    void update() {
+        const size_t n = chasers.size();
+        const bool separate = separation > 0 && separationRadius > 0 && maxNeighbours > 0;
+        lanes.resize(n);
+        if (separate) crowd.resize(n);
+        chunkChasing.assign(JobSystem::chunkCount(n, Grain), 0);
+        auto seek = [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++) {
+                const Chaser& c = chasers[i];
+                lanes.sx[i] = c.self->x + c.self->w / 2.0f; lanes.sy[i] = c.self->y + c.self->h / 2.0f;
+                if (c.target) { lanes.tx[i] = c.target->x + c.target->w / 2.0f; lanes.ty[i] = c.target->y + c.target->h / 2.0f; }
+                else { lanes.tx[i] = lanes.sx[i]; lanes.ty[i] = lanes.sy[i]; } // target gone: stand still
+                lanes.speed[i] = c.chase->speed;
+                lanes.range2[i] = c.chase->range * c.chase->range;
+                float fx, fy;
+                if (c.field && c.target && c.field->direction(lanes.sx[i], lanes.sy[i], fx, fy)) {
+                    // around walls: aim one px along the field, with the range still measured to the target
+                    float dx = lanes.tx[i] - lanes.sx[i], dy = lanes.ty[i] - lanes.sy[i];
+                    if (lanes.range2[i] > 0 && dx * dx + dy * dy > lanes.range2[i]) lanes.speed[i] = 0;
+                    lanes.tx[i] = lanes.sx[i] + fx; lanes.ty[i] = lanes.sy[i] + fy;
+                    lanes.range2[i] = 0;
+                }
+            }
+            for (size_t i = begin; i < end; i += SteerLanes) seekLanes(lanes, i); // the last chunk runs into the padding
+            size_t moving = 0;
+            for (size_t i = begin; i < end; i++) {
+                moving += lanes.vx[i] != 0 || lanes.vy[i] != 0;
+                if (separate) { crowd.boxes[i] = { lanes.sx[i], lanes.sy[i], lanes.sx[i], lanes.sy[i] }; crowd.active[i] = 1; }
+                else { chasers[i].vel->vx = lanes.vx[i]; chasers[i].vel->vy = lanes.vy[i]; }
+            }
+            chunkChasing[begin / Grain] = moving;
+        };
+        if (jobs) jobs->parallelFor(n, Grain, seek);
+        else seek(0, n, 0);
+        chasing = 0;
+        for (size_t m : chunkChasing) chasing += m;
+        if (!separate) return;
+
+        // every center is in place before anyone looks at its neighbours
+        crowdGrid.cellSize = separationRadius;
+        crowdGrid.update(crowd);
+        auto push = [&](size_t begin, size_t end, int) {
+            const float r = separationRadius, r2 = r * r;
+            for (size_t i = begin; i < end; i++) {
+                const float sx = lanes.sx[i], sy = lanes.sy[i];
+                float px = 0, py = 0;
+                int seen = 0;
+                crowdGrid.queryWhile({ sx - r, sy - r, sx + r, sy + r }, [&](uint32_t o) {
+                    if (o == i) return true;
+                    float dx = sx - lanes.sx[o], dy = sy - lanes.sy[o], d2 = dx * dx + dy * dy;
+                    if (d2 >= r2) return true;
+                    if (d2 < 1e-6f) px += chasers[o].chase->owner > chasers[i].chase->owner ? -1.0f : 1.0f; // exactly stacked: split the pair along x, by id
+                    else {
+                        float d = sqrtf(d2), w = (1.0f - d / r) / d;
+                        px += dx * w; py += dy * w;
+                    }
+                    return ++seen < maxNeighbours;
+                });
+                const float speed = chasers[i].chase->speed;
+                float vx = lanes.vx[i] + px * separation * speed, vy = lanes.vy[i] + py * separation * speed;
+                float v2 = vx * vx + vy * vy;
+                if (v2 > speed * speed) { float s = speed / sqrtf(v2); vx *= s; vy *= s; }
+                chasers[i].vel->vx = vx; chasers[i].vel->vy = vy;
+            }
+        };
+        if (jobs) jobs->parallelFor(n, Grain, push);
+        else push(0, n, 0);
+    }
+
+private:
+    struct Chaser { Transform* self; Velocity* vel; const Chase* chase; Transform* target; const FlowField* field; };
+    static const size_t Grain = 4096; // a multiple of SteerLanes, so chunks start on a batch
+    JobSystem* jobs = nullptr;
+    vector<Chaser> chasers;
+    vector<shared_ptr<Component>> held;                     // keeps the chasers' components alive until the next sync()
+    unordered_map<EntityId, shared_ptr<Transform>> targets; // and the targets'
+    unordered_map<EntityId, const FlowField*> fields;
+    SeekLanes lanes;
+    vector<size_t> chunkChasing;
+    CollisionProxies crowd; // chaser centers, for separation
+    SpatialHashGrid crowdGrid;
+};
+
+// --------------------------- Level of detail ---------------------------
+// Distance bands around a focus point (the player, or the middle of the view). Systems look up an
+// entity's band to do less for far ones: BehaviorSystem evaluates them only every interval-th
+// time they come up, physicsSystem lets them fall asleep sooner. Bands are taken from the
+// collision proxies, so an entity is placed where it was at the last CollisionWorld::sync().
+struct LodBand {
+    float distance;   // px from the focus to the entity's center: the far end of the band
+    int interval;     // updates per evaluation
+    float sleepScale; // sleeps below SleepPolicy::speed x this, after SleepPolicy::delay / this
+};
+
+struct LodSystem {
+    vector<LodBand> bands = { { 512, 1, 1 }, { 1024, 2, 2 }, { 2048, 4, 4 }, { INFINITY, 8, 8 } }; // nearest first
+    float focusX = 0, focusY = 0;
+    vector<size_t> counts; // entities per band, from the last update()
+
+    // Re-band every active proxy around (x, y)
+    void update(const CollisionProxies& px, float x, float y) {
+        focusX = x; focusY = y;
+        counts.assign(bands.size(), 0);
+        if (bands.empty()) return;
+        for (size_t s = 0; s < px.size(); s++) {
+            if (!px.active[s]) continue;
+            const AABB& b = px.boxes[s];
+            float dx = (b.minX + b.maxX) * 0.5f - x, dy = (b.minY + b.maxY) * 0.5f - y, d2 = dx * dx + dy * dy;
+            uint8_t band = 0;
+            while (band + 1 < (int)bands.size() && d2 > bands[band].distance * bands[band].distance) band++;
+            EntityId id = px.owner[s];
+            if (id >= levels.size()) levels.resize(std::max<size_t>(id + 1, levels.size() * 2), 0);
+            levels[id] = band;
+            counts[band]++;
+        }
+    }
+
+    // Band 0 for entities never seen, and for all of them until update() runs
+    int levelOf(EntityId id) const { return id < levels.size() ? levels[id] : 0; }
+    int intervalOf(EntityId id) const { return bands.empty() ? 1 : std::max(bands[levelOf(id)].interval, 1); }
+    float sleepScale(EntityId id) const { return bands.empty() ? 1.0f : bands[levelOf(id)].sleepScale; }
+    // The largest intervalOf() any entity can get
+    int maxInterval() const {
+        int k = 1;
+        for (auto &b : bands) k = std::max(k, b.interval);
+        return k;
+    }
+
+private:
+    vector<uint8_t> levels; // by EntityId; ids are handed out in sequence, so this stays dense
+};
+
+// --------------------------- Behavior trees ---------------------------
+// Agent decisions as data. A BehaviorTree is an immutable definition shared by every agent that
+// runs it: its nodes sit in one flat array and each composite's children are a contiguous run
+// of node indices in a second one, so evaluation walks indices and allocates nothing. What an
+// agent knows lives in a BehaviorBlackboard, one float column per key with a row per agent.
+// Trees are reactive: each evaluation starts at the root, so a Running action only keeps
+// running while the conditions in front of it still hold.
+enum BehaviorStatus : uint8_t { BehaviorSuccess, BehaviorFailure, BehaviorRunning };
+
+struct BehaviorBlackboard {
+    vector<EntityId> entity;       // per agent
+    vector<vector<float>> columns; // [key][agent]
+
+    size_t size() const { return entity.size(); }
+    // Column for `name`, added (zeroed for every agent) on first use
+    int key(const string& name) {
+        auto it = keys.find(name);
+        if (it != keys.end()) return it->second;
+        columns.emplace_back(entity.size(), 0.0f);
+        return keys[name] = (int)columns.size() - 1;
+    }
+    float& at(int key, uint32_t agent) { return columns[key][agent]; }
+    float at(int key, uint32_t agent) const { return columns[key][agent]; }
+
+private:
+    unordered_map<string, int> keys;
+};
+
+struct BehaviorTree {
+    // dt is the time since the agent was last evaluated
+    using Action = function<BehaviorStatus(BehaviorBlackboard& board, uint32_t agent, float dt)>;
+    enum Compare : uint8_t { Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+
+    // Builders return the new node's index: add the children first, then their parent. The last
+    // node added is the root unless setRoot() says otherwise.
+    int sequence(initializer_list<int> children) { return composite(Sequence, children); } // until a child doesn't succeed
+    int selector(initializer_list<int> children) { return composite(Selector, children); } // until a child doesn't fail
+    int invert(int child) { return composite(Invert, { child }); }                        // success <-> failure
+    int condition(int key, Compare op, float value) { return add({ Condition, op, (uint32_t)key, 0, value }); }
+    int action(Action fn) {
+        actions.push_back(std::move(fn));
+        return add({ Leaf, Less, (uint32_t)actions.size() - 1, 0, 0 });
+    }
+    void setRoot(int node) { rootNode = node; }
+    int root() const { return rootNode; }
+    size_t nodeCount() const { return nodes.size(); }
+
+    BehaviorStatus evaluate(BehaviorBlackboard& board, uint32_t agent, float dt) const {
+        return rootNode < 0 ? BehaviorFailure : run((uint32_t)rootNode, board, agent, dt);
+    }
+
+private:
+    enum Kind : uint8_t { Sequence, Selector, Invert, Condition, Leaf };
+    struct Node {
+        Kind kind;
+        Compare op;     // Condition
+        uint32_t index; // composites: first entry in `children`; Condition: key; Leaf: entry in `actions`
+        uint32_t count; // composites: children
+        float value;    // Condition
+    };
+    vector<Node> nodes;
+    vector<uint32_t> children;
+    vector<Action> actions;
+    int rootNode = -1;
+
+    int add(const Node& n) {
+        nodes.push_back(n);
+        return rootNode = (int)nodes.size() - 1;
+    }
+    int composite(Kind kind, initializer_list<int> kids) {
+        uint32_t first = (uint32_t)children.size();
+        for (int k : kids) children.push_back((uint32_t)k);
+        return add({ kind, Less, first, (uint32_t)kids.size(), 0 });
+    }
+
+    BehaviorStatus run(uint32_t i, BehaviorBlackboard& board, uint32_t agent, float dt) const {
+        const Node& n = nodes[i];
+        switch (n.kind) {
+        case Sequence:
+            for (uint32_t k = 0; k < n.count; k++) {
+                BehaviorStatus s = run(children[n.index + k], board, agent, dt);
+                if (s != BehaviorSuccess) return s;
+            }
+            return BehaviorSuccess;
+        case Selector:
+            for (uint32_t k = 0; k < n.count; k++) {
+                BehaviorStatus s = run(children[n.index + k], board, agent, dt);
+                if (s != BehaviorFailure) return s;
+            }
+            return BehaviorFailure;
+        case Invert: {
+            BehaviorStatus s = run(children[n.index], board, agent, dt);
+            return s == BehaviorSuccess ? BehaviorFailure : s == BehaviorFailure ? BehaviorSuccess : s;
+        }
+        case Condition: {
+            float v = board.at((int)n.index, agent);
+            bool pass = false;
+            switch (n.op) {
+            case Less: pass = v < n.value; break;
+            case LessEqual: pass = v <= n.value; break;
+            case Greater: pass = v > n.value; break;
+            case GreaterEqual: pass = v >= n.value; break;
+            case Equal: pass = v == n.value; break;
+            case NotEqual: pass = v != n.value; break;
+            }
+            return pass ? BehaviorSuccess : BehaviorFailure;
+        }
+        case Leaf:
+            return actions[n.index](board, agent, dt);
+        }
+        return BehaviorFailure;
+    }
+};
+
+// Runs the agents' trees on a fixed budget: each update() evaluates at most `budget` agents,
+// taking them round-robin, so the AI cost per frame stays flat however many agents there are and
+// every agent comes up once every ceil(agents / budget) updates. With a LodSystem, an agent whose
+// band has an interval of k is only evaluated every k-th time it comes up (staggered by entity
+// id, so a band's agents spread over the updates) and the budget goes to the next agents instead.
+// Actions get the time since their agent's last evaluation, so rates stay right however often an
+// agent is evaluated. Agents are evaluated in parallel chunks on the job system: an action may
+// only write its own agent's blackboard rows and its own entity's components, and can't add or
+// remove agents.
+struct BehaviorSystem {
+    size_t budget = 4096; // agents evaluated per update(); 0 = all of them
+    size_t evaluated = 0, running = 0; // by the last update(); running = trees that returned Running
+
+    void setJobs(JobSystem* j) { jobs = j; }
+    void setLod(const LodSystem* l) { lod = l; }
+    BehaviorBlackboard& blackboard() { return board; }
+    size_t agentCount() const { return board.size(); }
+
+    // New agent running `tree` (kept alive by the caller); returns its row in the blackboard.
+    // Rows are stable until an agent is removed.
+    uint32_t add(EntityId entity, const BehaviorTree* tree) {
+        uint32_t a = (uint32_t)board.size();
+        board.entity.push_back(entity);
+        for (auto &c : board.columns) c.push_back(0.0f);
+        trees.push_back(tree);
+        lastRun.push_back(clock);
+        status.push_back(BehaviorFailure);
+        turns.push_back(entity);
+        rows[entity] = a;
+        return a;
+    }
+    // The last row moves into the removed one
+    void remove(EntityId entity) {
+        auto it = rows.find(entity);
+        if (it == rows.end()) return;
+        uint32_t a = it->second, last = (uint32_t)board.size() - 1;
+        rows.erase(it);
+        if (a != last) {
+            board.entity[a] = board.entity[last];
+            for (auto &c : board.columns) c[a] = c[last];
+            trees[a] = trees[last]; lastRun[a] = lastRun[last]; status[a] = status[last]; turns[a] = turns[last];
+            rows[board.entity[a]] = a;
+        }
+        board.entity.pop_back();
+        for (auto &c : board.columns) c.pop_back();
+        trees.pop_back(); lastRun.pop_back(); status.pop_back(); turns.pop_back();
+        if (cursor >= board.size()) cursor = 0;
+    }
+    int rowOf(EntityId entity) const { auto it = rows.find(entity); return it == rows.end() ? -1 : (int)it->second; }
+    BehaviorStatus lastStatus(uint32_t agent) const { return status[agent]; }
+
+    void update(float dt) {
+        clock += dt;
+        const size_t n = board.size();
+        const size_t limit = budget == 0 ? n : std::min(budget, n);
+        // pick this update's agents: the next `limit` in turn, passing over those whose LOD band
+        // skips this turn (a byte or two per agent, so it stays serial). The walk stops after
+        // limit x the largest band interval agents, about enough to fill the budget even when
+        // every agent is in the farthest band, so an update looks at O(limit x interval) agents
+        // rather than all n.
+        due.clear();
+        size_t looked = 0;
+        if (!lod) for (; looked < limit; looked++) due.push_back((uint32_t)((cursor + looked) % n));
+        else {
+            const size_t walk = std::min(n, limit * (size_t)lod->maxInterval());
+            for (; looked < walk && due.size() < limit; looked++) {
+                uint32_t a = (uint32_t)((cursor + looked) % n);
+                if (turns[a]++ % (uint32_t)lod->intervalOf(board.entity[a]) == 0) due.push_back(a);
+            }
+        }
+        cursor = n ? (cursor + looked) % n : 0;
+        const size_t count = due.size();
+        chunkRunning.assign(JobSystem::chunkCount(count, Grain), 0);
+        auto run = [&](size_t begin, size_t end, int) {
+            size_t r = 0;
+            for (size_t j = begin; j < end; j++) {
+                uint32_t a = due[j];
+                float since = (float)(clock - lastRun[a]);
+                lastRun[a] = clock;
+                status[a] = trees[a]->evaluate(board, a, since);
+                r += status[a] == BehaviorRunning;
+            }
+            chunkRunning[begin / Grain] = r;
+        };
+        if (jobs) jobs->parallelFor(count, Grain, run);
+        else if (count) run(0, count, 0);
+        evaluated = count;
+        running = 0;
+        for (size_t r : chunkRunning) running += r;
+    }
+
+private:
+    static const size_t Grain = 1024;
+    JobSystem* jobs = nullptr;
+    const LodSystem* lod = nullptr;
+    BehaviorBlackboard board;
+    vector<const BehaviorTree*> trees; // per agent, shared definitions
+    vector<double> lastRun;            // per agent: `clock` at its last evaluation
+    vector<BehaviorStatus> status;     // per agent: result of its last evaluation
+    vector<uint32_t> turns;            // per agent: times it came up with a LodSystem, from its entity id
+    vector<uint32_t> due;              // this update's agents
+    unordered_map<EntityId, uint32_t> rows;
+    size_t cursor = 0; // next agent in round-robin order
+    double clock = 0;  // seconds of update() time
+    vector<size_t> chunkRunning;
+};
+
+// --------------------------- Particles ---------------------------
+// Particles aren't entities: an entity per spark would cost a heap object and a component list
+// each. Every ParticleEffect (what a spark shower or a puff of smoke looks like) owns one SoA pool
+// of fixed capacity; emitters and bursts spawn into it, update() steps whole pools with
+// particleLanes, and render() draws each pool as one SDL_RenderGeometry call of colored quads.
+static const int ParticleLanes = 8;
+
+struct ParticleEffect {
+    size_t capacity = 10000;                  // live particles at most; spawns past it are dropped
+    float lifeMin = 0.5f, lifeMax = 1.0f;     // s
+    float speedMin = 20.0f, speedMax = 80.0f; // px/s
+    float direction = 0, spread = 6.2831853f; // radians (0 = +x, y down): middle and full width of the spawn cone
+    float gravityX = 0, gravityY = 0;         // px/s^2
+    float drag = 0;                           // fraction of the velocity lost per second
+    float sizeStart = 4.0f, sizeEnd = 1.0f;   // quad side at birth and at death, px
+    SDL_Color colorStart = { 255, 255, 255, 255 }, colorEnd = { 255, 255, 255, 0 };
+    SDL_Texture* texture = nullptr;           // stretched over each quad; nullptr = flat color
+    SDL_BlendMode blend = SDL_BLENDMODE_ADD;
+};
+
+// One effect's live particles, packed at the front. Storage is padded to ParticleLanes, so a batch
+// may start at any multiple of ParticleLanes below size().
+struct ParticlePool {
+    vector<float> x, y, vx, vy; // center and velocity, px and px/s
+    vector<float> life;         // seconds left
+    vector<float> invLifetime;  // 1 / life at birth
+
+    size_t size() const { return count; }
+    size_t capacity() const { return cap; }
+    void reserve(size_t n) {
+        cap = n;
+        size_t padded = (n + ParticleLanes - 1) / ParticleLanes * ParticleLanes;
+        for (auto v : { &x, &y, &vx, &vy, &life, &invLifetime }) v->resize(padded, 0.0f);
+        count = std::min(count, n);
+    }
+    // Appends up to n particles at [size(), size() + granted) for the caller to fill; returns granted
+    size_t grow(size_t n) {
+        n = std::min(n, cap - count);
+        count += n;
+        return n;
+    }
+    // Swap-removes the particles whose life ran out (order within the pool isn't kept); returns
+    // how many went
+    size_t removeDead() {
+        size_t removed = 0;
+        for (size_t i = 0; i < count; ) {
+            if (life[i] > 0) { i++; continue; }
+            count--; removed++;
+            for (auto v : { &x, &y, &vx, &vy, &life, &invLifetime }) (*v)[i] = (*v)[count];
+        }
+        return removed;
+    }
+    void clear() { count = 0; }
+
+private:
+    size_t count = 0, cap = 0;
+};
+
+// Steps particles first..first+7 by dt: gravity (as a velocity change, gdx/gdy = gravity * dt),
+// then drag (velocity times `damp`), then position; life counts down. AVX2 does 8 lanes per
+// instruction, SSE2 4, otherwise a scalar loop.
+inline void particleLanes(ParticlePool& p, size_t first, float dt, float gdx, float gdy, float damp) {
+#if defined(__AVX2__)
+    const __m256 vdt = _mm256_set1_ps(dt), vd = _mm256_set1_ps(damp);
+    __m256 vx = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&p.vx[first]), _mm256_set1_ps(gdx)), vd);
+    __m256 vy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&p.vy[first]), _mm256_set1_ps(gdy)), vd);
+    _mm256_storeu_ps(&p.vx[first], vx); _mm256_storeu_ps(&p.vy[first], vy);
+    _mm256_storeu_ps(&p.x[first], _mm256_add_ps(_mm256_loadu_ps(&p.x[first]), _mm256_mul_ps(vx, vdt)));
+    _mm256_storeu_ps(&p.y[first], _mm256_add_ps(_mm256_loadu_ps(&p.y[first]), _mm256_mul_ps(vy, vdt)));
+    _mm256_storeu_ps(&p.life[first], _mm256_sub_ps(_mm256_loadu_ps(&p.life[first]), vdt));
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128 vdt = _mm_set1_ps(dt), vd = _mm_set1_ps(damp), gx = _mm_set1_ps(gdx), gy = _mm_set1_ps(gdy);
+    for (int h = 0; h < ParticleLanes; h += 4) {
+        size_t i = first + h;
+        __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&p.vx[i]), gx), vd);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&p.vy[i]), gy), vd);
+        _mm_storeu_ps(&p.vx[i], vx); _mm_storeu_ps(&p.vy[i], vy);
+        _mm_storeu_ps(&p.x[i], _mm_add_ps(_mm_loadu_ps(&p.x[i]), _mm_mul_ps(vx, vdt)));
+        _mm_storeu_ps(&p.y[i], _mm_add_ps(_mm_loadu_ps(&p.y[i]), _mm_mul_ps(vy, vdt)));
+        _mm_storeu_ps(&p.life[i], _mm_sub_ps(_mm_loadu_ps(&p.life[i]), vdt));
+    }
+#else
+    for (size_t i = first; i < first + ParticleLanes; i++) {
+        p.vx[i] = (p.vx[i] + gdx) * damp; p.vy[i] = (p.vy[i] + gdy) * damp;
+        p.x[i] += p.vx[i] * dt; p.y[i] += p.vy[i] * dt;
+        p.life[i] -= dt;
+    }
+#endif
+}
+
+// A spawn point for an effect: `rate` particles per second while update() runs
+struct ParticleEmitter {
+    int effect = -1;    // -1: removed
+    float x = 0, y = 0; // px
+    float rate = 0;     // particles per second, 0 = paused
+    float carry = 0;    // fraction of a particle owed by earlier updates
+};
+
+// Owns the effects' pools and the emitters. update() steps every pool (in chunks on the job
+// system), drops dead particles, then spawns for the emitters, so a new particle is drawn at its
+// emitter first. Spawn directions, speeds and lifetimes come from a RngLanes in bulk; the engine
+// passes its "particles" stream, so a replay repeats its effects. render() builds each effect's
+// quads (culled to the target, colors and sizes blended from birth to death) and draws them with
+// one RenderDevice::geometry call per effect.
+struct ParticleSystem {
+    size_t live = 0;    // particles after the last update()
+    size_t dropped = 0; // spawns lost to full pools, in total
+
+    void setJobs(JobSystem* j) { jobs = j; }
+    void setRng(RngLanes* r) { rng = r; }
+
+    // Effects can't be removed; returns the effect's index
+    int addEffect(const ParticleEffect& fx) {
+        effects.push_back(fx);
+        pools.emplace_back();
+        pools.back().reserve(fx.capacity);
+        return (int)effects.size() - 1;
+    }
+    // Changes apply to particles spawned after, except capacity (fixed by addEffect)
+    ParticleEffect& effect(int e) { return effects[e]; }
+    ParticlePool& pool(int e) { return pools[e]; }
+    size_t effectCount() const { return effects.size(); }
+
+    uint32_t addEmitter(int effect, float x, float y, float rate) {
+        ParticleEmitter em;
+        em.effect = effect; em.x = x; em.y = y; em.rate = rate;
+        if (!freeEmitters.empty()) { uint32_t id = freeEmitters.back(); freeEmitters.pop_back(); emitters[id] = em; return id; }
+        emitters.push_back(em);
+        return (uint32_t)emitters.size() - 1;
+    }
+    ParticleEmitter& emitter(uint32_t id) { return emitters[id]; }
+    // Stops spawning; the emitter's particles live out their lives
+    void removeEmitter(uint32_t id) { emitters[id] = ParticleEmitter(); freeEmitters.push_back(id); }
+
+    // `count` particles of effect `e` at (x, y) at once; returns how many fit in the pool
+    size_t burst(int e, float x, float y, size_t count) {
+        ParticlePool& p = pools[e];
+        const ParticleEffect& fx = effects[e];
+        const size_t first = p.size(), n = p.grow(count);
+        dropped += count - n;
+        if (n == 0) return 0;
+        RngLanes& r = rng ? *rng : ownRng;
+        spawnAngle.resize(n); spawnSpeed.resize(n); spawnLife.resize(n);
+        r.fill(spawnAngle.data(), n, fx.direction - fx.spread * 0.5f, fx.direction + fx.spread * 0.5f);
+        r.fill(spawnSpeed.data(), n, fx.speedMin, fx.speedMax);
+        r.fill(spawnLife.data(), n, fx.lifeMin, fx.lifeMax);
+        for (size_t k = 0; k < n; k++) {
+            const size_t i = first + k;
+            const float life = std::max(spawnLife[k], 1e-3f);
+            p.x[i] = x; p.y[i] = y;
+            p.vx[i] = cosf(spawnAngle[k]) * spawnSpeed[k]; p.vy[i] = sinf(spawnAngle[k]) * spawnSpeed[k];
+            p.life[i] = life; p.invLifetime[i] = 1.0f / life;
+        }
+        live += n;
+        return n;
+    }
+
+    void update(float dt) {
+        live = 0;
+        for (size_t e = 0; e < pools.size(); e++) {
+            ParticlePool& p = pools[e];
+            const ParticleEffect& fx = effects[e];
+            const float damp = std::max(0.0f, 1.0f - fx.drag * dt), gdx = fx.gravityX * dt, gdy = fx.gravityY * dt;
+            auto step = [&](size_t begin, size_t end, int) {
+                for (size_t i = begin; i < end; i += ParticleLanes) particleLanes(p, i, dt, gdx, gdy, damp); // the last chunk runs into the padding
+            };
+            if (jobs) jobs->parallelFor(p.size(), Grain, step);
+            else step(0, p.size(), 0);
+            p.removeDead();
+            live += p.size();
+        }
+        for (auto &em : emitters) {
+            if (em.effect < 0 || em.rate <= 0) continue;
+            em.carry += em.rate * dt;
+            size_t n = (size_t)em.carry;
+            em.carry -= (float)n;
+            if (n) burst(em.effect, em.x, em.y, n);
+        }
+    }
+
+    // Kills every particle; emitters carry on
+    void clear() {
+        for (auto &p : pools) p.clear();
+        live = 0;
+    }
+
+    // The quads of effect `e` that overlap `view` into vertices() (4 per quad: top left, top right,
+    // bottom left, bottom right; texture coordinates 0..1); returns the quad count. Quads are
+    // built in chunks on the job system, each chunk packed behind the previous in pool order.
+    size_t build(int e, const AABB& view) {
+        const ParticlePool& p = pools[e];
+        const ParticleEffect& fx = effects[e];
+        const size_t n = p.size();
+        if (verts.size() < n * 4) verts.resize(n * 4);
+        chunkQuads.assign(JobSystem::chunkCount(n, Grain), 0);
+        const float c0[4] = { (float)fx.colorEnd.r, (float)fx.colorEnd.g, (float)fx.colorEnd.b, (float)fx.colorEnd.a };
+        const float dc[4] = { fx.colorStart.r - c0[0], fx.colorStart.g - c0[1], fx.colorStart.b - c0[2], fx.colorStart.a - c0[3] };
+        const float h0 = fx.sizeEnd * 0.5f, dh = (fx.sizeStart - fx.sizeEnd) * 0.5f;
+        auto quads = [&](size_t begin, size_t end, int) {
+            SDL_Vertex* out = &verts[begin * 4];
+            for (size_t i = begin; i < end; i++) {
+                const float f = std::clamp(p.life[i] * p.invLifetime[i], 0.0f, 1.0f); // 1 at birth, 0 at death
+                const float h = h0 + dh * f;
+                const float x0 = p.x[i] - h, y0 = p.y[i] - h, x1 = p.x[i] + h, y1 = p.y[i] + h;
+                if (x1 < view.minX || x0 > view.maxX || y1 < view.minY || y0 > view.maxY) continue;
+                const SDL_Color c = { (Uint8)(c0[0] + dc[0] * f + 0.5f), (Uint8)(c0[1] + dc[1] * f + 0.5f),
+                                      (Uint8)(c0[2] + dc[2] * f + 0.5f), (Uint8)(c0[3] + dc[3] * f + 0.5f) };
+                out[0] = { { x0, y0 }, c, { 0, 0 } }; out[1] = { { x1, y0 }, c, { 1, 0 } };
+                out[2] = { { x0, y1 }, c, { 0, 1 } }; out[3] = { { x1, y1 }, c, { 1, 1 } };
+                out += 4;
+            }
+            chunkQuads[begin / Grain] = (size_t)(out - &verts[begin * 4]) / 4;
+        };
+        if (jobs) jobs->parallelFor(n, Grain, quads);
+        else quads(0, n, 0);
+        // close the gaps culled quads left at the chunk ends
+        size_t built = 0;
+        for (size_t c = 0; c < chunkQuads.size(); c++) {
+            if (built != c * Grain && chunkQuads[c]) memmove(&verts[built * 4], &verts[c * Grain * 4], chunkQuads[c] * 4 * sizeof(SDL_Vertex));
+            built += chunkQuads[c];
+        }
+        return built;
+    }
+    const SDL_Vertex* vertices() const { return verts.data(); }
+
+    // Every effect, culled to the render target, in addEffect order; leaves the blend mode as it found it
+    void render(RenderDevice& gfx) {
+        const AABB view = { 0, 0, (float)gfx.targetW, (float)gfx.targetH };
+        const SDL_BlendMode before = gfx.blendMode();
+        for (size_t e = 0; e < effects.size(); e++) {
+            const size_t quads = build((int)e, view);
+            if (!quads) continue;
+            // two triangles per quad; the pattern is the same for every batch, so it only grows
+            for (size_t q = indices.size() / 6; q < quads; q++) {
+                const int v = (int)q * 4;
+                for (int k : { v, v + 1, v + 2, v + 2, v + 1, v + 3 }) indices.push_back(k);
+            }
+            const ParticleEffect& fx = effects[e];
+            if (fx.texture) SDL_SetTextureBlendMode(fx.texture, fx.blend);
+            gfx.setBlendMode(fx.blend);
+            gfx.geometry(fx.texture, verts.data(), (int)quads * 4, indices.data(), (int)quads * 6);
+        }
+        gfx.setBlendMode(before);
+    }
+
+private:
+    static const size_t Grain = 8192; // a multiple of ParticleLanes, so chunks start on a batch
+    JobSystem* jobs = nullptr;
+    RngLanes* rng = nullptr;
+    RngLanes ownRng; // until setRng
+    vector<ParticleEffect> effects;
+    vector<ParticlePool> pools;
+    vector<ParticleEmitter> emitters;
+    vector<uint32_t> freeEmitters;
+    vector<float> spawnAngle, spawnSpeed, spawnLife;
+    vector<SDL_Vertex> verts;
+    vector<int> indices;
+    vector<size_t> chunkQuads;
+};
+
+// --------------------------- Timers ---------------------------
+// Delayed events without per-entity countdowns: a hierarchical timing wheel. Four levels of 256
+// slots cover 2^32 ticks; a timer goes in the level matching how far off it is and moves down a
+// level each time its slot comes round (at most three moves), so scheduling, cancelling and a
+// tick with nothing due are O(1) however many timers wait. Timers are grouped into channels, one
+// handler each; a tick's due timers reach each handler as one batch.
+// Slots are arrays of entries carrying everything a firing needs, so moving a slot down and
+// firing one read memory in order. Cancelling only bumps the timer's generation; its entry is
+// dropped when its slot comes round, or in a sweep once stale entries outnumber pending timers.
+// The wheel only moves when advanced: by ticks from a fixed-rate system (deterministic, replays
+// fire on the same ticks) or by seconds through advanceSeconds (wall clock, tickSeconds per tick).
+using TimerId = uint64_t; // 0 = none
+
+struct TimerEvent {
+    TimerId id = 0;
+    EntityId entity = INVALID_ENTITY; // as given to schedule
+    uint64_t data = 0;
+};
+
+// Receives one tick's due timers of its channel at once
+using TimerHandler = function<void(const vector<TimerEvent>&)>;
+
+struct TimerWheel {
+    float tickSeconds = 1.0f / 60.0f; // for the *Seconds calls
+    size_t fired = 0;                 // timers fired by the last advance
+
+    // A channel and the handler its timers fire to; returns the channel
+    int channel(TimerHandler h) {
+        handlers.push_back(std::move(h));
+        batches.emplace_back();
+        return (int)handlers.size() - 1;
+    }
+
+    // Fires on channel `ch` after `ticks` advances (at least 1; capped at 2^32 - 1), carrying
+    // `entity` and `data` to the handler
+    TimerId schedule(int ch, uint64_t ticks, EntityId entity = INVALID_ENTITY, uint64_t data = 0) {
+        ticks = std::clamp<uint64_t>(ticks, 1, Span - 1);
+        uint32_t n;
+        if (!freeTimers.empty()) { n = freeTimers.back(); freeTimers.pop_back(); }
+        else { n = (uint32_t)generations.size(); generations.push_back(0); dues.push_back(0); }
+        generations[n]++; // odd while pending
+        dues[n] = current + ticks;
+        place({ dues[n], data, entity, n, generations[n], ch });
+        pendingCount++;
+        return idOf(n);
+    }
+    // Rounded up to whole ticks
+    TimerId scheduleSeconds(int ch, float seconds, EntityId entity = INVALID_ENTITY, uint64_t data = 0) {
+        return schedule(ch, (uint64_t)std::ceil(std::max(seconds, 0.0f) / tickSeconds), entity, data);
+    }
+
+    // False if the timer already fired or was cancelled (a stale id never matches a later timer)
+    bool cancel(TimerId id) {
+        if (!pending(id)) return false;
+        release((uint32_t)(id & 0xFFFFFFFFull) - 1);
+        stale++;
+        if (stale > 4096 && stale > pendingCount) dropStale();
+        return true;
+    }
+    bool pending(TimerId id) const {
+        uint64_t n = (id & 0xFFFFFFFFull) - 1;
+        return id != 0 && n < generations.size() && (generations[n] & 1) && generations[n] == (uint32_t)(id >> 32);
+    }
+    // Ticks until the timer fires; 0 if it isn't pending
+    uint64_t remaining(TimerId id) const { return pending(id) ? dues[(id & 0xFFFFFFFFull) - 1] - current : 0; }
+
+    // Moves `ticks` ticks on, firing each tick's due timers before the next. Handlers may schedule
+    // and cancel (a timer scheduled from a handler fires on a later tick) but not add channels.
+    void advance(uint64_t ticks = 1) {
+        fired = 0;
+        for (uint64_t k = 0; k < ticks; k++) {
+            current++;
+            if (pendingCount == 0) { // nothing to move or fire
+                if (stale) dropStale();
+                continue;
+            }
+            // bring the next stretch of each level down as the level below wraps
+            if ((current & SlotMask) == 0) {
+                uint64_t i1 = (current >> SlotBits) & SlotMask, i2 = (current >> (2 * SlotBits)) & SlotMask;
+                if (i1 == 0) {
+                    if (i2 == 0) cascade(3 * Slots + ((current >> (3 * SlotBits)) & SlotMask));
+                    cascade(2 * Slots + i2);
+                }
+                cascade(Slots + i1);
+            }
+            vector<Entry>& slot = slots[current & SlotMask];
+            if (slot.empty()) continue;
+            for (const Entry& e : slot) {
+                if (generations[e.timer] != e.generation) { stale--; continue; }
+                batches[e.channel].push_back({ ((TimerId)e.generation << 32) | (e.timer + 1), e.entity, e.data });
+                release(e.timer);
+                fired++;
+            }
+            slot.clear();
+            for (size_t c = 0; c < batches.size(); c++) {
+                if (batches[c].empty()) continue;
+                firing.swap(batches[c]); // handlers may schedule into this channel's batch
+                handlers[c](firing);
+                firing.clear();
+            }
+        }
+    }
+    // Wall-clock mode: whole ticks of tickSeconds, the remainder carried to the next call
+    void advanceSeconds(float seconds) {
+        carrySeconds += seconds;
+        uint64_t ticks = (uint64_t)std::max(0.0f, std::floor(carrySeconds / tickSeconds));
+        carrySeconds -= (float)ticks * tickSeconds;
+        advance(ticks);
+    }
+
+    uint64_t now() const { return current; }
+    size_t size() const { return pendingCount; }
+
+private:
+    static constexpr int SlotBits = 8, Levels = 4;
+    static constexpr uint64_t Slots = 1ull << SlotBits, SlotMask = Slots - 1, Span = 1ull << (SlotBits * Levels);
+    struct Entry {
+        uint64_t due, data;
+        EntityId entity;
+        uint32_t timer, generation; // stale once generations[timer] moves on
+        int channel;
+    };
+    vector<Entry> slots[Levels * Slots]; // level * Slots + slot
+    vector<uint32_t> generations;        // per timer slot; odd while pending
+    vector<uint64_t> dues;
+    vector<uint32_t> freeTimers;
+    vector<TimerHandler> handlers;
+    vector<vector<TimerEvent>> batches;
+    vector<TimerEvent> firing;
+    vector<Entry> moving;
+    uint64_t current = 0;
+    size_t pendingCount = 0, stale = 0;
+    float carrySeconds = 0;
+
+    TimerId idOf(uint32_t n) const { return ((TimerId)generations[n] << 32) | (TimerId)(n + 1); }
+    void release(uint32_t n) {
+        generations[n]++;
+        freeTimers.push_back(n);
+        pendingCount--;
+    }
+    // The level is the highest block of SlotBits in which `due` differs from now (the lowest for
+    // due within the current 256 ticks); the slot is due's digit at that level
+    void place(const Entry& e) {
+        const uint64_t delta = e.due - current;
+        int level = 0;
+        while (level < Levels - 1 && delta >= (1ull << (SlotBits * (level + 1)))) level++;
+        slots[level * Slots + ((e.due >> (SlotBits * level)) & SlotMask)].push_back(e);
+    }
+    // Re-places every pending timer in one slot of a higher level, in order; they land lower down
+    void cascade(uint64_t slot) {
+        if (slots[slot].empty()) return;
+        moving.swap(slots[slot]);
+        for (const Entry& e : moving) {
+            if (generations[e.timer] != e.generation) stale--;
+            else place(e);
+        }
+        moving.clear();
+    }
+    void dropStale() {
+        for (auto &slot : slots)
+            slot.erase(std::remove_if(slot.begin(), slot.end(), [&](const Entry& e) { return generations[e.timer] != e.generation; }), slot.end());
+        stale = 0;
+    }
+};
+
+// --------------------------- Input ---------------------------
+struct InputState {
+    unordered_map<SDL_Scancode, bool> keys;
+    unordered_map<SDL_Scancode, bool> pressedThisFrame;
+    bool quit = false;
+    void reset() { keys.clear(); pressedThisFrame.clear(); quit = false; }
+    void setKey(SDL_Scancode sc, bool isDown) {
+        if (isDown && !down(sc)) pressedThisFrame[sc] = true;
+        keys[sc] = isDown;
+    }
+    bool down(SDL_Scancode sc) const {
+        auto it = keys.find(sc);
+        return it != keys.end() && it->second;
+    }
+    // went down this frame
+    bool pressed(SDL_Scancode sc) const { return pressedThisFrame.count(sc) != 0; }
+};
+
+// --------------------------- Input recording ---------------------------
+// Key transitions stamped with the frame they happened on. Replaying a recording
+// with a fixed dt reproduces a play session, which makes it a repeatable perf scenario.
+struct InputEventRecord {
+    Uint64 frame = 0;
+    int scancode = 0;
+    bool down = false;
+};
+
+struct InputRecording {
+    vector<InputEventRecord> events;
+    Uint64 length = 0; // frames
+    uint64_t seed = 0; // RngService seed of the session; 0 = not recorded
+    size_t cursor = 0;
+
+    void add(Uint64 frame, SDL_Scancode sc, bool down) { events.push_back({ frame, (int)sc, down }); }
+
+    // Apply every event recorded for `frame`
+    void apply(Uint64 frame, InputState& in) {
+        while (cursor < events.size() && events[cursor].frame <= frame) {
+            in.setKey((SDL_Scancode)events[cursor].scancode, events[cursor].down);
+            cursor++;
+        }
+    }
+    bool finished(Uint64 frame) const { return frame >= length; }
+
+    bool save(const string& path) const {
+        ofstream out(path);
+        if (!out) { cerr << "Cannot write input recording " << path << "\n"; return false; }
+        out << "sdl-engine-input 1\n";
+        if (seed) out << "seed " << seed << "\n";
+        for (auto &e : events) out << e.frame << " " << e.scancode << " " << (e.down ? 1 : 0) << "\n";
+        out << "end " << length << "\n";
+        return true;
+    }
+    bool load(const string& path) {
+        ifstream in(path);
+        string magic; int version = 0;
+        if (!(in >> magic >> version) || magic != "sdl-engine-input" || version != 1) {
+            cerr << "Not an input recording: " << path << "\n";
+            return false;
+        }
+        InputRecording loaded;
+        string tok;
+        while (in >> tok) {
+            bool ok;
+            if (tok == "end") { ok = (bool)(in >> loaded.length); if (ok) break; }
+            else if (tok == "seed") ok = (bool)(in >> loaded.seed);
+            else {
+                InputEventRecord r; int down = 0;
+                char* last = nullptr;
+                errno = 0;
+                r.frame = strtoull(tok.c_str(), &last, 10);
+                ok = isdigit((unsigned char)tok[0]) && *last == '\0' && errno != ERANGE && (in >> r.scancode >> down);
+                r.down = down != 0;
+                loaded.events.push_back(r);
+            }
+            if (!ok) {
+                cerr << "Bad input recording " << path << " near \"" << tok << "\"\n";
+                return false;
+            }
+        }
+        if (!loaded.length && !loaded.events.empty()) loaded.length = loaded.events.back().frame + 1;
+        *this = std::move(loaded);
+        return true;
+    }
+};
+
+// --------------------------- System scheduler ---------------------------
+// Each system runs at its own rate. hz <= 0 means "once per rendered frame".
+// Fixed-rate systems accumulate frame time and step with a constant dt; they get
+// a phase offset on registration so low-rate systems don't all fire on the same frame.
+class Engine;
+using SystemFn = function<void(Engine&, float dt)>;
+
+struct ScheduledSystem {
+    string name;
+    float hz = 0;
+    float period = 0;
+    float accumulator = 0;
+    bool enabled = true;
+    SystemFn fn;
+};
+
+struct SystemScheduler {
+    vector<ScheduledSystem> systems;
+    int maxStepsPerFrame = 8; // cap catch-up after a hitch instead of spiralling
+    int fixedRateCount = 0;
+
+    size_t add(const string& name, float hz, SystemFn fn) {
+        ScheduledSystem s;
+        s.name = name; s.hz = hz; s.fn = std::move(fn);
+        if (hz > 0) {
+            s.period = 1.0f / hz;
+            // golden-ratio sequence spreads phases evenly however many systems there are
+            float phase = std::fmod(fixedRateCount++ * 0.618034f, 1.0f);
+            s.accumulator = phase * s.period;
+        }
+        systems.push_back(std::move(s));
+        return systems.size() - 1;
+    }
+
+    ScheduledSystem* find(const string& name) {
+        for (auto &s : systems) if (s.name == name) return &s;
+        return nullptr;
+    }
+
+    void tick(Engine& eng, float frameDt) {
+        for (auto &s : systems) {
+            if (!s.enabled || !s.fn) continue;
+            if (s.hz <= 0) { s.fn(eng, frameDt); continue; }
+            s.accumulator += frameDt;
+            int steps = 0;
+            while (s.accumulator >= s.period && steps < maxStepsPerFrame) {
+                s.fn(eng, s.period);
+                s.accumulator -= s.period;
+                steps++;
+            }
+            // drop whatever backlog is left rather than carrying it into the next frame
+            if (s.accumulator >= s.period) s.accumulator = std::fmod(s.accumulator, s.period);
+        }
+    }
+};
+
+// --------------------------- Frame profiler ---------------------------
+// HDR-style latency histogram over microseconds: each power-of-two range is split
+// into 2^(SubBits-1) linear buckets, so any recorded value is within ~3% of its bucket.
+struct LatencyHistogram {
+    static const int SubBits = 6;
+    static const int Half = 1 << (SubBits - 1);
+    static const int MaxShift = 40;
+
+    vector<Uint64> counts = vector<Uint64>((MaxShift + 2) * Half, 0);
+    Uint64 total = 0;
+    Uint64 maxValue = 0;
+    double sum = 0;
+
+    static int msb(Uint64 v) { int b = 0; while (v >>= 1) b++; return b; }
+
+    static size_t bucketOf(Uint64 v) {
+        int shift = msb(v | 1) - (SubBits - 1);
+        if (shift < 0) shift = 0;
+        if (shift > MaxShift) { shift = MaxShift; v = (Uint64(2 * Half) << shift) - 1; }
+        return (size_t)shift * Half + (size_t)(v >> shift);
+    }
+    // Highest value that maps to bucket `i`
+    static Uint64 bucketUpper(size_t i) {
+        int shift = (int)(i / Half) - 1;
+        if (shift < 0) shift = 0;
+        Uint64 sub = i - (size_t)shift * Half;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(Uint64 us) {
+        counts[bucketOf(us)]++;
+        total++; sum += (double)us;
+        if (us > maxValue) maxValue = us;
+    }
+    void reset() { fill(counts.begin(), counts.end(), 0); total = 0; maxValue = 0; sum = 0; }
+
+    Uint64 percentile(double p) const {
+        if (!total) return 0;
+        Uint64 rank = (Uint64)std::ceil(p / 100.0 * (double)total);
+        if (rank < 1) rank = 1;
+        Uint64 seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucketUpper(i), maxValue);
+        }
+        return maxValue;
+    }
+    double mean() const { return total ? sum / (double)total : 0.0; }
+};
+
+enum FramePhase { PhaseInput, PhaseUpdate, PhaseSystems, PhaseRender, PhasePresent, PhaseWork, PhaseFrame, PhaseCount };
+static const char* framePhaseNames[PhaseCount] = { "input", "update", "systems", "render", "present", "work", "frame" };
+
+// Percentiles by name ("work.p99" -> microseconds), saved as a perf baseline
+using PerfSummary = map<string, double>;
+
+// Collects every frame's phase times. "work" is input..present, "frame" also includes the FPS cap sleep.
+struct FrameProfiler {
+    LatencyHistogram hist[PhaseCount];
+    Uint64 lastUs[PhaseCount] = {};
+    RenderStats lastRender;
+    LatencyHistogram drawCalls; // per-frame counts, not times
+    Uint64 frames = 0;
+    ofstream trace;
+
+    bool openTrace(const string& path) {
+        trace.open(path);
+        if (!trace) { cerr << "Cannot open frame trace " << path << "\n"; return false; }
+        trace << "frame";
+        for (int p = 0; p < PhaseCount; p++) trace << "," << framePhaseNames[p] << "_us";
+        trace << ",draw_calls,vertices,texture_binds,blend_changes,color_sets,pixels_filled\n";
+        return true;
+    }
+
+    void endFrame() {
+        for (int p = 0; p < PhaseCount; p++) hist[p].record(lastUs[p]);
+        drawCalls.record(lastRender.drawCalls);
+        if (trace.is_open()) {
+            trace << frames;
+            for (int p = 0; p < PhaseCount; p++) trace << "," << lastUs[p];
+            const RenderStats& r = lastRender;
+            trace << "," << r.drawCalls << "," << r.vertices << "," << r.textureBinds << "," << r.blendChanges
+                  << "," << r.colorSets << "," << r.pixelsFilled << "\n";
+        }
+        frames++;
+    }
+
+    void reset() { for (auto &h : hist) h.reset(); drawCalls.reset(); frames = 0; }
+
+    PerfSummary summary() const {
+        PerfSummary s;
+        for (int p = 0; p < PhaseCount; p++) {
+            string n = framePhaseNames[p];
+            s[n + ".p50"] = (double)hist[p].percentile(50);
+            s[n + ".p95"] = (double)hist[p].percentile(95);
+            s[n + ".p99"] = (double)hist[p].percentile(99);
+            s[n + ".max"] = (double)hist[p].maxValue;
+        }
+        return s;
+    }
+
+    void report(ostream& out) const {
+        out << "Frame times over " << frames << " frames (ms)\n";
+        out << "  phase        mean      p50      p95      p99      max\n";
+        char line[128];
+        for (int p = 0; p < PhaseCount; p++) {
+            const auto &h = hist[p];
+            snprintf(line, sizeof(line), "  %-8s %8.3f %8.3f %8.3f %8.3f %8.3f\n", framePhaseNames[p], h.mean() / 1000.0,
+                     h.percentile(50) / 1000.0, h.percentile(95) / 1000.0, h.percentile(99) / 1000.0, h.maxValue / 1000.0);
+            out << line;
+        }
+        out << "  draw calls/frame: mean " << drawCalls.mean() << ", p99 " << drawCalls.percentile(99) << ", max " << drawCalls.maxValue << "\n";
+    }
+};
+
+bool savePerfSummary(const PerfSummary& s, const string& path) {
+    ofstream out(path);
+    if (!out) { cerr << "Cannot write perf baseline " << path << "\n"; return false; }
+    for (auto &kv : s) out << kv.first << " " << kv.second << "\n";
+    return true;
+}
+
+bool loadPerfSummary(PerfSummary& s, const string& path) {
+    ifstream in(path);
+    if (!in) { cerr << "Cannot read perf baseline " << path << "\n"; return false; }
+    string k; double v;
+    while (in >> k >> v) s[k] = v;
+    return true;
+}
+
+// Fails when a gated percentile grew by more than `threshold` (0.1 = 10%) over the baseline.
+// `minDeltaUs` keeps sub-tenth-of-a-millisecond jitter from failing fast phases.
+bool comparePerf(const PerfSummary& baseline, const PerfSummary& current, double threshold, ostream& out,
+                 double minDeltaUs = 100.0) {
+    static const char* gated[] = { "work.p50", "work.p95", "work.p99", "update.p99", "systems.p99", "render.p99" };
+    bool ok = true;
+    for (const char* key : gated) {
+        auto b = baseline.find(key), c = current.find(key);
+        if (b == baseline.end() || c == current.end()) continue;
+        double limit = std::max(b->second * (1.0 + threshold), b->second + minDeltaUs);
+        bool regressed = c->second > limit;
+        char line[160];
+        snprintf(line, sizeof(line), "  %-12s baseline %9.0f us  current %9.0f us  %s\n", key, b->second, c->second,
+                 regressed ? "REGRESSED" : "ok");
+        out << line;
+        if (regressed) ok = false;
+    }
+    return ok;
+}
+
+// --------------------------- Engine ---------------------------
+class Engine {
+public:
+    Engine(const EngineConfig& cfg): cfg(cfg) {}
+    ~Engine(){ stop(); }
+
+    bool init() {
+        // the replay first, so a bad file fails before there's a window to tear down
+        if (!cfg.replayInputPath.empty()) {
+            if (!recording.load(cfg.replayInputPath)) return false;
+            replaying = true;
+        }
+        if (!window.create(cfg)) return false;
+        gfxDevice = RenderDevice(window.renderer, cfg.width, cfg.height);
+        texman = make_unique<TextureManager>(window.renderer);
+        fontman = make_unique<FontManager>();
+        audioman = make_unique<AudioManager>();
+        world = make_unique<World>();
+        jobSystem.start(cfg.workerThreads);
+        collisionWorld.setJobs(&jobSystem);
+        bodySolver.velocityIterations = cfg.solverIterations;
+        steeringSystem.setJobs(&jobSystem);
+        behaviorSystem.setJobs(&jobSystem);
+        behaviorSystem.setLod(&lodSystem); // one band (full rate) until the game updates it
+        particleSystem.setJobs(&jobSystem);
+        // a replay reuses the recorded seed so spawns come out the same (1 for recordings without one)
+        uint64_t seed = cfg.seed ? cfg.seed : replaying ? (recording.seed ? recording.seed : 1) : (uint64_t)SDL_GetPerformanceCounter();
+        rngService.seed(seed);
+        recording.seed = seed;
+        particleSystem.setRng(&rngService.bulk("particles"));
+        if (!cfg.frameTracePath.empty()) profiler.openTrace(cfg.frameTracePath);
+        initialized = true;
+        running = true;
+        return true;
+    }
+
+    // Register a system ticking at `hz` (<= 0: every frame). Systems run after onUpdate, in registration order.
+    size_t addSystem(const string& name, float hz, SystemFn fn) { return systems.add(name, hz, std::move(fn)); }
+
+    void run(function<void(Engine&)> onUpdate = nullptr, function<void(Engine&)> onRender = nullptr) {
+        const int frameDelay = 1000 / cfg.targetFPS;
+        const double perfFreq = (double)SDL_GetPerformanceFrequency();
+        auto usSince = [&](Uint64 from, Uint64 to) { return (Uint64)((to - from) * 1e6 / perfFreq); };
+        Uint64 last = SDL_GetPerformanceCounter();
+        Uint32 frameStart;
+        int frameTime;
+
+        while (running) {
+            frameStart = SDL_GetTicks();
+            Uint64 now = SDL_GetPerformanceCounter();
+            frameDt = (float)((now - last) / perfFreq);
+            last = now;
+            if (frameDt > 0.25f) frameDt = 0.25f; // debugger breaks, window drags
+            if (replaying) frameDt = 1.0f / cfg.targetFPS; // deterministic simulation for repeatable runs
+            // input
+            input.pressedThisFrame.clear();
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) { running = false; }
+                else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+                    bool down = e.type == SDL_KEYDOWN;
+                    if (down && !e.key.repeat && e.key.keysym.scancode == cfg.frameStatsKey) profiler.report(cout);
+                    if (replaying || e.key.repeat) continue;
+                    input.setKey(e.key.keysym.scancode, down);
+                    if (!cfg.recordInputPath.empty()) recording.add(frameIndex, e.key.keysym.scancode, down);
+                }
+            }
+            if (replaying) {
+                recording.apply(frameIndex, input);
+                if (recording.finished(frameIndex)) running = false;
+            }
+            Uint64 tInput = SDL_GetPerformanceCounter();
+
+            // update
+            if (onUpdate) onUpdate(*this);
+            Uint64 tUpdate = SDL_GetPerformanceCounter();
+            systems.tick(*this, frameDt);
+            Uint64 tSystems = SDL_GetPerformanceCounter();
+
+            // render
+            gfxDevice.beginFrame();
+            gfxDevice.setDrawColor(20, 20, 20, 255);
+            gfxDevice.clear();
+            if (onRender) onRender(*this);
+            Uint64 tRender = SDL_GetPerformanceCounter();
+            SDL_RenderPresent(window.renderer);
+            gfxDevice.endFrame();
+            Uint64 tPresent = SDL_GetPerformanceCounter();
+
+            // frame cap
+            frameTime = SDL_GetTicks() - frameStart;
+            if (frameDelay > frameTime) SDL_Delay(frameDelay - frameTime);
+
+            profiler.lastUs[PhaseInput] = usSince(now, tInput);
+            profiler.lastUs[PhaseUpdate] = usSince(tInput, tUpdate);
+            profiler.lastUs[PhaseSystems] = usSince(tUpdate, tSystems);
+            profiler.lastUs[PhaseRender] = usSince(tSystems, tRender);
+            profiler.lastUs[PhasePresent] = usSince(tRender, tPresent);
+            profiler.lastUs[PhaseWork] = usSince(now, tPresent);
+            profiler.lastUs[PhaseFrame] = usSince(now, SDL_GetPerformanceCounter());
+            profiler.lastRender = gfxDevice.last;
+            profiler.endFrame();
+            frameIndex++;
+        }
+    }
+
+    void stop() {
+        if (!initialized) return;
+        initialized = false; running = false;
+        if (!cfg.recordInputPath.empty()) { recording.length = frameIndex; recording.save(cfg.recordInputPath); }
+        if (cfg.reportFrameStats && profiler.frames) profiler.report(cout);
+        if (profiler.trace.is_open()) profiler.trace.close();
+        // resources first: textures belong to the renderer the window owns
+        texman->clear(); fontman->clear(); audioman->cleanup();
+        window.destroy();
+        jobSystem.stop();
+    }
+
+    // helpers for demo usage
+    SDL_Texture* loadTexture(const string& path) { return texman->load(path); }
+    TTF_Font* loadFont(const string& path, int size) { return fontman->load(path,size); }
+    Mix_Chunk* loadSfx(const string& path) { return audioman->loadSfx(path); }
+    Mix_Music* loadMusic(const string& path) { return audioman->loadMusic(path); }
+    // Prefab file (see PrefabLibrary) with its textures loaded through the TextureManager
+    bool loadPrefabs(PrefabLibrary& library, const string& path) {
+        return library.load(path, [this](const string& tex) { return loadTexture(tex); });
+    }
+
+    World& getWorld() { return *world; }
+    SDL_Renderer* renderer() { return window.renderer; }
+    RenderDevice& gfx() { return gfxDevice; }
+    CollisionWorld& collision() { return collisionWorld; }
+    JobSystem& jobs() { return jobSystem; }
+    RigidBodySolver& solver() { return bodySolver; }
+    SteeringSystem& steering() { return steeringSystem; }
+    BehaviorSystem& behaviors() { return behaviorSystem; }
+    LodSystem& lod() { return lodSystem; }
+    RngService& rng() { return rngService; }
+    ParticleSystem& particles() { return particleSystem; }
+    TimerWheel& timers() { return timerWheel; }
+    float dt() const { return frameDt; }
+    Uint64 frame() const { return frameIndex; }
+    // Reused id list for per-frame queries (the on-screen entities), so drawing doesn't allocate
+    vector<EntityId>& scratchIds() { return scratch; }
+    EngineConfig cfg;
+    InputState input;
+    SystemScheduler systems;
+    FrameProfiler profiler;
+
+private:
+    GLWindow window;
+    RenderDevice gfxDevice;
+    unique_ptr<TextureManager> texman;
+    unique_ptr<FontManager> fontman;
+    unique_ptr<AudioManager> audioman;
+    unique_ptr<World> world;
+    JobSystem jobSystem; // before collisionWorld, which points at it
+    CollisionWorld collisionWorld;
+    RigidBodySolver bodySolver;
+    SteeringSystem steeringSystem;
+    BehaviorSystem behaviorSystem;
+    LodSystem lodSystem;
+    RngService rngService;
+    ParticleSystem particleSystem;
+    TimerWheel timerWheel;
+    bool initialized = false;
+    bool running = false;
+    float frameDt = 0;
+    Uint64 frameIndex = 0;
+    InputRecording recording;
+    bool replaying = false;
+    vector<EntityId> scratch;
+};
+
+// --------------------------- Simple Systems ---------------------------
+
+// Draw one entity's Sprite, or a fallback rectangle when it has none
+static void drawEntity(RenderDevice& gfx, const Transform& t, const Sprite* s) {
+    if (s && s->texture) {
+        SDL_Rect dst = { (int)std::round(t.x), (int)std::round(t.y), (int)std::round(t.w * s->scale), (int)std::round(t.h * s->scale) };
+        if (s->srcW>0 && s->srcH>0) {
+            SDL_Rect src = { s->srcX, s->srcY, s->srcW, s->srcH };
+            gfx.copyEx(s->texture, &src, &dst, t.angle);
+        } else {
+            gfx.copyEx(s->texture, nullptr, &dst, t.angle);
+        }
+    } else {
+        // fallback rectangle
+        gfx.setDrawColor(255, 0, 255, 255);
+        SDL_Rect r = { (int)std::round(t.x), (int)std::round(t.y), (int)std::round(t.w), (int)std::round(t.h) };
+        gfx.fillRect(r);
+    }
+}
+
+// Draw all entities which have Transform + Sprite
+void renderEntities(World& world, RenderDevice& gfx) {
+    auto ents = world.all();
+    for (auto &e : ents) {
+        auto t = e->getComponent<Transform>();
+        if (!t) continue;
+        drawEntity(gfx, *t, e->getComponent<Sprite>().get());
+    }
+}
+
+// Same, but only entities whose Transform box is on screen, found through the collision tree
+// (synced by the caller) into `visible`, which the caller keeps between frames. Drawn in id order
+// so overlaps don't flicker. Culling uses the Transform box, so a Sprite scaled past it can pop
+// in late at the right/bottom edges.
+void renderEntities(World& world, RenderDevice& gfx, const CollisionWorld& cw, vector<EntityId>& visible) {
+    cw.queryRect({ 0, 0, (float)gfx.targetW, (float)gfx.targetH }, visible);
+    sort(visible.begin(), visible.end());
+    for (EntityId id : visible) {
+        auto it = world.entities.find(id);
+        if (it == world.entities.end()) continue;
+        auto t = it->second->getComponent<Transform>();
+        if (t) drawEntity(gfx, *t, it->second->getComponent<Sprite>().get());
+    }
+}
+
+void renderEntities(Engine& eng) {
+    eng.collision().sync(eng.getWorld()); // cheap when nothing left its fat tree box
+    renderEntities(eng.getWorld(), eng.gfx(), eng.collision(), eng.scratchIds());
+}
+
+// Debug overlay: outlines every on-screen entity in the color of its LOD band (green, yellow,
+// orange, then red for the rest). Call after renderEntities(eng), which synced the tree.
+void drawLodOverlay(Engine& eng) {
+    static const Uint8 colors[4][3] = { { 80, 220, 80 }, { 230, 220, 60 }, { 240, 150, 40 }, { 230, 60, 60 } };
+    vector<EntityId>& visible = eng.scratchIds();
+    RenderDevice& gfx = eng.gfx();
+    eng.collision().queryRect({ 0, 0, (float)gfx.targetW, (float)gfx.targetH }, visible);
+    for (EntityId id : visible) {
+        auto it = eng.getWorld().entities.find(id);
+        if (it == eng.getWorld().entities.end()) continue;
+        auto t = it->second->getComponent<Transform>();
+        if (!t) continue;
+        const Uint8* c = colors[std::min(eng.lod().levelOf(id), 3)];
+        gfx.setDrawColor(c[0], c[1], c[2], 255);
+        int x = (int)std::round(t->x), y = (int)std::round(t->y), w = (int)std::round(t->w), h = (int)std::round(t->h);
+        for (const SDL_Rect& edge : { SDL_Rect{ x, y, w, 2 }, SDL_Rect{ x, y + h - 2, w, 2 }, SDL_Rect{ x, y, 2, h }, SDL_Rect{ x + w - 2, y, 2, h } })
+            gfx.fillRect(edge);
+    }
+}
+
+// Basic physics: apply velocity (pixels/second) to transform, clamped to a width x height area.
+// Sleeping bodies are skipped until something gives them a velocity. With a LodSystem, the sleep
+// speed and delay are scaled by the body's band (far bodies settle sooner).
+void physicsSystem(World& world, float width, float height, float dt, const SleepPolicy& sleep = SleepPolicy(), const LodSystem* lod = nullptr) {
+    auto ents = world.all();
+    for (auto &e : ents) {
+        auto t = e->getComponent<Transform>();
+        auto v = e->getComponent<Velocity>();
+        if (t && v) {
+            if (v->asleep) {
+                if (v->vx == 0 && v->vy == 0) continue;
+                v->wake();
+            }
+            t->x += v->vx * dt;
+            t->y += v->vy * dt;
+            // simple bounds clamp
+            if (t->x < 0) t->x = 0;
+            if (t->y < 0) t->y = 0;
+            if (t->x + t->w > width) t->x = width - t->w;
+            if (t->y + t->h > height) t->y = height - t->h;
+            const float scale = lod ? lod->sleepScale(e->id) : 1.0f, sleepSpeed = sleep.speed * scale;
+            if (sleep.delay > 0 && v->vx * v->vx + v->vy * v->vy <= sleepSpeed * sleepSpeed) {
+                v->restTime += dt;
+                if (v->restTime >= sleep.delay / scale) { v->asleep = true; v->vx = 0; v->vy = 0; } // zeroed, so any later write wakes it
+            } else v->restTime = 0;
+        }
+    }
+}
+
+void physicsSystem(Engine& eng, float dt) {
+    physicsSystem(eng.getWorld(), (float)eng.cfg.width, (float)eng.cfg.height, dt, eng.cfg.sleep, &eng.lod());
+}
+
+// Point `v` from the center of `self` toward the center of `target` at `speed`. One entity at a
+// time; SteeringSystem does the same for every Chase in batches.
+void chaseStep(const Transform& self, const Transform& target, Velocity& v, float speed) {
+    float dx = (target.x + target.w/2.0f) - (self.x + self.w/2.0f);
+    float dy = (target.y + target.h/2.0f) - (self.y + self.h/2.0f);
+    float dist = sqrtf(dx*dx + dy*dy);
+    v.vx = 0; v.vy = 0;
+    if (dist > 0.001f) { v.vx = dx / dist * speed; v.vy = dy / dist * speed; }
+}
+
+// --------------------------- Demo Game Using Engine ---------------------------
+
+#ifndef SDL_ENGINE_NO_DEMO
+enum DemoLayer { LayerPlayer, LayerEnemy, LayerPickup, LayerWall };
+
+// The demo is a small game: player moves with WASD/arrow, collects targets, enemies chase player.
+// Perf regression run: record a session once with --record, then
+//   engine --replay run.rec --write-baseline perf.txt   (store percentiles)
+//   engine --replay run.rec --baseline perf.txt          (exit code 1 if they regressed)
+int main(int argc, char* argv[]) {
+    EngineConfig cfg;
+    cfg.width = 800; cfg.height = 600; cfg.title = "Engine Demo"; cfg.targetFPS = 60;
+
+    string baselinePath, writeBaselinePath;
+    double threshold = 0.10;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--record" && hasValue) cfg.recordInputPath = argv[++i];
+        else if (a == "--replay" && hasValue) cfg.replayInputPath = argv[++i];
+        else if (a == "--trace" && hasValue) cfg.frameTracePath = argv[++i];
+        else if (a == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (a == "--write-baseline" && hasValue) writeBaselinePath = argv[++i];
+        else if (a == "--threshold" && hasValue) threshold = atof(argv[++i]);
+        else { cerr << "Unknown argument: " << a << "\n"; return 2; }
+    }
+    Engine eng(cfg);
+    if (!eng.init()) { cerr << "Engine init failed\n"; return 1; }
+
+    // Load assets (placeholders if you don't have assets)
+    SDL_Texture* playerTex = eng.loadTexture("player.png");
+    SDL_Texture* targetTex = eng.loadTexture("target.png");
+    SDL_Texture* enemyTex = eng.loadTexture("enemy.png");
+    SDL_Texture* bgTex = eng.loadTexture("bg.png");
+    TTF_Font* font = eng.loadFont("font.ttf", 24);
+    Mix_Chunk* sfx = eng.loadSfx("hit.wav");
+    Mix_Music* music = eng.loadMusic("music.ogg");
+    if (music) Mix_PlayMusic(music, -1);
+
+    // Create entities
+    auto player = eng.getWorld().createEntity();
+    auto pTrans = player->addComponent<Transform>();
+    pTrans->x = cfg.width/2 - 32; pTrans->y = cfg.height/2 - 32; pTrans->w = 64; pTrans->h = 64;
+    auto pSprite = player->addComponent<Sprite>(); pSprite->texture = playerTex; pSprite->scale = 1.0f;
+    auto pVel = player->addComponent<Velocity>();
+    auto pCol = player->addComponent<Collider>();
+    pCol->continuous = true; // swept, so low physics rates can't skip targets
+    pCol->layer = LayerPlayer;
+    player->addComponent<RigidBody>();
+
+    // a wall above the start: solid for the solver (no sprite, so drawn as the fallback
+    // rectangle), and the enemies path around it on a flow field
+    auto wall = eng.getWorld().createEntity();
+    auto wTrans = wall->addComponent<Transform>();
+    wTrans->x = cfg.width/2 - 160; wTrans->y = cfg.height/2 - 140; wTrans->w = 320; wTrans->h = 24;
+    wall->addComponent<RigidBody>()->mass = 0;
+    wall->addComponent<Collider>()->layer = LayerWall;
+    // random spot in the window, clear of the wall; spawns have their own stream, so a replay
+    // (same seed) puts everything in the same places
+    Rng& spawnRng = eng.rng().stream("spawn");
+    auto placeClear = [&](Transform& t) {
+        do {
+            t.x = (float)spawnRng.below((uint32_t)(eng.cfg.width - (int)t.w));
+            t.y = (float)spawnRng.below((uint32_t)(eng.cfg.height - (int)t.h));
+        } while (aabbOverlap(boxOf(t), boxOf(*wTrans)));
+    };
+
+    // the pickup and the enemies come from prefabs; a prefabs.txt next to the executable can
+    // redefine them (see PrefabLibrary for the format), as long as it keeps the components the
+    // demo relies on: a Transform, and for enemies a Chase
+    PrefabLibrary prefabs;
+    Prefab& targetPrefab = prefabs.add("target");
+    Transform& targetBox = targetPrefab.add<Transform>();
+    targetBox.w = 32; targetBox.h = 32;
+    targetPrefab.add<Sprite>().texture = targetTex;
+    targetPrefab.add<Collider>().layer = LayerPickup;
+    Prefab& enemyPrefab = prefabs.add("enemy");
+    Transform& enemyBox = enemyPrefab.add<Transform>();
+    enemyBox.w = 48; enemyBox.h = 48;
+    enemyPrefab.add<Sprite>().texture = enemyTex;
+    enemyPrefab.add<Velocity>();
+    enemyPrefab.add<Collider>().layer = LayerEnemy;
+    RigidBody& enemyBody = enemyPrefab.add<RigidBody>();
+    enemyBody.mass = 3.0f; enemyBody.restitution = 0.5f; // shoves the player back a little
+    enemyPrefab.add<Chase>().speed = 90.0f; // aimed by the enemies' behavior tree below
+    if (ifstream("prefabs.txt")) {
+        PrefabLibrary custom;
+        eng.loadPrefabs(custom, "prefabs.txt");
+        for (const string name : {"target", "enemy"}) {
+            Prefab* p = custom.find(name);
+            if (!p) continue;
+            if (p->get<Transform>() && (name != "enemy" || p->get<Chase>())) prefabs.prefabs[name] = std::move(*p);
+            else cerr << "prefabs.txt: " << name << " lacks a component the demo needs, keeping the built-in one\n";
+        }
+    }
+
+    auto target = eng.getWorld().entities.at(eng.getWorld().instantiate(*prefabs.find("target"), 1));
+    placeClear(*target->getComponent<Transform>());
+
+    vector<shared_ptr<Entity>> enemies;
+    const EntityId firstEnemy = eng.getWorld().instantiate(*prefabs.find("enemy"), 3);
+    for (EntityId id = firstEnemy; id < firstEnemy + 3; id++) {
+        enemies.push_back(eng.getWorld().entities.at(id));
+        placeClear(*enemies.back()->getComponent<Transform>());
+    }
+
+    // 20 px cells over the window; the wall is blocked out grown by half an enemy's size, so an
+    // enemy's center keeps it clear of the wall
+    FlowField playerField;
+    playerField.setJobs(&eng.jobs());
+    playerField.resize(cfg.width / 20, cfg.height / 20, 20.0f);
+    AABB wallBox = boxOf(*wTrans);
+    playerField.fillRect({ wallBox.minX - 24, wallBox.minY - 24, wallBox.maxX + 24, wallBox.maxY + 24 }, FlowField::Blocked);
+    eng.steering().follow(player->id, &playerField);
+
+    // enemy behavior: measure the distance to the player, chase while it's within sight, otherwise
+    // hold still. One definition for every enemy; each keeps its distance in the blackboard.
+    BehaviorBlackboard& board = eng.behaviors().blackboard();
+    const int keyDistance = board.key("player_distance");
+    auto centerOf = [&](EntityId id, float& x, float& y) {
+        auto it = eng.getWorld().entities.find(id);
+        auto t = it != eng.getWorld().entities.end() ? it->second->getComponent<Transform>() : nullptr;
+        if (!t) return false;
+        x = t->x + t->w / 2; y = t->y + t->h / 2;
+        return true;
+    };
+    auto chaseOf = [&](BehaviorBlackboard& b, uint32_t a) { return eng.getWorld().entities.at(b.entity[a])->getComponent<Chase>(); };
+    BehaviorTree enemyTree;
+    enemyTree.sequence({
+        enemyTree.action([&](BehaviorBlackboard& b, uint32_t a, float) {
+            float ex, ey, px, py;
+            if (!centerOf(b.entity[a], ex, ey) || !centerOf(player->id, px, py)) return BehaviorFailure;
+            b.at(keyDistance, a) = sqrtf((px - ex) * (px - ex) + (py - ey) * (py - ey));
+            return BehaviorSuccess;
+        }),
+        enemyTree.selector({
+            enemyTree.sequence({
+                enemyTree.condition(keyDistance, BehaviorTree::LessEqual, 350.0f), // sight
+                enemyTree.action([&](BehaviorBlackboard& b, uint32_t a, float) { chaseOf(b, a)->target = player->id; return BehaviorRunning; }),
+            }),
+            enemyTree.action([&](BehaviorBlackboard& b, uint32_t a, float) { chaseOf(b, a)->target = INVALID_ENTITY; return BehaviorRunning; }),
+        }),
+    });
+    for (auto &enemy : enemies) eng.behaviors().add(enemy->id, &enemyTree);
+    // LOD bands sized for the window: enemies far from the player think at half and quarter rate
+    eng.lod().bands = { { 250, 1, 1 }, { 450, 2, 2 }, { INFINITY, 4, 4 } };
+    // enemies pass through each other (see the layers below), so separation is what keeps a pack
+    // of them from merging into one on the player's trail
+    eng.steering().separation = 1.0f;
+    eng.steering().separationRadius = 56.0f;
+
+    // pickups only matter to the player, and enemies pass through each other
+    eng.collision().layers.set(LayerEnemy, LayerEnemy, false);
+    eng.collision().layers.set(LayerEnemy, LayerPickup, false);
+    eng.collision().layers.set(LayerPickup, LayerPickup, false);
+
+    // effects: sparks from a collected target, a red flash where an enemy caught the player, and
+    // a faint trail behind the player while it moves
+    ParticleEffect sparks;
+    sparks.capacity = 4000;
+    sparks.lifeMin = 0.4f; sparks.lifeMax = 0.9f;
+    sparks.speedMin = 60.0f; sparks.speedMax = 240.0f;
+    sparks.gravityY = 300.0f; sparks.drag = 1.5f;
+    sparks.sizeStart = 5.0f; sparks.sizeEnd = 1.0f;
+    sparks.colorStart = { 255, 230, 120, 255 }; sparks.colorEnd = { 255, 90, 20, 0 };
+    const int sparkFx = eng.particles().addEffect(sparks);
+    ParticleEffect flash = sparks;
+    flash.gravityY = 0; flash.drag = 3.0f;
+    flash.colorStart = { 255, 80, 80, 255 }; flash.colorEnd = { 120, 0, 0, 0 };
+    const int flashFx = eng.particles().addEffect(flash);
+    ParticleEffect trail;
+    trail.capacity = 2000;
+    trail.lifeMin = 0.3f; trail.lifeMax = 0.6f;
+    trail.speedMin = 5.0f; trail.speedMax = 20.0f;
+    trail.sizeStart = 6.0f; trail.sizeEnd = 14.0f;
+    trail.colorStart = { 120, 180, 255, 90 }; trail.colorEnd = { 60, 90, 255, 0 };
+    const uint32_t trailEmitter = eng.particles().addEmitter(eng.particles().addEffect(trail), 0, 0, 0);
+    auto burstAt = [&](int fx, const Transform& t, size_t count) { eng.particles().burst(fx, t.x + t.w / 2, t.y + t.h / 2, count); };
+
+    int score = 0;
+    bool showRenderStats = false, showLod = false;
+
+    // update function: input runs at display rate
+    auto onUpdate = [&](Engine& E) {
+        if (E.input.pressed(SDL_SCANCODE_F3)) showRenderStats = !showRenderStats;
+        if (E.input.pressed(SDL_SCANCODE_F4)) showLod = !showLod;
+        float speed = 240.0f;
+        auto pv = player->getComponent<Velocity>();
+        pv->vx = 0; pv->vy = 0;
+        if (E.input.down(SDL_SCANCODE_W) || E.input.down(SDL_SCANCODE_UP)) pv->vy = -speed;
+        if (E.input.down(SDL_SCANCODE_S) || E.input.down(SDL_SCANCODE_DOWN)) pv->vy = speed;
+        if (E.input.down(SDL_SCANCODE_A) || E.input.down(SDL_SCANCODE_LEFT)) pv->vx = -speed;
+        if (E.input.down(SDL_SCANCODE_D) || E.input.down(SDL_SCANCODE_RIGHT)) pv->vx = speed;
+    };
+
+    // enemy AI: the behavior trees pick each Chase's target, then steering moves them. 10 Hz is
+    // plenty, physics integrates in between. The 1200-cell field rebuilds within one call; a
+    // bigger map would spread it over several with a smaller budget.
+    eng.addSystem("ai", 10.0f, [&](Engine& E, float dt) {
+        auto pt = player->getComponent<Transform>();
+        playerField.update(pt->x + pt->w / 2, pt->y + pt->h / 2, 4096);
+        E.lod().update(E.collision().proxies, pt->x + pt->w / 2, pt->y + pt->h / 2);
+        E.behaviors().update(dt);
+        E.steering().sync(E.getWorld()); // picks up Chase targets the trees changed
+        E.steering().update();
+    });
+
+    // physics + collision at 60 Hz; the player is a continuous collider, so a long step still
+    // catches every target it passed through. Timers tick here too (one wheel tick per physics
+    // step, the wheel's default tickSeconds), so delays replay on the same step every time.
+    eng.addSystem("physics", 60.0f, [&](Engine& E, float dt) {
+        E.timers().advance();
+        physicsSystem(E, dt);
+        CollisionWorld& cw = E.collision();
+        cw.sync(E.getWorld());
+        cw.detect();
+        E.solver().solve(cw, dt); // player, enemies and wall are RigidBodies; the target is only a trigger
+        cw.dispatch();            // gameplay runs in the collision handler below
+    });
+
+    // particles at display rate, so effects move smoothly whatever the physics rate
+    eng.addSystem("particles", 0, [&](Engine& E, float dt) {
+        auto pt = player->getComponent<Transform>();
+        auto pv = player->getComponent<Velocity>();
+        ParticleEmitter& em = E.particles().emitter(trailEmitter);
+        em.x = pt->x + pt->w / 2; em.y = pt->y + pt->h / 2;
+        em.rate = pv->vx != 0 || pv->vy != 0 ? 90.0f : 0.0f;
+        E.particles().update(dt);
+    });
+
+    // a collected target is gone for a moment, then a fresh one spawns somewhere clear
+    const int respawnChannel = eng.timers().channel([&](const vector<TimerEvent>&) {
+        target = eng.getWorld().entities.at(eng.getWorld().instantiate(*prefabs.find("target"), 1));
+        placeClear(*target->getComponent<Transform>());
+    });
+
+    // gameplay: reacts to the player's new contacts, once per physics tick
+    eng.collision().reportStay = false;
+    eng.collision().subscribe([&](const vector<CollisionEvent>& events) {
+        bool hitTarget = false, hitEnemy = false;
+        for (auto &ev : events) {
+            if (ev.phase != CollisionEnter) continue;
+            EntityId other = ev.a == player->id ? ev.b : (ev.b == player->id ? ev.a : INVALID_ENTITY);
+            if (target && other == target->id) hitTarget = true;
+            else for (auto &enemy : enemies) hitEnemy |= other == enemy->id;
+        }
+        auto pt = player->getComponent<Transform>();
+
         // collision: player-target
-        auto ttt = target->getComponent<Transform>();
-        if (aabbIntersect(*pt, *ttt)) {
+        if (hitTarget) {
             score++;
             if (sfx) Mix_PlayChannel(-1, sfx, 0);
-            ttt->x = rand() % (E.cfg.width - (int)ttt->w);
-            ttt->y = rand() % (E.cfg.height - (int)ttt->h);
-            // nudge enemy
-            et->x = rand() % (E.cfg.width - (int)et->w);
-            et->y = rand() % (E.cfg.height - (int)et->h);
+            burstAt(sparkFx, *target->getComponent<Transform>(), 80);
+            eng.getWorld().destroyEntity(target->id);
+            target = nullptr;
+            eng.timers().scheduleSeconds(respawnChannel, 1.5f);
+            for (auto &enemy : enemies) placeClear(*enemy->getComponent<Transform>()); // nudge enemies
         }
 
         // collision: player-enemy -> reset
-        if (aabbIntersect(*pt, *et)) {
+        if (hitEnemy && !hitTarget) { // a pickup already moved the enemies away
             score = 0;
-            pt->x = E.cfg.width / static_cast<float>(2); pt->y = E.cfg.height / 2;
-            et->x = rand() % (E.cfg.width - (int)et->w);
-            et->y = rand() % (E.cfg.height - (int)et->h);
+            burstAt(flashFx, *pt, 120);
+            pt->x = eng.cfg.width / static_cast<float>(2); pt->y = eng.cfg.height / 2;
+            eng.collision().teleported(player->id);
+            for (auto &enemy : enemies) placeClear(*enemy->getComponent<Transform>());
         }
+    });
+
+    auto drawText = [&](Engine& E, const string& s, int x, int y) {
+        SDL_Color white = {255,255,255,255};
+        SDL_Surface* surf = TTF_RenderUTF8_Blended(font, s.c_str(), white);
+        if (!surf) return;
+        SDL_Texture* tex = SDL_CreateTextureFromSurface(E.renderer(), surf);
+        SDL_Rect dst = {x, y, surf->w, surf->h};
+        E.gfx().copy(tex, nullptr, &dst);
+        SDL_DestroyTexture(tex);
+        SDL_FreeSurface(surf);
     };
 
     // render function
@@ -448,29 +4601,44 @@ int main(int argc, char* argv[]) {
         // optional bg
         if (bgTex) {
             SDL_Rect dst = {0,0, E.cfg.width, E.cfg.height};
-            SDL_RenderCopy(E.renderer(), bgTex, nullptr, &dst);
+            E.gfx().copy(bgTex, nullptr, &dst);
         }
 
         // render entities
         renderEntities(E);
+        E.particles().render(E.gfx());
+        if (showLod) drawLodOverlay(E);
 
-        // HUD: score
+        // HUD: score, F3 toggles last frame's render counters, F4 the LOD bands
         if (font) {
-            SDL_Color white = {255,255,255,255};
-            string s = "Score: " + to_string(score);
-            SDL_Surface* surf = TTF_RenderUTF8_Blended(font, s.c_str(), white);
-            if (surf) {
-                SDL_Texture* tex = SDL_CreateTextureFromSurface(E.renderer(), surf);
-                SDL_Rect dst = {10,10, surf->w, surf->h};
-                SDL_RenderCopy(E.renderer(), tex, nullptr, &dst);
-                SDL_DestroyTexture(tex);
-                SDL_FreeSurface(surf);
+            drawText(E, "Score: " + to_string(score), 10, 10);
+            if (showRenderStats) {
+                const RenderStats& rs = E.gfx().last;
+                drawText(E, "draws " + to_string(rs.drawCalls) + "  verts " + to_string(rs.vertices) +
+                            "  binds " + to_string(rs.textureBinds) + "  blend " + to_string(rs.blendChanges), 10, 40);
+                drawText(E, "colors " + to_string(rs.colorSets) + "  px " + to_string(rs.pixelsFilled) +
+                            "  particles " + to_string(E.particles().live), 10, 70);
+            }
+            if (showLod) {
+                string bands = "lod";
+                for (size_t c : E.lod().counts) bands += "  " + to_string(c);
+                drawText(E, bands, 10, showRenderStats ? 100 : 40);
             }
         }
     };
 
     eng.run(onUpdate, onRender);
 
+    PerfSummary perf = eng.profiler.summary();
     eng.stop();
+
+    if (!writeBaselinePath.empty() && !savePerfSummary(perf, writeBaselinePath)) return 1;
+    if (!baselinePath.empty()) {
+        PerfSummary baseline;
+        if (!loadPerfSummary(baseline, baselinePath)) return 1;
+        cout << "Perf comparison against " << baselinePath << " (threshold " << threshold * 100 << "%)\n";
+        if (!comparePerf(baseline, perf, threshold, cout)) { cerr << "Frame-time regression detected\n"; return 1; }
+    }
     return 0;
 }
+#endif // SDL_ENGINE_NO_DEMO
@@ -4,7 +4,13 @@
 // - SDL2 core engine (from previous file)
 // - Dear ImGui integration (SDL + SDL_Renderer backend)
 // - Simple Scene Editor window: Hierarchy, Inspector, Viewport (drag to move), play/pause
-// - Uses existing tiny ECS (Entity, Transform, Sprite, Velocity)
+// - Uses existing tiny ECS (Entity, Transform, Sprite, Velocity, Chase); enemies chase the entity their Chase targets
+// - Gameplay reacts to batched collision Enter/Stay/Exit events (ContactEvents) instead of inline checks
+// - Swept (continuous) player collisions in play mode, so frame hitches don't tunnel through targets
+// - Viewport picking through a dynamic AABB tree (PickTree) instead of scanning every entity
+// - Demo scene built from prefabs (World::instantiate copies a prefab's components in bulk)
+// - Spawn and respawn spots come from the editor's own seeded xoshiro256** Rng instead of rand()
+// - RenderDevice: scene drawing is counted (draw calls, vertices, texture binds, blend changes, pixels) and shown in the Engine window
 // - Build notes below
 
 /*
@@ -41,16 +47,32 @@
 #include <functional>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 
 using namespace std;
 
 // --------------------------- Config ---------------------------
 struct EngineConfig { int width=1280, height=720; string title="SDL Engine + ImGui Editor"; int targetFPS=60; bool vSync=false; };
 
+// --------------------------- Instrumented rendering (same counters as RenderDevice in sdl_game_engine.cpp) ---------------------------
+struct RenderStats { Uint64 drawCalls=0, vertices=0, textureBinds=0, blendChanges=0, colorSets=0, pixelsFilled=0; };
+struct RenderDevice {
+    SDL_Renderer* ren=nullptr; int targetW=0, targetH=0; RenderStats frame, last; SDL_Texture* boundTex=nullptr; SDL_BlendMode blend=SDL_BLENDMODE_NONE;
+    void beginFrame(){ frame=RenderStats(); boundTex=nullptr; } void endFrame(){ last=frame; }
+    void countQuad(const SDL_Rect* dst){ frame.drawCalls++; frame.vertices+=4; frame.pixelsFilled += dst ? (Uint64)max(0,dst->w)*(Uint64)max(0,dst->h) : (Uint64)targetW*targetH; }
+    void bind(SDL_Texture* t){ if(t!=boundTex){ frame.textureBinds++; boundTex=t; } }
+    void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a){ frame.colorSets++; SDL_SetRenderDrawColor(ren,r,g,b,a); }
+    void setBlendMode(SDL_BlendMode m){ if(m!=blend){ frame.blendChanges++; blend=m; } SDL_SetRenderDrawBlendMode(ren,m); }
+    void clear(){ countQuad(nullptr); SDL_RenderClear(ren); }
+    void fillRect(const SDL_Rect& r){ countQuad(&r); SDL_RenderFillRect(ren,&r); }
+    void copy(SDL_Texture* t, const SDL_Rect* src, const SDL_Rect* dst){ bind(t); countQuad(dst); SDL_RenderCopy(ren,t,src,dst); }
+};
+
 // --------------------------- Minimal Engine (window/renderer/imgui) ---------------------------
 struct EngineCore {
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
+    RenderDevice gfx; // scene drawing goes through here; ImGui's backend draws directly
     EngineConfig cfg;
 
     bool init(const EngineConfig& c) {
@@ -61,6 +83,7 @@ struct EngineCore {
         Uint32 flags = SDL_RENDERER_ACCELERATED; if (cfg.vSync) flags |= SDL_RENDERER_PRESENTVSYNC;
         renderer = SDL_CreateRenderer(window, -1, flags);
         if (!renderer) { cerr<<"CreateRenderer: "<<SDL_GetError()<<"\n"; return false; }
+        gfx.ren = renderer; gfx.targetW = cfg.width; gfx.targetH = cfg.height;
 
         int imgFlags = IMG_INIT_PNG|IMG_INIT_JPG;
         IMG_Init(imgFlags);
@@ -108,18 +131,87 @@ struct Component { EntityId owner=INVALID_ENTITY; virtual ~Component()=default;
 struct Transform: Component { float x=0,y=0,w=0,h=0,angle=0; };
 struct Sprite: Component { SDL_Texture* tex=nullptr; float scale=1.0f; };
 struct Velocity: Component { float vx=0, vy=0; };
+struct Chase: Component { EntityId target=INVALID_ENTITY; float speed=100.0f; }; // moves toward the target's center, px/s
 struct Entity { EntityId id=INVALID_ENTITY; vector<shared_ptr<Component>> comps; template<typename T, typename... Args> shared_ptr<T> add(Args&&...args){ auto c=make_shared<T>(forward<Args>(args)...); c->owner=id; comps.push_back(c); return c;} template<typename T> shared_ptr<T> get(){ for(auto &c:comps){ auto p=dynamic_pointer_cast<T>(c); if(p) return p;} return nullptr; } };
 
-struct World { EntityId next=1; unordered_map<EntityId, shared_ptr<Entity>> ents; shared_ptr<Entity> create(){ auto e=make_shared<Entity>(); e->id=next++; ents[e->id]=e; return e; } vector<shared_ptr<Entity>> all(){ vector<shared_ptr<Entity>> out; for(auto &p:ents) out.push_back(p.second); return out; } };
+// Prefabs (compact Prefab from sdl_game_engine.cpp): component prototypes that World::instantiate copies into one block per type for a whole batch, aliased by the instances
+struct PrefabPart { virtual ~PrefabPart()=default; virtual Component& proto()=0; virtual void instantiate(Entity* ents, size_t n) const=0; };
+template<typename T> struct PrefabPartOf: PrefabPart { T value; Component& proto() override { return value; }
+    void instantiate(Entity* ents, size_t n) const override { auto block=make_shared<vector<T>>(n, value); for(size_t i=0;i<n;i++){ (*block)[i].owner=ents[i].id; ents[i].comps.push_back(shared_ptr<Component>(block, &(*block)[i])); } } };
+struct Prefab { vector<unique_ptr<PrefabPart>> parts; template<typename T> T& add(){ for(auto &p:parts) if(auto c=dynamic_cast<T*>(&p->proto())) return *c; parts.push_back(make_unique<PrefabPartOf<T>>()); return static_cast<T&>(parts.back()->proto()); } };
+
+struct World { EntityId next=1; unordered_map<EntityId, shared_ptr<Entity>> ents; shared_ptr<Entity> create(){ auto e=make_shared<Entity>(); e->id=next++; ents[e->id]=e; return e; }
+    // n entities from `p` with consecutive ids; returns the first id (INVALID_ENTITY for none)
+    EntityId instantiate(const Prefab& p, size_t n){ if(!n) return INVALID_ENTITY; const EntityId first=next; auto block=make_shared<vector<Entity>>(n); for(size_t i=0;i<n;i++){ (*block)[i].id=next++; (*block)[i].comps.reserve(p.parts.size()); } for(auto &part: p.parts) part->instantiate(block->data(), n); ents.reserve(ents.size()+n); for(auto &e: *block) ents.emplace(e.id, shared_ptr<Entity>(block, &e)); return first; }
+    vector<shared_ptr<Entity>> all(){ vector<shared_ptr<Entity>> out; for(auto &p:ents) out.push_back(p.second); return out; } };
 
 // --------------------------- Utilities ---------------------------
 static bool aabbIntersect(const Transform& a, const Transform& b){ return !(a.x+a.w < b.x || a.x > b.x+b.w || a.y+a.h < b.y || a.y > b.y+b.h); }
+// Swept aabbIntersect (sweepAABB in sdl_game_engine.cpp): `a` starts at (ax,ay) and moves by (vx,vy) relative to `b`; true if they touch on the way
+static bool sweptIntersect(float ax, float ay, const Transform& a, float vx, float vy, const Transform& b){ float enter=0, exit=1; const float v[2]={vx,vy}, lo[2]={ax,ay}, sz[2]={a.w,a.h}, blo[2]={b.x,b.y}, bsz[2]={b.w,b.h};
+    for(int k=0;k<2;k++){ if(v[k]==0){ if(lo[k]+sz[k] < blo[k] || lo[k] > blo[k]+bsz[k]) return false; continue; } float t0=(blo[k]-lo[k]-sz[k])/v[k], t1=(blo[k]+bsz[k]-lo[k])/v[k]; if(t0>t1) swap(t0,t1); enter=max(enter,t0); exit=min(exit,t1); if(enter>exit) return false; } return true; }
+
+// --------------------------- Random numbers (compact Rng from sdl_game_engine.cpp) ---------------------------
+// xoshiro256** seeded through SplitMix64; below(n) has no modulo bias, and an editor owns its own generator instead of sharing rand()'s
+static uint64_t splitMix64(uint64_t& x){ uint64_t z=(x+=0x9E3779B97F4A7C15ull); z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull; return z^(z>>31); }
+struct Rng { uint64_t s[4];
+    explicit Rng(uint64_t seed=1){ for(auto &w:s) w=splitMix64(seed); }
+    uint64_t next(){ auto rotl=[](uint64_t x,int k){ return (x<<k)|(x>>(64-k)); }; uint64_t out=rotl(s[1]*5,7)*9, t=s[1]<<17; s[2]^=s[0]; s[3]^=s[1]; s[1]^=s[2]; s[0]^=s[3]; s[2]^=t; s[3]=rotl(s[3],45); return out; }
+    uint32_t below(uint32_t n){ uint64_t m=(uint64_t)(uint32_t)(next()>>32)*n; if((uint32_t)m<n){ uint32_t floor=(0u-n)%n; while((uint32_t)m<floor) m=(uint64_t)(uint32_t)(next()>>32)*n; } return (uint32_t)(m>>32); } };
+
+// --------------------------- Chase steering (compact SteeringSystem from sdl_game_engine.cpp) ---------------------------
+// Gathers every Chase and its target's center into SoA arrays, then one pass moves each chaser speed*dt toward its target. Editor enemies have no Velocity, so the Transform moves directly; scalar 1/sqrtf is plenty for editor scenes.
+struct ChaseSteering { vector<Transform*> self; vector<float> dx, dy, step;
+    void update(World& world, float dt){ self.clear(); dx.clear(); dy.clear(); step.clear();
+        for(auto &kv: world.ents){ auto c=kv.second->get<Chase>(); if(!c) continue; auto t=kv.second->get<Transform>(); auto it=world.ents.find(c->target); auto tt = (t && it!=world.ents.end()) ? it->second->get<Transform>() : nullptr; if(!tt) continue;
+            self.push_back(t.get()); dx.push_back((tt->x+tt->w/2)-(t->x+t->w/2)); dy.push_back((tt->y+tt->h/2)-(t->y+t->h/2)); step.push_back(c->speed*dt); }
+        for(size_t i=0;i<self.size();i++){ float d2=dx[i]*dx[i]+dy[i]*dy[i]; float s = d2>1e-6f ? step[i]/sqrtf(d2) : 0.0f; self[i]->x += dx[i]*s; self[i]->y += dy[i]*s; } } };
+
+// --------------------------- Contact events (compact CollisionWorld pair cache from sdl_game_engine.cpp) ---------------------------
+// Gameplay reports touching pairs with touch() during the frame; flush() diffs them against last frame's and hands Enter/Stay/Exit to subscribers in one batch.
+enum CollisionPhase { CollisionEnter, CollisionStay, CollisionExit };
+struct CollisionEvent { CollisionPhase phase=CollisionEnter; EntityId a=INVALID_ENTITY, b=INVALID_ENTITY; };
+struct ContactEvents {
+    vector<pair<EntityId,EntityId>> prev, cur; vector<CollisionEvent> events; vector<function<void(const vector<CollisionEvent>&)>> handlers;
+    void subscribe(function<void(const vector<CollisionEvent>&)> h){ handlers.push_back(std::move(h)); }
+    void touch(EntityId a, EntityId b){ cur.push_back(a<b ? make_pair(a,b) : make_pair(b,a)); }
+    void flush(){ sort(cur.begin(), cur.end()); cur.erase(unique(cur.begin(), cur.end()), cur.end()); events.clear(); size_t i=0, j=0;
+        while(i<prev.size() || j<cur.size()){ if(j==cur.size() || (i<prev.size() && prev[i]<cur[j])){ events.push_back({CollisionExit, prev[i].first, prev[i].second}); i++; } else if(i==prev.size() || cur[j]<prev[i]){ events.push_back({CollisionEnter, cur[j].first, cur[j].second}); j++; } else { events.push_back({CollisionStay, cur[j].first, cur[j].second}); i++; j++; } }
+        if(!events.empty()){ for(auto &h: handlers) h(events); } prev.swap(cur); cur.clear(); }
+    void clear(){ prev.clear(); cur.clear(); events.clear(); }
+};
+
+// --------------------------- Picking tree (compact AABBTree from sdl_game_engine.cpp) ---------------------------
+// Fat leaf boxes, perimeter-cost (SAH) insertion, refit on the way up. No rotations: editor scenes are small.
+struct Box { float x0=0,y0=0,x1=0,y1=0; };
+static Box boxUnion(const Box& a, const Box& b){ return {min(a.x0,b.x0),min(a.y0,b.y0),max(a.x1,b.x1),max(a.y1,b.y1)}; }
+static float boxPerimeter(const Box& b){ return 2.0f*((b.x1-b.x0)+(b.y1-b.y0)); }
+struct PickTree {
+    struct Node { Box box; int parent=-1, left=-1, right=-1; EntityId id=INVALID_ENTITY; bool leaf() const { return left<0; } };
+    vector<Node> nodes; vector<int> freeNodes; int root=-1; float margin=4.0f;
+    int alloc(){ if(!freeNodes.empty()){ int n=freeNodes.back(); freeNodes.pop_back(); nodes[n]=Node(); return n; } nodes.emplace_back(); return (int)nodes.size()-1; }
+    void refit(int n){ while(n>=0){ nodes[n].box = boxUnion(nodes[nodes[n].left].box, nodes[nodes[n].right].box); n = nodes[n].parent; } }
+    void insert(int leaf){ if(root<0){ root=leaf; nodes[leaf].parent=-1; return; } Box b=nodes[leaf].box; int i=root;
+        while(!nodes[i].leaf()){ float area=boxPerimeter(nodes[i].box), comb=boxPerimeter(boxUnion(nodes[i].box,b)), cost=2*comb, inh=2*(comb-area);
+            auto down=[&](int c){ float g=boxPerimeter(boxUnion(nodes[c].box,b)); return (nodes[c].leaf()? g : g-boxPerimeter(nodes[c].box)) + inh; };
+            float cl=down(nodes[i].left), cr=down(nodes[i].right); if(cost<cl && cost<cr) break; i = cl<cr ? nodes[i].left : nodes[i].right; }
+        int old=nodes[i].parent, p=alloc(); nodes[p].parent=old; nodes[p].left=i; nodes[p].right=leaf; nodes[i].parent=p; nodes[leaf].parent=p;
+        if(old<0) root=p; else if(nodes[old].left==i) nodes[old].left=p; else nodes[old].right=p; refit(p); }
+    void remove(int leaf){ if(leaf==root){ root=-1; return; } int p=nodes[leaf].parent, g=nodes[p].parent, s = nodes[p].left==leaf ? nodes[p].right : nodes[p].left; freeNodes.push_back(p); nodes[s].parent=g;
+        if(g<0){ root=s; return; } if(nodes[g].left==p) nodes[g].left=s; else nodes[g].right=s; refit(g); }
+    Box fat(const Transform& t) const { return {t.x-margin, t.y-margin, t.x+t.w+margin, t.y+t.h+margin}; }
+    int create(const Transform& t, EntityId id){ int n=alloc(); nodes[n].box=fat(t); nodes[n].id=id; insert(n); return n; }
+    void destroy(int leaf){ remove(leaf); freeNodes.push_back(leaf); }
+    void move(int leaf, const Transform& t){ const Box& f=nodes[leaf].box; if(t.x>=f.x0 && t.y>=f.y0 && t.x+t.w<=f.x1 && t.y+t.h<=f.y1) return; remove(leaf); nodes[leaf].box=fat(t); insert(leaf); }
+    template<typename F> void queryPoint(float x, float y, F&& f) const { if(root<0) return; vector<int> st{root}; while(!st.empty()){ const Node& n=nodes[st.back()]; st.pop_back(); if(x<n.box.x0 || x>n.box.x1 || y<n.box.y0 || y>n.box.y1) continue; if(n.leaf()) f(n.id); else { st.push_back(n.left); st.push_back(n.right); } } }
+};
 
 // --------------------------- Editor UI + Interaction ---------------------------
 struct Editor {
     EngineCore* core = nullptr;
     TextureManager texman;
     World world;
+    Rng rng{ (uint64_t)SDL_GetPerformanceCounter() };
     shared_ptr<Entity> selected = nullptr;
     bool playing = false;
     int score = 0;
@@ -131,8 +223,8 @@ struct Editor {
     void spawnDemoScene(){ // create player,target,enemy
         world = World(); selected = nullptr; score=0;
         auto p = world.create(); auto pt = p->add<Transform>(); pt->x = core->cfg.width/2-32; pt->y = core->cfg.height/2-32; pt->w=64; pt->h=64; auto ps = p->add<Sprite>(); ps->tex = texman.load("player.png"); p->add<Velocity>();
-        auto t = world.create(); auto tt = t->add<Transform>(); tt->x = rand()%(core->cfg.width-32); tt->y = rand()%(core->cfg.height-32); tt->w=32; tt->h=32; auto ts = t->add<Sprite>(); ts->tex = texman.load("target.png");
-        auto e = world.create(); auto et = e->add<Transform>(); et->x = rand()%(core->cfg.width-48); et->y = rand()%(core->cfg.height-48); et->w=48; et->h=48; auto es = e->add<Sprite>(); es->tex = texman.load("enemy.png");
+        auto t = world.create(); auto tt = t->add<Transform>(); tt->x = rng.below(core->cfg.width-32); tt->y = rng.below(core->cfg.height-32); tt->w=32; tt->h=32; auto ts = t->add<Sprite>(); ts->tex = texman.load("target.png");
+        auto e = world.create(); auto et = e->add<Transform>(); et->x = rng.below(core->cfg.width-48); et->y = rng.below(core->cfg.height-48); et->w=48; et->h=48; auto es = e->add<Sprite>(); es->tex = texman.load("enemy.png");
     }
 
     void update(float dt){ if(playing) { // simple physics + AI
@@ -149,7 +241,7 @@ struct Editor {
                     player->get<Transform>()->x = core->cfg.width/2 - 32; player->get<Transform>()->y = core->cfg.height/2 - 32; score=0; }
             }
             // player-target
-            if(player && target){ if(aabbIntersect(*player->get<Transform>(), *target->get<Transform())){ score++; target->get<Transform>()->x = rand()%(core->cfg.width - (int)target->get<Transform>()->w); target->get<Transform>()->y = rand()%(core->cfg.height - (int)target->get<Transform>()->h); }
+            if(player && target){ if(aabbIntersect(*player->get<Transform>(), *target->get<Transform())){ score++; target->get<Transform>()->x = rng.below(core->cfg.width - (int)target->get<Transform>()->w); target->get<Transform>()->y = rng.below(core->cfg.height - (int)target->get<Transform>()->h); }
             }
         }
     }
@@ -226,28 +318,58 @@ struct Editor {
 // Re-implement Editor properly (clean) -------------------------------------------------
 struct Editor2 {
     EngineCore* core = nullptr; TextureManager texman; World world; shared_ptr<Entity> selected=nullptr; bool playing=false; int score=0;
-    Editor2(EngineCore* c): core(c), texman(c->renderer) {}
+    PickTree pick; unordered_map<EntityId,int> pickLeaf; // viewport picking, synced once per frame in update()
+    ContactEvents contacts; EntityId playerId=INVALID_ENTITY, enemyId=INVALID_ENTITY, targetId=INVALID_ENTITY; // roles, found each update()
+    ChaseSteering chasers; // every Chase entity, stepped in play mode
+    Rng rng{ (uint64_t)SDL_GetPerformanceCounter() }; // spawn and respawn spots
+    Editor2(EngineCore* c): core(c), texman(c->renderer) { contacts.subscribe([this](const vector<CollisionEvent>& ev){ onCollisions(ev); }); }
     void loadDemoAssets(){ texman.load("player.png"); texman.load("target.png"); texman.load("enemy.png"); texman.load("bg.png"); }
-    void spawnDemoScene(){ world = World(); selected=nullptr; score=0; auto p=world.create(); auto pt=p->add<Transform>(); pt->x=core->cfg.width/2-32; pt->y=core->cfg.height/2-32; pt->w=64; pt->h=64; p->add<Sprite>()->tex = texman.load("player.png"); p->add<Velocity>(); auto t=world.create(); auto tt=t->add<Transform>(); tt->x=rand()%(core->cfg.width-32); tt->y=rand()%(core->cfg.height-32); tt->w=32; tt->h=32; t->add<Sprite>()->tex = texman.load("target.png"); auto e=world.create(); auto et=e->add<Transform>(); et->x=rand()%(core->cfg.width-48); et->y=rand()%(core->cfg.height-48); et->w=48; et->h=48; e->add<Sprite>()->tex = texman.load("enemy.png"); }
-
-    void update(float dt){ if(playing){ for(auto &ent: world.all()){ if(auto tr=ent->get<Transform>()){ if(auto v=ent->get<Velocity>()){ tr->x += v->vx*dt; tr->y += v->vy*dt; if(tr->x<0)tr->x=0; if(tr->y<0)tr->y=0; if(tr->x+tr->w>core->cfg.width) tr->x = core->cfg.width - tr->w; if(tr->y+tr->h>core->cfg.height) tr->y = core->cfg.height - tr->h; } } }
+    void spawnDemoScene(){ world = World(); selected=nullptr; score=0; pick=PickTree(); pickLeaf.clear(); contacts.clear();
+        Prefab player, target, enemy; auto shape=[&](Prefab& pf, float size, const char* tex){ auto &t=pf.add<Transform>(); t.w=size; t.h=size; pf.add<Sprite>().tex=texman.load(tex); };
+        shape(player, 64, "player.png"); player.add<Velocity>(); shape(target, 32, "target.png"); shape(enemy, 48, "enemy.png");
+        auto p=world.ents.at(world.instantiate(player, 1)); auto pt=p->get<Transform>(); pt->x=core->cfg.width/2-32; pt->y=core->cfg.height/2-32;
+        enemy.add<Chase>().target = p->id;
+        auto tt=world.ents.at(world.instantiate(target, 1))->get<Transform>(); tt->x=rng.below(core->cfg.width-32); tt->y=rng.below(core->cfg.height-32);
+        auto et=world.ents.at(world.instantiate(enemy, 1))->get<Transform>(); et->x=rng.below(core->cfg.width-48); et->y=rng.below(core->cfg.height-48); }
+
+    void syncPick(){ for(auto &kv: world.ents){ auto tr=kv.second->get<Transform>(); if(!tr) continue; auto it=pickLeaf.find(kv.first); if(it==pickLeaf.end()) pickLeaf[kv.first]=pick.create(*tr, kv.first); else pick.move(it->second, *tr); }
+        for(auto it=pickLeaf.begin(); it!=pickLeaf.end();){ if(!world.ents.count(it->first)){ pick.destroy(it->second); it=pickLeaf.erase(it); } else ++it; } }
+    // Topmost (newest) entity whose Transform contains the scene point
+    shared_ptr<Entity> pickAt(float sx, float sy){ EntityId best=INVALID_ENTITY; pick.queryPoint(sx, sy, [&](EntityId id){ auto it=world.ents.find(id); if(it==world.ents.end() || id<best) return; auto tr=it->second->get<Transform>(); if(tr && sx >= tr->x && sx <= tr->x+tr->w && sy >= tr->y && sy <= tr->y+tr->h) best=id; }); return best==INVALID_ENTITY ? nullptr : world.ents[best]; }
+
+    // dt varies with frame time, so a hitch can move the player further than a target is wide: player hits are swept from where it started this frame
+    void update(float dt){ syncPick(); if(playing){
             // find roles
             shared_ptr<Entity> player=nullptr, enemy=nullptr, target=nullptr;
             for(auto &ent: world.all()){ if(auto sp=ent->get<Sprite>()){ auto tr=ent->get<Transform>(); if(tr->w>48) player=ent; else if(tr->w>40) enemy=ent; else target=ent; } }
-            if(player && enemy){ auto pt = player->get<Transform>(); auto et = enemy->get<Transform>(); float dx=(pt->x+pt->w/2)-(et->x+et->w/2); float dy=(pt->y+pt->h/2)-(et->y+et->h/2); float dist = sqrtf(dx*dx+dy*dy); if(dist>1e-3f){ et->x += (dx/dist)*100.0f*dt; et->y += (dy/dist)*100.0f*dt; } if(aabbIntersect(*pt,*et)){ pt->x = core->cfg.width/2 - 32; pt->y = core->cfg.height/2 - 32; score=0; } }
-            if(player && target){ if(aabbIntersect(*player->get<Transform>(), *target->get<Transform>())){ score++; target->get<Transform>()->x = rand()%(core->cfg.width-(int)target->get<Transform>()->w); target->get<Transform>()->y = rand()%(core->cfg.height-(int)target->get<Transform>()->h); } }
+            playerId = player ? player->id : INVALID_ENTITY; enemyId = enemy ? enemy->id : INVALID_ENTITY; targetId = target ? target->id : INVALID_ENTITY;
+            float p0x=0, p0y=0, e0x=0, e0y=0; if(player){ auto t=player->get<Transform>(); p0x=t->x; p0y=t->y; } if(enemy){ auto t=enemy->get<Transform>(); e0x=t->x; e0y=t->y; }
+            for(auto &ent: world.all()){ if(auto tr=ent->get<Transform>()){ if(auto v=ent->get<Velocity>()){ tr->x += v->vx*dt; tr->y += v->vy*dt; if(tr->x<0)tr->x=0; if(tr->y<0)tr->y=0; if(tr->x+tr->w>core->cfg.width) tr->x = core->cfg.width - tr->w; if(tr->y+tr->h>core->cfg.height) tr->y = core->cfg.height - tr->h; } } }
+            if(player && target){ auto pt=player->get<Transform>(); auto tt=target->get<Transform>(); if(sweptIntersect(p0x, p0y, *pt, pt->x-p0x, pt->y-p0y, *tt)) contacts.touch(player->id, target->id); }
+            chasers.update(world, dt);
+            if(player && enemy){ auto pt = player->get<Transform>(); auto et = enemy->get<Transform>();
+                // enemy start box against the player's motion relative to it
+                Transform e0=*et; e0.x=e0x; e0.y=e0y; if(sweptIntersect(p0x, p0y, *pt, (pt->x-p0x)-(et->x-e0x), (pt->y-p0y)-(et->y-e0y), e0)) contacts.touch(player->id, enemy->id); }
+            contacts.flush();
         } }
 
+    // Gameplay, once per frame from contacts.flush(): score on touching the target, reset on touching the enemy
+    void onCollisions(const vector<CollisionEvent>& events){ for(auto &ev: events){ if(ev.phase!=CollisionEnter) continue; EntityId other = ev.a==playerId ? ev.b : (ev.b==playerId ? ev.a : INVALID_ENTITY); if(other==INVALID_ENTITY || !world.ents.count(other) || !world.ents.count(playerId)) continue;
+            auto pt = world.ents[playerId]->get<Transform>(); auto ot = world.ents[other]->get<Transform>(); if(!pt || !ot) continue;
+            if(other==targetId){ score++; ot->x = rng.below(core->cfg.width-(int)ot->w); ot->y = rng.below(core->cfg.height-(int)ot->h); }
+            else if(other==enemyId){ pt->x = core->cfg.width/2 - 32; pt->y = core->cfg.height/2 - 32; score=0; } } }
+
     void drawSceneToViewport(const SDL_Rect& view){ // set viewport and scale so scene fits
         SDL_Rect prev; SDL_RenderGetViewport(core->renderer, &prev);
         SDL_RenderSetViewport(core->renderer, &view);
         float sx = (float)view.w / (float)core->cfg.width; float sy = (float)view.h / (float)core->cfg.height; SDL_RenderSetScale(core->renderer, sx, sy);
+        RenderDevice& gfx = core->gfx;
         // background
-        if(auto bg = texman.load("bg.png")){ SDL_Rect dst={0,0,core->cfg.width,core->cfg.height}; SDL_RenderCopy(core->renderer, bg, nullptr, &dst); }
+        if(auto bg = texman.load("bg.png")){ SDL_Rect dst={0,0,core->cfg.width,core->cfg.height}; gfx.copy(bg, nullptr, &dst); }
         // entities
-        for(auto &ent: world.all()){ if(auto tr = ent->get<Transform>()){ if(auto sp=ent->get<Sprite>()){ SDL_Rect dst={(int)tr->x,(int)tr->y,(int)tr->w,(int)tr->h}; SDL_RenderCopy(core->renderer, sp->tex, nullptr, &dst); } else { SDL_Rect r={(int)tr->x,(int)tr->y,(int)tr->w,(int)tr->h}; SDL_SetRenderDrawColor(core->renderer, 200,100,200,255); SDL_RenderFillRect(core->renderer, &r); } } }
+        for(auto &ent: world.all()){ if(auto tr = ent->get<Transform>()){ if(auto sp=ent->get<Sprite>()){ SDL_Rect dst={(int)tr->x,(int)tr->y,(int)tr->w,(int)tr->h}; gfx.copy(sp->tex, nullptr, &dst); } else { SDL_Rect r={(int)tr->x,(int)tr->y,(int)tr->w,(int)tr->h}; gfx.setDrawColor(200,100,200,255); gfx.fillRect(r); } } }
         // selection highlight
-        if(selected && selected->get<Transform>()){ auto tr = selected->get<Transform>(); SDL_SetRenderDrawBlendMode(core->renderer, SDL_BLENDMODE_BLEND); SDL_SetRenderDrawColor(core->renderer, 255,255,0,120); SDL_Rect r={(int)tr->x-4,(int)tr->y-4,(int)tr->w+8,(int)tr->h+8}; SDL_RenderFillRect(core->renderer,&r); SDL_SetRenderDrawBlendMode(core->renderer, SDL_BLENDMODE_NONE); }
+        if(selected && selected->get<Transform>()){ auto tr = selected->get<Transform>(); gfx.setBlendMode(SDL_BLENDMODE_BLEND); gfx.setDrawColor(255,255,0,120); SDL_Rect r={(int)tr->x-4,(int)tr->y-4,(int)tr->w+8,(int)tr->h+8}; gfx.fillRect(r); gfx.setBlendMode(SDL_BLENDMODE_NONE); }
         SDL_RenderSetScale(core->renderer, 1.0f, 1.0f);
         SDL_RenderSetViewport(core->renderer, &prev);
     }
@@ -260,11 +382,14 @@ struct Editor2 {
         // interaction
         if(ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)){
             ImVec2 mp = ImGui::GetMousePos(); float sx = (mp.x - p.x) * (float)core->cfg.width / s.x; float sy = (mp.y - p.y) * (float)core->cfg.height / s.y;
-            if(selected){ if(auto tr = selected->get<Transform>()){ tr->x = sx - tr->w*0.5f; tr->y = sy - tr->h*0.5f; } } else { for(auto &e: world.all()){ if(auto tr=e->get<Transform>()){ if(sx >= tr->x && sx <= tr->x+tr->w && sy >= tr->y && sy <= tr->y+tr->h){ selected = e; break; } } } }
+            if(selected){ if(auto tr = selected->get<Transform>()){ tr->x = sx - tr->w*0.5f; tr->y = sy - tr->h*0.5f; } } else selected = pickAt(sx, sy);
         }
         ImGui::End(); }
 
-    void uiOverlay(){ ImGui::Begin("Engine"); ImGui::Text("Score: %d", score); ImGui::Text("Entities: %d", (int)world.ents.size()); ImGui::End(); }
+    void uiOverlay(){ ImGui::Begin("Engine"); ImGui::Text("Score: %d", score); ImGui::Text("Entities: %d", (int)world.ents.size());
+        const RenderStats& rs = core->gfx.last; ImGui::Separator(); ImGui::Text("Draw calls: %llu  Vertices: %llu", (unsigned long long)rs.drawCalls, (unsigned long long)rs.vertices);
+        ImGui::Text("Texture binds: %llu  Blend changes: %llu", (unsigned long long)rs.textureBinds, (unsigned long long)rs.blendChanges); ImGui::Text("Color sets: %llu  Pixels: %llu", (unsigned long long)rs.colorSets, (unsigned long long)rs.pixelsFilled);
+        ImGui::End(); }
 
     void renderUI(){ uiOverlay(); uiHierarchy(); uiInspector(); uiViewport(); }
 };
@@ -292,7 +417,7 @@ int main(int argc, char* argv[]){ EngineConfig cfg; cfg.width=1280; cfg.height=7
         ImGui::NewFrame();
 
         // render world to main renderer (background)
-        SDL_SetRenderDrawColor(core.renderer, 30,30,30,255); SDL_RenderClear(core.renderer);
+        core.gfx.beginFrame(); core.gfx.setDrawColor(30,30,30,255); core.gfx.clear();
         // draw scene to full window
         SDL_Rect full = {0,0,core.cfg.width, core.cfg.height}; editor.drawSceneToViewport(full);
 
@@ -303,7 +428,7 @@ int main(int argc, char* argv[]){ EngineConfig cfg; cfg.width=1280; cfg.height=7
         ImGui::Render();
         ImGui_ImplSDLRenderer_RenderDrawData(ImGui::GetDrawData());
 
-        SDL_RenderPresent(core.renderer);
+        SDL_RenderPresent(core.renderer); core.gfx.endFrame();
 
         Uint32 frameTime = SDL_GetTicks() - now; if(frameDelay > (int)frameTime) SDL_Delay(frameDelay - frameTime);
     }